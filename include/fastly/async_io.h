@@ -0,0 +1,142 @@
+#ifndef FASTLY_ASYNC_IO_H
+#define FASTLY_ASYNC_IO_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fastly/error.h>
+#include <fastly/http/request.h>
+#include <fastly/http/response.h>
+#include <fastly/kv_store.h>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/// Waiting on several kinds of asynchronous operations at once.
+///
+/// A `WaitSet` holds pending backend requests and pending KV store
+/// operations, and returns whichever completes first, so that a handler can
+/// overlap KV reads with origin fetches and react to each as it finishes.
+///
+/// # Example
+///
+/// ```cpp
+/// fastly::async_io::WaitSet set;
+/// auto origin{set.add(Request::get(url).send_async("origin").value())};
+/// auto flags{set.add(store, store.build_lookup().execute_async("flags")
+///                               .value())};
+/// while (auto ready{set.wait()}) {
+///   if (ready->id == flags) {
+///     auto &lookup{std::get<fastly::async_io::LookupReady>(ready->result)};
+///     // ...
+///   }
+/// }
+/// ```
+namespace fastly::async_io {
+
+/// The result of a backend request in a `WaitSet`.
+struct ResponseReady {
+  fastly::expected<http::Response> response;
+};
+
+/// The result of a KV store lookup in a `WaitSet`.
+struct LookupReady {
+  kv_store::expected<kv_store::LookupResponse> response;
+};
+
+/// The result of a KV store insert in a `WaitSet`.
+struct InsertReady {
+  kv_store::expected<> result;
+};
+
+/// The result of a KV store erase in a `WaitSet`.
+struct EraseReady {
+  kv_store::expected<> result;
+};
+
+/// The result of a KV store list in a `WaitSet`.
+struct ListReady {
+  kv_store::expected<kv_store::ListPage> page;
+};
+
+/// An operation in a `WaitSet` that has completed.
+struct Ready {
+  /// The ID returned by `WaitSet::add()` for the operation.
+  std::size_t id;
+  std::variant<ResponseReady, LookupReady, InsertReady, EraseReady, ListReady>
+      result;
+};
+
+/// A set of pending backend requests and KV store operations to wait on
+/// together.
+///
+/// Each operation is added with `WaitSet::add()`, which returns an ID for
+/// it, and is removed from the set once `WaitSet::wait()` returns it. KV store
+/// operations keep a reference to their `KVStore`, which must outlive the
+/// set.
+///
+/// Every operation in the set is handed to a single host wait, so waiting
+/// doesn't spin however the set is made up.
+class WaitSet {
+public:
+  WaitSet() = default;
+
+  /// Add a pending backend request.
+  std::size_t add(http::request::PendingRequest pending);
+
+  /// Add a pending KV store lookup.
+  std::size_t add(const kv_store::KVStore &store,
+                  kv_store::PendingLookupHandle handle);
+
+  /// Add a pending KV store insert.
+  std::size_t add(const kv_store::KVStore &store,
+                  kv_store::PendingInsertHandle handle);
+
+  /// Add a pending KV store erase.
+  std::size_t add(const kv_store::KVStore &store,
+                  kv_store::PendingEraseHandle handle);
+
+  /// Add a pending KV store list.
+  std::size_t add(const kv_store::KVStore &store,
+                  kv_store::PendingListHandle handle);
+
+  /// The number of operations that haven't completed yet.
+  std::size_t size() const { return this->kv_.size() + this->http_.size(); }
+
+  /// Whether there are no operations left to wait on.
+  bool empty() const { return this->size() == 0; }
+
+  /// Block until an operation completes, and return it. Returns
+  /// `std::nullopt` if the set is empty.
+  std::optional<Ready> wait();
+
+  /// Like `WaitSet::wait()`, but gives up after `timeout`, returning
+  /// `std::nullopt`.
+  std::optional<Ready> wait_for(std::chrono::milliseconds timeout);
+
+private:
+  enum class KVKind { Lookup, Insert, Erase, List };
+  struct KVEntry {
+    std::size_t id;
+    KVKind kind;
+    const kv_store::KVStore *store;
+  };
+
+  std::size_t add_kv(const kv_store::KVStore &store, KVKind kind,
+                     std::uint32_t handle);
+  Ready take_kv(std::size_t index);
+  Ready take_http(std::size_t index);
+  std::optional<Ready>
+  wait_until(std::optional<std::chrono::steady_clock::time_point> deadline);
+
+  std::size_t next_id_{0};
+  // Parallel vectors, so that the handles can be passed to the host as is.
+  std::vector<KVEntry> kv_;
+  std::vector<std::uint32_t> kv_handles_;
+  std::vector<std::pair<std::size_t, http::request::PendingRequest>> http_;
+};
+
+} // namespace fastly::async_io
+
+#endif
@@ -2,9 +2,11 @@
 #define FASTLY_BACKEND_H
 
 #include <chrono>
+#include <cstdint>
 #include <fastly/error.h>
 #include <fastly/http/request.h>
 #include <fastly/sdk-sys.h>
+#include <optional>
 #include <string>
 #include <string_view>
 
@@ -17,6 +19,8 @@ class Response;
 
 namespace fastly::backend {
 
+using fastly::sys::backend::BackendHealth;
+
 class BackendBuilder;
 class Backend {
   friend fastly::http::Request;
@@ -44,6 +48,9 @@ public:
   uint32_t get_tcp_keepalive_probes();
   std::chrono::milliseconds get_tcp_keepalive_time();
   bool is_ssl();
+  /// The backend's health as reported by its health check, or
+  /// `BackendHealth::Unknown` if it has none.
+  fastly::expected<BackendHealth> is_healthy();
   bool operator==(Backend b) { return backend->equals(*b.backend); }
   bool operator!=(Backend b) { return !backend->equals(*b.backend); }
   // TODO(@zkat): optional stuff is weird.
@@ -87,6 +94,93 @@ private:
   rust::Box<fastly::sys::backend::BackendBuilder> builder;
 };
 
+/// The settings of a dynamic backend, kept as plain values.
+///
+/// Unlike `BackendBuilder`, a spec can be copied, compared and hashed, which
+/// is what `BackendRegistry` uses to recognize backends it already created.
+/// Settings that are never set keep the host's defaults.
+class BackendSpec {
+public:
+  explicit BackendSpec(std::string_view target) : target_(target) {};
+  BackendSpec override_host(std::string_view name) &&;
+  BackendSpec connect_timeout(std::chrono::milliseconds timeout) &&;
+  BackendSpec first_byte_timeout(std::chrono::milliseconds timeout) &&;
+  BackendSpec between_bytes_timeout(std::chrono::milliseconds timeout) &&;
+  BackendSpec enable_ssl() &&;
+  BackendSpec disable_ssl() &&;
+  BackendSpec check_certificate(std::string_view cert) &&;
+  BackendSpec ca_certificate(std::string_view cert) &&;
+  BackendSpec tls_ciphers(std::string_view ciphers) &&;
+  BackendSpec sni_hostname(std::string_view host) &&;
+  BackendSpec enable_pooling(bool enable) &&;
+  BackendSpec http_keepalive_time(std::chrono::milliseconds timeout) &&;
+  BackendSpec tcp_keepalive_enable(bool enable) &&;
+  BackendSpec tcp_keepalive_interval_secs(uint32_t secs) &&;
+  BackendSpec tcp_keepalive_probes(uint32_t probes) &&;
+  BackendSpec tcp_keepalive_time_secs(uint32_t secs) &&;
+
+  /// A stable 64-bit hash of every setting, identical across instances and
+  /// builds.
+  uint64_t hash() const;
+
+  /// A `BackendBuilder` with these settings, for a backend called `name`.
+  BackendBuilder builder(std::string_view name) const;
+
+  bool operator==(const BackendSpec &other) const = default;
+
+private:
+  std::string target_;
+  std::optional<std::string> override_host_;
+  std::optional<std::chrono::milliseconds> connect_timeout_;
+  std::optional<std::chrono::milliseconds> first_byte_timeout_;
+  std::optional<std::chrono::milliseconds> between_bytes_timeout_;
+  std::optional<bool> ssl_;
+  std::optional<std::string> check_certificate_;
+  std::optional<std::string> ca_certificate_;
+  std::optional<std::string> tls_ciphers_;
+  std::optional<std::string> sni_hostname_;
+  std::optional<bool> pooling_;
+  std::optional<std::chrono::milliseconds> http_keepalive_time_;
+  std::optional<bool> tcp_keepalive_enable_;
+  std::optional<uint32_t> tcp_keepalive_interval_secs_;
+  std::optional<uint32_t> tcp_keepalive_probes_;
+  std::optional<uint32_t> tcp_keepalive_time_secs_;
+};
+
+/// Get-or-create access to dynamic backends.
+///
+/// Building a dynamic backend on every request costs a builder, a
+/// registration call, and an "already exists" error whenever the backend was
+/// registered before. The registry instead names each backend after a hash of
+/// its settings, so the same spec always maps to the same backend and
+/// changed settings never collide with an older backend. Resolved backends
+/// are cached for the lifetime of the instance.
+///
+/// # Examples
+///
+/// ```cpp
+/// auto origin{fastly::backend::BackendRegistry::get_or_create(
+///     "origin", fastly::backend::BackendSpec("origin.example.com")
+///                   .enable_ssl()
+///                   .first_byte_timeout(std::chrono::seconds(5)))};
+/// auto resp{
+///     fastly::Request::get("https://origin.example.com/").send(*origin)};
+/// ```
+class BackendRegistry {
+public:
+  /// Return the backend for `spec`, registering it under `name` followed by
+  /// the spec's hash if it doesn't exist yet.
+  static fastly::expected<Backend> get_or_create(std::string_view name,
+                                                 const BackendSpec &spec);
+
+  /// The name `get_or_create()` registers the backend for `spec` under.
+  static std::string backend_name(std::string_view name,
+                                  const BackendSpec &spec);
+
+  /// Forget all cached backends. Registered backends are not affected.
+  static void clear();
+};
+
 } // namespace fastly::backend
 
 #endif
@@ -0,0 +1,96 @@
+#ifndef FASTLY_BACKGROUND_H
+#define FASTLY_BACKGROUND_H
+
+#include <chrono>
+#include <cstddef>
+#include <fastly/backend.h>
+#include <fastly/http/body.h>
+#include <fastly/http/request.h>
+#include <fastly/kv_store.h>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/// Work that should happen after the response has been sent to the client.
+///
+/// Analytics beacons, KV updates, cache fills and purges often don't affect
+/// the response, but doing them before `Response::send_to_client()` adds their
+/// latency to every request. Work registered with the functions in this
+/// namespace is instead queued, and drained once the response has been sent:
+/// right after `Response::send_to_client()` or after `StreamingBody::finish()`
+/// on the body returned by `Response::stream_to_client()`. Anything still
+/// queued when `main` returns is drained at exit.
+///
+/// Draining starts all queued backend sends and KV inserts at once, runs the
+/// queued purges and deferred functions while they are in flight, and then
+/// waits for all of them. If a time budget is set with `set_time_budget()`, no
+/// new work is started and no more results are waited for once it runs out.
+///
+/// Failures are reported through `fastly::log::warn()`, since there is no one
+/// left to return them to.
+///
+/// # Examples
+///
+/// ```cpp
+/// auto req{fastly::Request::from_client()};
+/// fastly::background::send(
+///     fastly::Request::post("https://analytics.example.com/beacon")
+///         .with_body(req.get_path()),
+///     "analytics");
+/// fastly::background::kv_insert("visits", req.get_path(), fastly::Body("1"));
+/// // The beacon and the insert run after this, while the client already
+/// // has its response.
+/// fastly::Response::from_body("hello").send_to_client();
+/// ```
+namespace fastly::background {
+
+/// Send a request to a backend once the response has been sent, discarding
+/// the backend's response.
+void send(http::Request req, std::string_view backend_name);
+void send(http::Request req, backend::Backend &backend);
+
+/// Wait for an already started backend request once the response has been
+/// sent, discarding its response.
+void add(http::request::PendingRequest pending);
+
+/// Insert a value into the named KV store once the response has been sent.
+void kv_insert(std::string_view store_name, std::string key, http::Body value,
+               std::optional<std::chrono::milliseconds> ttl = std::nullopt);
+
+/// Wait for an already started insert into the named KV store once the
+/// response has been sent.
+void add(std::string_view store_name, kv_store::PendingInsertHandle handle);
+
+/// Purge, or soft-purge, a surrogate key once the response has been sent.
+void purge_surrogate_key(std::string surrogate_key, bool soft = false);
+
+/// Run a function once the response has been sent, after the queued backend
+/// sends and KV inserts have been started.
+///
+/// Functions may queue further work, which is drained in turn.
+void defer(std::function<void()> fn);
+
+/// Limit draining to `budget` from the start of the program. Work that would
+/// start, or results that would be waited for, after that point are
+/// abandoned.
+void set_time_budget(std::chrono::milliseconds budget);
+
+/// Number of items currently queued.
+size_t pending();
+
+/// Start all queued work and wait for it, within the time budget.
+///
+/// This is called automatically once the response has been sent, and at
+/// exit, so it usually doesn't need to be called directly.
+void drain();
+
+namespace detail {
+// Called by the response-sending paths of the SDK. This is intended for
+// internal use only.
+void response_sent();
+} // namespace detail
+
+} // namespace fastly::background
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef FASTLY_CACHE_CORE_H
+#define FASTLY_CACHE_CORE_H
+
+#include <chrono>
+#include <cstdint>
+#include <fastly/error.h>
+#include <fastly/http/body.h>
+#include <fastly/sdk-sys.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// Low-level interface to Fastly's cache.
+///
+/// The cache stores arbitrary bodies under arbitrary byte-string keys, with
+/// a TTL, optional surrogate keys for purging, and optional user metadata.
+/// Unlike the HTTP cache behind `Request::send()`, nothing about the cached
+/// items needs to be HTTP, so it can hold computed results as well as origin
+/// responses.
+///
+/// There are two ways to use it:
+///
+/// - `lookup()` and `insert()` read and write items directly. Concurrent
+///   lookups of a missing item all miss, and any number of them may go on to
+///   insert it.
+/// - `Transaction::lookup()` starts a transaction that collapses concurrent
+///   lookups of the same key, across instances: one of them is told it must
+///   insert the item (`Transaction::must_insert_or_update()`), and the others
+///   wait for that insert and then read the item as it is being written.
+///
+/// Cached bodies are written through a `StreamingBody` and read through a
+/// `Body`, so items don't have to fit in memory, and readers can start
+/// before the writer finishes.
+///
+/// An invalid header name or value, or a surrogate key that isn't valid
+/// UTF-8, passed to a builder makes its `execute()` fail with
+/// `CacheErrorCode::InvalidOperation`.
+///
+/// # Example
+///
+/// ```cpp
+/// namespace core = fastly::cache::core;
+/// auto tx{core::Transaction::lookup("my-key").execute().value()};
+/// if (tx.must_insert_or_update()) {
+///   auto [writer, found]{std::move(tx)
+///                            .insert(std::chrono::minutes(5))
+///                            .surrogate_keys({"my-surrogate-key"})
+///                            .execute_and_stream_back()
+///                            .value()};
+///   writer << compute_expensive_value();
+///   writer.finish();
+///   return found.to_stream();
+/// }
+/// return tx.found()->to_stream();
+/// ```
+namespace fastly::cache::core {
+using fastly::sys::cache::CacheErrorCode;
+class CacheError {
+public:
+  CacheError(fastly::sys::cache::CacheError *e)
+      : err_(rust::Box<fastly::sys::cache::CacheError>::from_raw(e)) {};
+  CacheError(rust::Box<fastly::sys::cache::CacheError> e)
+      : err_(std::move(e)) {};
+  CacheErrorCode error_code();
+  std::string error_msg();
+
+private:
+  rust::Box<fastly::sys::cache::CacheError> err_;
+};
+template <class T = void> using expected = tl::expected<T, CacheError>;
+template <class T = void> using unexpected = tl::unexpected<T>;
+
+class LookupBuilder;
+class Transaction;
+class TransactionInsertBuilder;
+
+/// A cached item returned by a lookup.
+class Found {
+  friend LookupBuilder;
+  friend Transaction;
+  friend TransactionInsertBuilder;
+
+public:
+  /// The time for which the item is fresh, counted from when it was
+  /// inserted.
+  std::chrono::milliseconds ttl() const;
+
+  /// The current age of the item.
+  std::chrono::milliseconds age() const;
+
+  /// The time for which the item can be served stale while it is being
+  /// revalidated, after its TTL has run out.
+  std::chrono::milliseconds stale_while_revalidate() const;
+
+  /// Whether the item is fresh, or stale but within its
+  /// `stale_while_revalidate` period.
+  bool is_usable() const;
+
+  /// Whether the item's TTL has run out.
+  bool is_stale() const;
+
+  /// The size of the item's body, if it is known.
+  std::optional<uint64_t> known_length() const;
+
+  /// The user metadata stored with the item.
+  std::vector<uint8_t> user_metadata() const;
+
+  /// The number of lookups that have found this item.
+  uint64_t hits() const;
+
+  /// A `Body` reading the item, which can start before its insert finishes.
+  /// Each call returns an independent reader.
+  expected<Body> to_stream() const;
+
+  /// A `Body` reading the bytes from `from` to `to` inclusive. If `from` is
+  /// not given, `to` counts the bytes at the end; if `to` is not given, the
+  /// rest of the item is read.
+  expected<Body> to_stream_from_range(std::optional<uint64_t> from,
+                                      std::optional<uint64_t> to) const;
+
+private:
+  Found(rust::Box<fastly::sys::cache::Found> found)
+      : found_(std::move(found)) {}
+  rust::Box<fastly::sys::cache::Found> found_;
+};
+
+/// A builder for a non-transactional lookup, created with `lookup()`.
+class LookupBuilder {
+  friend LookupBuilder lookup(std::string_view key);
+
+public:
+  /// Set a request header, used to pick a variant of an item inserted with
+  /// `InsertBuilder::vary_by()`.
+  LookupBuilder header(std::string_view name, std::string_view value) &&;
+
+  /// Perform the lookup. Returns `std::nullopt` if there is no item under the
+  /// key.
+  expected<std::optional<Found>> execute() &&;
+
+private:
+  LookupBuilder(rust::Box<fastly::sys::cache::CacheLookupBuilder> builder)
+      : builder_(std::move(builder)) {}
+  rust::Box<fastly::sys::cache::CacheLookupBuilder> builder_;
+};
+
+/// Start a non-transactional lookup of `key`.
+LookupBuilder lookup(std::string_view key);
+
+/// A builder for a non-transactional insert, created with `insert()`.
+class InsertBuilder {
+  friend InsertBuilder insert(std::string_view key,
+                              std::chrono::milliseconds ttl);
+
+public:
+  /// Set a request header, used with `InsertBuilder::vary_by()`.
+  InsertBuilder header(std::string_view name, std::string_view value) &&;
+
+  /// Keep a separate variant of the item for each combination of values of
+  /// these request headers.
+  InsertBuilder vary_by(const std::vector<std::string> &headers) &&;
+
+  /// Insert the item as if it were already this old.
+  InsertBuilder initial_age(std::chrono::milliseconds age) &&;
+
+  /// Allow the item to be served stale for this long after its TTL while it
+  /// is being revalidated.
+  InsertBuilder stale_while_revalidate(std::chrono::milliseconds duration) &&;
+
+  /// Surrogate keys that can be used to purge the item.
+  InsertBuilder surrogate_keys(const std::vector<std::string> &keys) &&;
+
+  /// The size of the body that will be written, if known in advance.
+  InsertBuilder known_length(uint64_t length) &&;
+
+  /// Arbitrary metadata to store with the item.
+  InsertBuilder user_metadata(const std::vector<uint8_t> &metadata) &&;
+
+  /// Whether the item holds sensitive data, which must not be persisted.
+  InsertBuilder sensitive_data(bool sensitive) &&;
+
+  /// The longest the item may be kept in the cache of the delivery node
+  /// serving it, as opposed to the node storing it.
+  InsertBuilder deliver_node_max_age(std::chrono::milliseconds max_age) &&;
+
+  /// Perform the insert, returning the body to write the item to. The item
+  /// is complete once the body is finished.
+  expected<fastly::http::StreamingBody> execute() &&;
+
+private:
+  InsertBuilder(rust::Box<fastly::sys::cache::CacheInsertBuilder> builder)
+      : builder_(std::move(builder)) {}
+  rust::Box<fastly::sys::cache::CacheInsertBuilder> builder_;
+};
+
+/// Start a non-transactional insert of an item under `key`, fresh for `ttl`.
+InsertBuilder insert(std::string_view key, std::chrono::milliseconds ttl);
+
+class TransactionLookupBuilder;
+class TransactionUpdateBuilder;
+
+/// A transactional lookup, which collapses concurrent lookups of the same
+/// key.
+///
+/// If the item is missing or stale, exactly one transaction is told to
+/// insert or update it, and the others wait for that to happen. A
+/// transaction that must insert and doesn't, because it is dropped or
+/// `Transaction::cancel_insert_or_update()` is called, hands the obligation
+/// to one of the waiting transactions.
+class Transaction {
+  friend TransactionLookupBuilder;
+
+public:
+  /// Start a transactional lookup of `key`.
+  static TransactionLookupBuilder lookup(std::string_view key);
+
+  /// The item found by the lookup, if any. It may be stale.
+  std::optional<Found> found() const;
+
+  /// Whether there is no usable item, and this transaction must insert it.
+  bool must_insert() const;
+
+  /// Whether this transaction must insert the item, or update a stale one.
+  bool must_insert_or_update() const;
+
+  /// Give up the obligation to insert or update the item, letting another
+  /// transaction waiting on the key take it.
+  expected<> cancel_insert_or_update() const;
+
+  /// Insert the item, fresh for `ttl`.
+  TransactionInsertBuilder insert(std::chrono::milliseconds ttl) &&;
+
+  /// Update the metadata of a stale item, making it fresh for `ttl`, without
+  /// changing its body.
+  TransactionUpdateBuilder update(std::chrono::milliseconds ttl) &&;
+
+private:
+  Transaction(rust::Box<fastly::sys::cache::Transaction> transaction)
+      : transaction_(std::move(transaction)) {}
+  rust::Box<fastly::sys::cache::Transaction> transaction_;
+};
+
+/// A builder for a transactional lookup, created with
+/// `Transaction::lookup()`.
+class TransactionLookupBuilder {
+  friend Transaction;
+
+public:
+  /// Set a request header, used to pick a variant of an item inserted with
+  /// `TransactionInsertBuilder::vary_by()`.
+  TransactionLookupBuilder header(std::string_view name,
+                                  std::string_view value) &&;
+
+  /// Perform the lookup, waiting if another transaction is inserting the
+  /// item.
+  expected<Transaction> execute() &&;
+
+private:
+  TransactionLookupBuilder(
+      rust::Box<fastly::sys::cache::TransactionLookupBuilder> builder)
+      : builder_(std::move(builder)) {}
+  rust::Box<fastly::sys::cache::TransactionLookupBuilder> builder_;
+};
+
+/// A builder for the insert of a transaction, created with
+/// `Transaction::insert()`. The settings are as for `InsertBuilder`.
+class TransactionInsertBuilder {
+  friend Transaction;
+
+public:
+  TransactionInsertBuilder vary_by(const std::vector<std::string> &headers) &&;
+  TransactionInsertBuilder initial_age(std::chrono::milliseconds age) &&;
+  TransactionInsertBuilder
+  stale_while_revalidate(std::chrono::milliseconds duration) &&;
+  TransactionInsertBuilder
+  surrogate_keys(const std::vector<std::string> &keys) &&;
+  TransactionInsertBuilder known_length(uint64_t length) &&;
+  TransactionInsertBuilder
+  user_metadata(const std::vector<uint8_t> &metadata) &&;
+  TransactionInsertBuilder sensitive_data(bool sensitive) &&;
+  TransactionInsertBuilder
+  deliver_node_max_age(std::chrono::milliseconds max_age) &&;
+
+  /// Perform the insert, returning the body to write the item to.
+  expected<fastly::http::StreamingBody> execute() &&;
+
+  /// Perform the insert, returning the body to write the item to along with
+  /// the item itself, which can be read while it is being written.
+  expected<std::pair<fastly::http::StreamingBody, Found>>
+  execute_and_stream_back() &&;
+
+private:
+  TransactionInsertBuilder(
+      rust::Box<fastly::sys::cache::TransactionInsertBuilder> builder)
+      : builder_(std::move(builder)) {}
+  rust::Box<fastly::sys::cache::TransactionInsertBuilder> builder_;
+};
+
+/// A builder for the update of a transaction, created with
+/// `Transaction::update()`. The settings are as for `InsertBuilder`, with
+/// `age` replacing `initial_age`.
+class TransactionUpdateBuilder {
+  friend Transaction;
+
+public:
+  TransactionUpdateBuilder vary_by(const std::vector<std::string> &headers) &&;
+  TransactionUpdateBuilder age(std::chrono::milliseconds age) &&;
+  TransactionUpdateBuilder
+  stale_while_revalidate(std::chrono::milliseconds duration) &&;
+  TransactionUpdateBuilder
+  surrogate_keys(const std::vector<std::string> &keys) &&;
+  TransactionUpdateBuilder
+  user_metadata(const std::vector<uint8_t> &metadata) &&;
+  TransactionUpdateBuilder
+  deliver_node_max_age(std::chrono::milliseconds max_age) &&;
+
+  /// Perform the update.
+  expected<> execute() &&;
+
+private:
+  TransactionUpdateBuilder(
+      rust::Box<fastly::sys::cache::TransactionUpdateBuilder> builder)
+      : builder_(std::move(builder)) {}
+  rust::Box<fastly::sys::cache::TransactionUpdateBuilder> builder_;
+};
+
+} // namespace fastly::cache::core
+
+#endif
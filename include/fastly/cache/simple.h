@@ -0,0 +1,78 @@
+#ifndef FASTLY_CACHE_SIMPLE_H
+#define FASTLY_CACHE_SIMPLE_H
+
+#include <chrono>
+#include <fastly/cache/core.h>
+#include <fastly/error.h>
+#include <fastly/http/body.h>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/// A get-or-set cache for computed values, on top of `fastly::cache::core`.
+///
+/// Values are cached per POP. `get_or_set_with()` collapses concurrent
+/// requests for a missing key, so that a value is computed once per POP and
+/// TTL rather than once per request, while the other requests wait for it
+/// and read it as it is written.
+///
+/// # Example
+///
+/// ```cpp
+/// auto fragment{fastly::cache::simple::get_or_set_with(
+///     "header-fragment", [] {
+///       return fastly::cache::simple::CacheEntry{
+///           fastly::Body(render_header()), std::chrono::minutes(10)};
+///     })};
+/// ```
+namespace fastly::cache::simple {
+
+using core::CacheError;
+using core::CacheErrorCode;
+using core::expected;
+using core::unexpected;
+
+/// A value to cache, and for how long.
+struct CacheEntry {
+  Body value;
+  std::chrono::milliseconds ttl;
+};
+
+/// Where `purge()` removes a key from.
+enum class PurgeScope {
+  /// The POP the purge is issued from.
+  Pop,
+  /// Every POP.
+  Global,
+};
+
+/// The value cached under `key`, or `std::nullopt` if there is none.
+expected<std::optional<Body>> get(std::string_view key);
+
+/// The value cached under `key`. If there is none, `make_entry` is called to
+/// produce it, and the result is cached and returned.
+///
+/// Concurrent calls for the same key wait for the one that calls
+/// `make_entry`. If `make_entry` returns `std::nullopt`, nothing is cached,
+/// this returns `std::nullopt`, and one of the waiting calls gets to produce
+/// the value instead.
+expected<std::optional<Body>>
+get_or_set_with(std::string_view key,
+                const std::function<std::optional<CacheEntry>()> &make_entry);
+
+/// The value cached under `key`. If there is none, `value` is cached for
+/// `ttl` and returned.
+expected<Body> get_or_set(std::string_view key, Body value,
+                          std::chrono::milliseconds ttl);
+
+/// Remove the value cached under `key`.
+///
+/// The POP is read from the `FASTLY_POP` environment variable. If it isn't
+/// set, purging with `PurgeScope::Pop` fails rather than purging every POP.
+fastly::expected<void> purge(std::string_view key,
+                             PurgeScope scope = PurgeScope::Pop);
+
+} // namespace fastly::cache::simple
+
+#endif
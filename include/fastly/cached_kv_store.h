@@ -0,0 +1,106 @@
+#ifndef FASTLY_CACHED_KV_STORE_H
+#define FASTLY_CACHED_KV_STORE_H
+
+#include <chrono>
+#include <cstdint>
+#include <fastly/http/body.h>
+#include <fastly/kv_store.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fastly::kv_store {
+
+/// How `CachedKVStore` caches values.
+class KVCachePolicy {
+public:
+  /// Cache values for a minute, serve them stale for another minute while
+  /// they are revalidated, and prefix cache keys with "kv-cache/".
+  KVCachePolicy();
+
+  /// How long a cached value is served without checking the KV store.
+  KVCachePolicy ttl(std::chrono::milliseconds ttl) &&;
+
+  /// How long after its TTL a cached value is still served, while it is
+  /// revalidated after the response has been sent.
+  KVCachePolicy stale_while_revalidate(std::chrono::milliseconds swr) &&;
+
+  /// Prefix for the cache keys and surrogate keys of cached values, to keep
+  /// them apart from other cached items.
+  KVCachePolicy key_prefix(std::string_view prefix) &&;
+
+private:
+  friend class CachedKVStore;
+  std::chrono::milliseconds ttl_;
+  std::chrono::milliseconds swr_;
+  std::string key_prefix_;
+};
+
+/// A value read through a `CachedKVStore`.
+struct CachedLookup {
+  Body body;
+  std::optional<std::vector<std::uint8_t>> metadata;
+  std::uint64_t generation;
+};
+
+/// A KV store whose values are cached in the POP, for keys that are read far
+/// more often than they change, such as feature flags or tenant settings.
+///
+/// Lookups are served from the cache for the policy's TTL. Once that runs
+/// out, the value is still served for its stale-while-revalidate period,
+/// while the KV store is read again after the response has been sent, through
+/// `fastly::background`. If the KV store still has the same generation of the
+/// value, only the cached item's TTL is renewed. Concurrent lookups of a
+/// missing key are collapsed into one KV read.
+///
+/// `CachedKVStore::insert()` and `CachedKVStore::erase()` purge the cached
+/// value in every POP. Changes made to the store by other means show up once
+/// the cached value expires.
+///
+/// # Example
+///
+/// ```cpp
+/// namespace kv = fastly::kv_store;
+/// auto flags{kv::CachedKVStore::open(
+///                "flags", kv::KVCachePolicy().ttl(std::chrono::seconds(30)))
+///                .value()
+///                .value()};
+/// auto flag{flags.lookup("new-checkout")};
+/// ```
+class CachedKVStore {
+public:
+  /// Open the KV store with the given name.
+  static expected<std::optional<CachedKVStore>>
+  open(std::string_view name, KVCachePolicy policy = KVCachePolicy());
+
+  /// Look up a value, from the cache if possible.
+  ///
+  /// If the cache can't be used, this falls back to reading the KV store.
+  expected<CachedLookup> lookup(std::string_view key) const;
+
+  /// Insert a value, and purge the cached value.
+  expected<> insert(std::string_view key, Body value) const;
+
+  /// Erase a value, and purge the cached value.
+  expected<> erase(std::string_view key) const;
+
+  /// Purge the cached value of `key`, in every POP.
+  void invalidate(std::string_view key) const;
+
+  /// The underlying KV store, which bypasses the cache.
+  const KVStore &store() const { return this->store_; }
+
+private:
+  CachedKVStore(KVStore store, std::string name, KVCachePolicy policy)
+      : store_(std::move(store)), name_(std::move(name)),
+        policy_(std::move(policy)) {}
+
+  KVStore store_;
+  std::string name_;
+  KVCachePolicy policy_;
+};
+
+} // namespace fastly::kv_store
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef FASTLY_CHUNKED_KV_STORE_H
+#define FASTLY_CHUNKED_KV_STORE_H
+
+#include <cstddef>
+#include <fastly/http/body.h>
+#include <fastly/kv_store.h>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace fastly::kv_store {
+
+/// A KV store for values larger than a single item can hold, such as build
+/// artifacts or media files.
+///
+/// Values are split into chunks of `chunk_size` bytes, each stored as its own
+/// item, and the metadata of the value's key holds a small manifest listing
+/// them. Chunks are written and read with several requests in flight at once,
+/// so large values are fetched much faster than as a single item. Values that
+/// fit in one chunk are stored as they are, and keys that weren't written
+/// through a `ChunkedKVStore` are read as plain values.
+///
+/// A value is replaced by writing all of its chunks before its manifest, so
+/// readers see either the old value or the new one. The chunks of the old
+/// value are erased through `fastly::background` once the response has been
+/// sent. A reader elsewhere that finds one of them missing looks the value up
+/// again and starts over with the new one, up to a few times. `stream_to()`
+/// can only do so before it has written anything to `out`; after that it
+/// fails with an `ItemNotFound` error.
+///
+/// # Example
+///
+/// ```cpp
+/// namespace kv = fastly::kv_store;
+/// auto artifacts{kv::ChunkedKVStore::open("artifacts").value().value()};
+/// auto stream{Response().stream_to_client()};
+/// if (!artifacts.stream_to("release.tar.gz", stream)) {
+///   // Part of the value may have been sent already, so give up on it.
+///   std::abort();
+/// }
+/// stream.finish();
+/// ```
+class ChunkedKVStore {
+public:
+  /// Open the KV store with the given name, splitting values into chunks of
+  /// `chunk_size` bytes and keeping up to `max_in_flight` chunk requests in
+  /// flight.
+  static expected<std::optional<ChunkedKVStore>>
+  open(std::string_view name, std::size_t chunk_size = 1 << 20,
+       std::size_t max_in_flight = 8);
+
+  /// Insert a value, overwriting any value already stored for `key`.
+  expected<> insert(std::string_view key, Body value) const;
+
+  /// Look up a value, and reassemble it into a single body.
+  expected<Body> lookup(std::string_view key) const;
+
+  /// Look up a value, and append it to `out` chunk by chunk, in order. The
+  /// chunks are handed to the host without being copied.
+  ///
+  /// If this fails, part of the value may already have been written to `out`,
+  /// including when the value is replaced while it is being sent.
+  expected<> stream_to(std::string_view key, http::StreamingBody &out) const;
+
+  /// Erase a value and its chunks.
+  expected<> erase(std::string_view key) const;
+
+  /// The underlying KV store.
+  const KVStore &store() const { return this->store_; }
+
+private:
+  ChunkedKVStore(KVStore store, std::string name, std::size_t chunk_size,
+                 std::size_t max_in_flight)
+      : store_(std::move(store)), name_(std::move(name)),
+        chunk_size_(chunk_size), max_in_flight_(max_in_flight) {}
+
+  KVStore store_;
+  std::string name_;
+  std::size_t chunk_size_;
+  std::size_t max_in_flight_;
+};
+
+} // namespace fastly::kv_store
+
+#endif
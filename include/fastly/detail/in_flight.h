@@ -0,0 +1,24 @@
+#ifndef FASTLY_DETAIL_IN_FLIGHT_H
+#define FASTLY_DETAIL_IN_FLIGHT_H
+
+#include <functional>
+#include <string>
+
+namespace fastly::detail {
+// Bookkeeping attached to a `PendingRequest` for as long as the request is in
+// flight, such as a director's in-flight count. `release` runs once the
+// request completes or its handle is dropped.
+// This is intended for internal use only.
+struct InFlight {
+  std::string backend;
+  std::function<void()> release;
+
+  ~InFlight() {
+    if (release) {
+      release();
+    }
+  }
+};
+} // namespace fastly::detail
+
+#endif
@@ -25,6 +25,18 @@ protected:
   ProcessFragmentResponseFnTag() = default;
 };
 } // namespace esi
+namespace http {
+// request.h:BeforeSendFn
+struct BeforeSendFnTag {
+protected:
+  BeforeSendFnTag() = default;
+};
+// request.h:AfterSendFn
+struct AfterSendFnTag {
+protected:
+  AfterSendFnTag() = default;
+};
+} // namespace http
 } // namespace fastly::detail::rust_bridge_tags
 
 #endif
\ No newline at end of file
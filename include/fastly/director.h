@@ -0,0 +1,194 @@
+#ifndef FASTLY_DIRECTOR_H
+#define FASTLY_DIRECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fastly/backend.h>
+#include <fastly/error.h>
+#include <fastly/http/request.h>
+#include <fastly/http/response.h>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Load balancing across a pool of backends.
+///
+/// A director picks one backend out of a pool for each request, skipping
+/// backends whose health check reports them as unhealthy. Like VCL directors,
+/// they come in several flavors:
+///
+/// - `RoundRobin` cycles through the pool in proportion to each backend's
+///   weight.
+/// - `Random` picks a backend at random, in proportion to its weight.
+/// - `ConsistentHash` maps a key derived from the request, by default its URL,
+///   to a backend, so that the same key always reaches the same backend and
+///   caches behind each backend only see their own share of keys.
+/// - `LeastInFlight` picks the backend with the fewest requests sent through
+///   the director that haven't completed yet.
+///
+/// Requests are sent through a director with `Request::send(Director &)` or
+/// `Request::send_async(Director &)`.
+///
+/// # Examples
+///
+/// ```cpp
+/// fastly::director::ConsistentHash origins{
+///     {{"origin_a"}, {"origin_b"}, {"origin_c", 2}}};
+/// auto resp{fastly::Request::from_client().send(origins)};
+/// ```
+namespace fastly::director {
+
+/// A backend in a director's pool, with its weight relative to the other
+/// members.
+struct Member {
+  Member(std::string_view backend_name, uint32_t weight = 1)
+      : name(backend_name), weight(weight) {};
+  Member(backend::Backend &backend, uint32_t weight = 1)
+      : name(backend.name()), weight(weight) {};
+
+  std::string name;
+  uint32_t weight;
+};
+
+/// The common interface of all directors.
+///
+/// Backends are looked up by name the first time they are considered, and
+/// their health is checked at most once per execution. A backend that can't be
+/// found is treated as unhealthy.
+class Director {
+public:
+  Director(Director &&) = default;
+  Director &operator=(Director &&) = default;
+  virtual ~Director() = default;
+
+  /// Choose a backend for `req`.
+  ///
+  /// Returns an error with code `FastlyErrorCode::IoError` if no member is
+  /// healthy.
+  fastly::expected<backend::Backend> choose(http::Request &req);
+
+  /// Exclude a backend from the pool for the rest of this execution, for
+  /// example after it failed to answer.
+  void mark_unhealthy(std::string_view backend_name);
+
+  /// Send `req` to a backend chosen by this director.
+  fastly::expected<http::Response> send(http::Request req);
+
+  /// Begin sending `req` to a backend chosen by this director.
+  fastly::expected<http::request::PendingRequest> send_async(http::Request req);
+
+  /// The members of the pool.
+  const std::vector<Member> &members() const { return members_; }
+
+protected:
+  explicit Director(std::vector<Member> members);
+
+  // Pick the member to use for `req`. `usable[i]` is false for members that
+  // must not be picked; at least one member is usable.
+  virtual size_t pick(http::Request &req, const std::vector<bool> &usable) = 0;
+
+  // Called when a request is sent to `member` through the director. The
+  // returned function, if any, runs once that request has completed.
+  virtual std::function<void()> on_send(size_t member);
+
+  // The index of a usable member for `req`, if any.
+  std::optional<size_t> choose_index(http::Request &req);
+
+  // The resolved backend of a usable member.
+  backend::Backend &backend_at(size_t member) { return *backends_[member]; }
+
+  // Whether `member` can currently be picked.
+  bool usable(size_t member);
+
+private:
+  std::vector<Member> members_;
+  std::vector<std::optional<backend::Backend>> backends_;
+  std::vector<std::optional<bool>> healthy_;
+};
+
+/// Smooth weighted round-robin: over any window of requests, each backend
+/// receives a share proportional to its weight, with picks of the same
+/// backend spread out rather than bunched together.
+///
+/// Since each execution starts with a fresh director, the rotation starts at a
+/// random position.
+class RoundRobin : public Director {
+public:
+  explicit RoundRobin(std::vector<Member> members);
+
+protected:
+  size_t pick(http::Request &req, const std::vector<bool> &usable) override;
+
+private:
+  size_t step(const std::vector<bool> &usable);
+
+  std::vector<int64_t> current_;
+};
+
+/// Weighted random choice.
+class Random : public Director {
+public:
+  explicit Random(std::vector<Member> members);
+
+protected:
+  size_t pick(http::Request &req, const std::vector<bool> &usable) override;
+};
+
+/// Consistent hashing with a Maglev lookup table.
+///
+/// The table is built once, when the director is constructed. Each key hashes
+/// to one slot of the table, and adding or removing a backend only remaps
+/// about its own share of the keys. If the backend for a key is unhealthy, the
+/// following slots are tried in turn, so keys of a healthy backend never move.
+class ConsistentHash : public Director {
+public:
+  using KeyFn = std::function<std::string(http::Request &)>;
+
+  /// `table_size` should be a prime much larger than the total weight of the
+  /// pool; the default suits pools with a total weight of up to about 20.
+  /// Building the table takes time in proportion to its size, on every
+  /// request that constructs the director. `key` defaults to the request URL.
+  explicit ConsistentHash(std::vector<Member> members, KeyFn key = nullptr,
+                          uint32_t table_size = 2039);
+
+  using Director::choose;
+
+  /// Choose a backend for a key directly.
+  fastly::expected<backend::Backend> choose(std::string_view key);
+
+protected:
+  size_t pick(http::Request &req, const std::vector<bool> &usable) override;
+
+private:
+  size_t pick_key(std::string_view key, const std::vector<bool> &usable);
+
+  KeyFn key_;
+  std::vector<uint32_t> table_;
+};
+
+/// Least in-flight requests, relative to each backend's weight.
+///
+/// Only requests sent through this director count as in flight. A request
+/// sent with `Request::send_async(Director &)` stays in flight until its
+/// `PendingRequest` completes or is dropped. Ties are broken at random.
+class LeastInFlight : public Director {
+public:
+  explicit LeastInFlight(std::vector<Member> members);
+
+  /// Number of requests currently in flight to `backend_name`.
+  uint32_t in_flight(std::string_view backend_name) const;
+
+protected:
+  size_t pick(http::Request &req, const std::vector<bool> &usable) override;
+  std::function<void()> on_send(size_t member) override;
+
+private:
+  std::shared_ptr<std::vector<uint32_t>> counts_;
+};
+
+} // namespace fastly::director
+
+#endif
@@ -4,6 +4,7 @@
 #include <fastly/expected.h>
 #include <fastly/sdk-sys.h>
 #include <string>
+#include <string_view>
 
 namespace fastly::error {
 
@@ -15,6 +16,16 @@ public:
       : err(rust::Box<fastly::sys::error::FastlyError>::from_raw(e)) {};
   FastlyError(rust::Box<fastly::sys::error::FastlyError> e)
       : err(std::move(e)) {};
+
+  /// Create an error with code `FastlyErrorCode::IoError` and the given
+  /// message, for failures that originate in C++ code layered on top of the
+  /// SDK.
+  static FastlyError io_error(std::string_view message);
+
+  /// Create an error with code `FastlyErrorCode::CircuitOpen` for a send that
+  /// was refused because the circuit for `backend` is open.
+  static FastlyError circuit_open(std::string_view backend);
+
   FastlyErrorCode error_code();
   std::string error_msg();
 
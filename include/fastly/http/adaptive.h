@@ -0,0 +1,199 @@
+#ifndef FASTLY_HTTP_ADAPTIVE_H
+#define FASTLY_HTTP_ADAPTIVE_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fastly/backend.h>
+#include <fastly/error.h>
+#include <fastly/http/timing.h>
+#include <fastly/kv_store.h>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/// Backend timeouts derived from observed latency.
+///
+/// A fixed `first_byte_timeout` is either loose enough for the slowest
+/// origin, which lets a stuck request hold up a client for far longer than
+/// needed, or tight enough for the fastest one, which fails requests to
+/// slower origins that would have succeeded. `AdaptiveTimeouts` instead keeps
+/// a latency histogram per backend in a KV store shared by all instances,
+/// and sets the first byte timeout of each dynamic backend to a high
+/// percentile of its recent latency times a safety factor, within a floor
+/// and a ceiling.
+///
+/// Derived timeouts are rounded to the histogram's buckets, so backends
+/// registered through `BackendRegistry` only change name when the latency of
+/// an origin actually shifts.
+///
+/// # Example
+///
+/// ```cpp
+/// fastly::http::adaptive::AdaptiveTimeouts timeouts{"latency"};
+/// fastly::http::timing::enable();
+/// auto origin{timeouts.backend(
+///     "origin", fastly::backend::BackendSpec("origin.example.com")
+///                   .enable_ssl()
+///                   .first_byte_timeout(std::chrono::seconds(15)))};
+/// auto resp{fastly::Request::from_client().send(*origin)};
+/// timeouts.observe_timings();
+/// timeouts.flush();
+/// ```
+namespace fastly::http::adaptive {
+
+/// A log-linear latency histogram, in the style of HDR histograms.
+///
+/// Each power of two is split into 8 buckets, so recorded values are kept to
+/// within 12.5% from a microsecond up to several hours, in a fixed 2 KiB.
+class LatencyHistogram {
+public:
+  static constexpr size_t BUCKETS{272};
+
+  /// Count one observation.
+  void record(std::chrono::microseconds latency);
+
+  /// Add every observation of `other`.
+  void merge(const LatencyHistogram &other);
+
+  /// Halve every count, so that older observations weigh less than newer
+  /// ones.
+  void decay();
+
+  /// The number of observations.
+  uint64_t count() const;
+
+  /// The smallest value that at least `quantile` of the observations are at
+  /// or below, rounded up to the end of its bucket. `quantile` is between 0
+  /// and 1. Returns `std::nullopt` if the histogram is empty.
+  std::optional<std::chrono::microseconds> percentile(double quantile) const;
+
+  /// A compact text form, listing only the buckets that are in use.
+  std::string serialize() const;
+
+  /// Parse the output of `serialize()`, or return `std::nullopt` if `text`
+  /// isn't one.
+  static std::optional<LatencyHistogram> parse(std::string_view text);
+
+  bool operator==(const LatencyHistogram &other) const = default;
+
+private:
+  std::array<uint64_t, BUCKETS> counts_{};
+};
+
+class AdaptiveTimeouts;
+
+/// Describes how timeouts are derived from latency.
+///
+/// The defaults set the first byte timeout to twice the p99 time to first
+/// byte once 50 requests have been observed, between 1 and 60 seconds, and
+/// halve the shared counts every 5 minutes.
+class AdaptivePolicy {
+  friend AdaptiveTimeouts;
+
+public:
+  AdaptivePolicy();
+
+  /// The percentile of observed latency the timeout is based on, between 0
+  /// and 1.
+  AdaptivePolicy percentile(double quantile) &&;
+
+  /// The multiple of the percentile to use as the timeout.
+  AdaptivePolicy factor(double factor) &&;
+
+  /// The shortest and longest first byte timeout to derive.
+  AdaptivePolicy first_byte_timeout(std::chrono::milliseconds floor,
+                                    std::chrono::milliseconds ceiling) &&;
+
+  /// Observations needed before timeouts are derived. Until then, backends
+  /// keep the timeouts of their spec.
+  AdaptivePolicy min_samples(uint64_t samples) &&;
+
+  /// How often the shared histograms are halved, to follow changes in
+  /// latency.
+  AdaptivePolicy decay_interval(std::chrono::milliseconds interval) &&;
+
+  /// Prefix of the KV store keys holding histograms. Defaults to
+  /// `"latency/"`.
+  AdaptivePolicy key_prefix(std::string_view prefix) &&;
+
+private:
+  double percentile_;
+  double factor_;
+  std::chrono::milliseconds first_byte_floor_;
+  std::chrono::milliseconds first_byte_ceiling_;
+  uint64_t min_samples_;
+  std::chrono::milliseconds decay_interval_;
+  std::string key_prefix_;
+};
+
+/// Tracks latency and derives timeouts for any number of backends.
+///
+/// Histograms are read from the KV store once per backend and execution.
+/// Observations are kept locally until `flush()` merges them into the
+/// shared histograms, which is best done once per execution, for example
+/// from `fastly::background::defer()`.
+class AdaptiveTimeouts {
+public:
+  /// Create a tracker that shares histograms through the KV store named
+  /// `kv_store_name`. Without the store, timeouts adapt within the current
+  /// execution only.
+  explicit AdaptiveTimeouts(std::string_view kv_store_name,
+                            AdaptivePolicy policy = AdaptivePolicy());
+
+  /// Record a time to first byte of `backend_name`.
+  void observe(std::string_view backend_name,
+               std::chrono::microseconds time_to_first_byte);
+
+  /// Record the time to first byte of a timed send. Sends to backends
+  /// created by `AdaptiveTimeouts::backend()` count towards the name passed
+  /// to it.
+  void observe(const timing::Record &record);
+
+  /// Record every send in `timing::records()` that hasn't been observed yet.
+  void observe_timings();
+
+  /// The histogram for `backend_name`, including local observations.
+  const LatencyHistogram &histogram(std::string_view backend_name);
+
+  /// The first byte timeout derived for `backend_name`, or `std::nullopt` if
+  /// there aren't enough observations yet.
+  std::optional<std::chrono::milliseconds>
+  first_byte_timeout(std::string_view backend_name);
+
+  /// `spec` with the timeouts derived for `backend_name` applied.
+  fastly::backend::BackendSpec apply(std::string_view backend_name,
+                                     fastly::backend::BackendSpec spec);
+
+  /// The dynamic backend for `spec` with adaptive timeouts, from
+  /// `fastly::backend::BackendRegistry::get_or_create()`.
+  fastly::expected<fastly::backend::Backend>
+  backend(std::string_view name, fastly::backend::BackendSpec spec);
+
+  /// Merge local observations into the shared histograms.
+  void flush();
+
+private:
+  struct Entry {
+    LatencyHistogram shared;
+    LatencyHistogram local;
+    LatencyHistogram combined;
+    // When the shared histogram was last halved, in milliseconds since the
+    // epoch.
+    int64_t decayed_at{0};
+  };
+
+  Entry &load(std::string_view backend_name);
+
+  AdaptivePolicy policy_;
+  std::optional<fastly::kv_store::KVStore> store_;
+  std::map<std::string, Entry, std::less<>> entries_;
+  // Registered backend names, mapped to the names passed to `backend()`.
+  std::map<std::string, std::string, std::less<>> aliases_;
+  size_t timings_seen_{0};
+};
+
+} // namespace fastly::http::adaptive
+
+#endif
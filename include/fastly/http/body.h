@@ -10,22 +10,34 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <streambuf>
 #include <string>
 #include <string_view>
 #include <vector>
 
+namespace fastly::detail {
+struct TeeState;
+}
+
 namespace fastly::kv_store {
 class InsertBuilder;
 class LookupResponse;
 class KVStore;
 } // namespace fastly::kv_store
 
+namespace fastly::cache::core {
+class Found;
+class InsertBuilder;
+class TransactionInsertBuilder;
+} // namespace fastly::cache::core
+
 namespace fastly::http {
 
 class Response;
 class Request;
 class StreamingBody;
+class TeeReader;
 namespace request {
 class PendingRequest;
 std::pair<fastly::expected<fastly::http::Response>, std::vector<PendingRequest>>
@@ -47,6 +59,7 @@ class Body : public std::iostream, public std::streambuf {
   friend kv_store::InsertBuilder;
   friend kv_store::LookupResponse;
   friend kv_store::KVStore;
+  friend cache::core::Found;
 
 protected:
   int underflow();
@@ -62,7 +75,7 @@ public:
   };
   Body(Body &&old)
       : std::iostream(this), bod((old.sync(), std::move(old.bod))),
-        pbuf(std::move(old.pbuf)) {
+        pbuf(std::move(old.pbuf)), timing_(old.timing_) {
     auto gcurr{old.gptr() - old.eback()};
     auto gend{old.egptr() - old.eback()};
     this->gbuf = std::move(old.gbuf);
@@ -100,10 +113,63 @@ public:
   /// Append another body onto the end of this body.
   void append(Body other);
 
+  /// Get the length of this body in bytes, if the host knows it up front.
+  ///
+  /// This is the case for bodies built in memory and for backend responses
+  /// that carry a valid `Content-Length`. Together with
+  /// `FramingHeadersMode::ManuallyFromHeaders`, this can be used to advertise
+  /// the length of a body that is streamed to the client.
+  std::optional<uint64_t> known_length();
+
   /// Appends request or response trailers to the body.
   fastly::expected<void> append_trailer(std::string_view header_name,
                                         std::string_view header_value);
 
+  /// Split this body into two readers that each see all of its bytes, without
+  /// reading the whole body into memory.
+  ///
+  /// Both readers pull from this body on demand and share a ring buffer of
+  /// `capacity` bytes, which holds the bytes one reader has seen and the other
+  /// hasn't yet. The readers must therefore be consumed in an interleaved
+  /// fashion: reading one reader more than `capacity` bytes ahead of the other
+  /// is an error. Destroying or detaching one reader lifts the limit for the
+  /// other.
+  ///
+  /// # Examples
+  ///
+  /// ```cpp
+  /// auto [a, b] = Request::from_client().take_body().tee();
+  /// std::array<uint8_t, 4096> buf;
+  /// while (auto n{a.read(buf.data(), buf.size()).value()}) {
+  ///   hash.update(buf.data(), n);
+  ///   b.read(buf.data(), n).value();
+  ///   sink.write(buf.data(), n);
+  /// }
+  /// ```
+  std::pair<TeeReader, TeeReader> tee(size_t capacity = 64 * 1024) &&;
+
+  /// Read this body locally while forwarding every byte that is read into
+  /// `sink`.
+  ///
+  /// Bytes are written to `sink` as they are pulled from this body. Once the
+  /// local consumer has seen enough, `TeeReader::detach()` hands the rest of
+  /// the body to `sink` on the host without copying it through this program.
+  /// `sink` must outlive the returned reader, and is not finished by it.
+  ///
+  /// # Examples
+  ///
+  /// ```cpp
+  /// auto resp{Request::get("https://example.com/").send("backend").value()};
+  /// auto body{resp.take_body()};
+  /// auto client_body{resp.stream_to_client()};
+  /// auto reader{std::move(body).tee(client_body)};
+  /// std::string first_line;
+  /// std::getline(reader, first_line);
+  /// reader.detach().value();
+  /// client_body.finish().value();
+  /// ```
+  TeeReader tee(StreamingBody &sink) &&;
+
   /// Take the entire body as a string.
   std::string take_body_string() {
     return std::string(std::istreambuf_iterator<char>(this->rdbuf()),
@@ -133,6 +199,8 @@ private:
   rust::Box<fastly::sys::http::Body> bod;
   std::array<char, 512> pbuf;
   std::array<char, 512> gbuf;
+  // The `http::timing` record of the backend response this body belongs to.
+  std::optional<uint32_t> timing_;
   Body(rust::Box<fastly::sys::http::Body> body)
       : std::iostream(this), bod(std::move(body)) {
     this->setg(this->gbuf.data(), this->gbuf.data(), this->gbuf.data());
@@ -157,6 +225,9 @@ private:
 class StreamingBody : public std::ostream, public std::streambuf {
   friend Response;
   friend Request;
+  friend cache::core::InsertBuilder;
+  friend cache::core::TransactionInsertBuilder;
+  friend kv_store::LookupResponse;
   friend std::pair<fastly::expected<Response>,
                    std::vector<request::PendingRequest>>
   request::select(std::vector<request::PendingRequest> &reqs);
@@ -168,9 +239,13 @@ protected:
 public:
   StreamingBody(StreamingBody &&other)
       : std::ostream(this), bod((other.sync(), std::move(other.bod))),
-        pbuf(std::move(other.pbuf)) {
+        pbuf(std::move(other.pbuf)), to_client_(other.to_client_) {
     this->setp(this->pbuf.data(), this->pbuf.data() + this->pbuf.max_size());
   };
+  /// Finish writing to the body.
+  ///
+  /// For the client response body returned by `Response::stream_to_client()`,
+  /// this also drains the `fastly::background` queue.
   fastly::expected<void> finish();
   void append(Body other);
   fastly::expected<size_t> write(uint8_t *buf, size_t bufsize);
@@ -186,6 +261,47 @@ private:
   };
   rust::Box<fastly::sys::http::StreamingBody> bod;
   std::array<char, 512> pbuf;
+  // Whether this is the body of the response sent to the client.
+  bool to_client_{false};
+};
+
+/// A reader over one side of a body split with `Body::tee()`.
+///
+/// The reader can be used through its `std::istream` interface, which reads
+/// straight out of the shared ring buffer, or with `TeeReader::read()` for a
+/// non-aborting interface.
+class TeeReader : public std::istream, public std::streambuf {
+  friend Body;
+
+protected:
+  int underflow();
+
+public:
+  TeeReader(TeeReader &&old);
+  ~TeeReader();
+
+  /// Read bytes into `buf`, and return the number of bytes read. Bytes read
+  /// will be `0` once the whole body has been read.
+  ///
+  /// Returns an error if the underlying body could not be read, if forwarding
+  /// to a `StreamingBody` failed, or if this reader is `capacity` bytes ahead
+  /// of the other reader of a two-way tee.
+  fastly::expected<size_t> read(uint8_t *buf, size_t bufsize);
+
+  /// Stop reading from this reader.
+  ///
+  /// For a reader returned by `Body::tee(StreamingBody&)`, the part of the body
+  /// that hasn't been read yet is appended to the streaming body on the host.
+  /// For a reader of a two-way tee, the other reader is no longer limited by
+  /// this one.
+  fastly::expected<void> detach();
+
+private:
+  TeeReader(std::shared_ptr<fastly::detail::TeeState> state, size_t id);
+  fastly::expected<bool> refill();
+
+  std::shared_ptr<fastly::detail::TeeState> state_;
+  size_t id_;
 };
 
 } // namespace fastly::http
@@ -0,0 +1,175 @@
+#ifndef FASTLY_HTTP_CIRCUIT_H
+#define FASTLY_HTTP_CIRCUIT_H
+
+#include <chrono>
+#include <cstdint>
+#include <fastly/backend.h>
+#include <fastly/error.h>
+#include <fastly/http/request.h>
+#include <fastly/http/response.h>
+#include <fastly/http/status_code.h>
+#include <fastly/kv_store.h>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Circuit breakers for backend sends.
+///
+/// Every Compute instance starts from scratch, so without shared state each
+/// new request to a failing origin waits out the full connect or first-byte
+/// timeout again. A `CircuitBreaker` keeps the failure count and circuit state
+/// of each backend in a KV store shared by all instances. Once a backend has
+/// failed often enough, its circuit opens and sends to it fail immediately
+/// with `FastlyErrorCode::CircuitOpen`, or go to a fallback backend, until a
+/// single probe request is allowed through to test whether it has recovered.
+///
+/// The state is read from the KV store once per backend and execution, and
+/// only written when a failure is recorded or the circuit changes state. Each
+/// write applies its change to the state stored at that moment, and is retried
+/// if another instance wrote in between, so concurrent failures are all
+/// counted. If the store can't be opened or written, the breaker still works
+/// within the current execution. KV stores are eventually consistent, so
+/// instances may briefly disagree about the state of a circuit.
+///
+/// # Example
+///
+/// ```cpp
+/// fastly::http::circuit::CircuitBreaker breaker{
+///     "circuits", fastly::http::circuit::CircuitPolicy()
+///                     .failure_threshold(5)
+///                     .open_duration(std::chrono::seconds(30))
+///                     .fallback("backup_origin")};
+/// auto resp{breaker.send(fastly::Request::from_client(), "origin")};
+/// ```
+namespace fastly::http::circuit {
+
+/// The state of a backend's circuit.
+enum class State {
+  /// Requests go through, and failures are counted.
+  Closed,
+  /// Requests fail immediately.
+  Open,
+  /// One probe request is allowed through. Its outcome closes the circuit or
+  /// opens it again.
+  HalfOpen,
+};
+
+class CircuitBreaker;
+
+/// Describes when a circuit opens and for how long.
+///
+/// The defaults open a circuit after 5 failures within 10 seconds, keep it
+/// open for 30 seconds, and count send errors as well as `502`/`503`/`504`
+/// responses as failures.
+class CircuitPolicy {
+  friend CircuitBreaker;
+
+public:
+  CircuitPolicy();
+
+  /// Number of failures within `failure_window` that opens the circuit.
+  CircuitPolicy failure_threshold(uint32_t failures) &&;
+
+  /// Period over which failures are counted.
+  CircuitPolicy failure_window(std::chrono::milliseconds window) &&;
+
+  /// How long a circuit stays open before a probe request is let through.
+  CircuitPolicy open_duration(std::chrono::milliseconds duration) &&;
+
+  /// Response statuses that count as failures. Replaces the default set.
+  CircuitPolicy failure_statuses(std::vector<StatusCode> statuses) &&;
+
+  /// Backend to send requests to while a circuit is open, instead of failing
+  /// them. The fallback has a circuit of its own.
+  CircuitPolicy fallback(std::string_view backend_name) &&;
+
+  /// Prefix of the KV store keys holding circuit state. Defaults to
+  /// `"circuit/"`.
+  CircuitPolicy key_prefix(std::string_view prefix) &&;
+
+private:
+  uint32_t failure_threshold_;
+  std::chrono::milliseconds failure_window_;
+  std::chrono::milliseconds open_duration_;
+  std::vector<StatusCode> failure_statuses_;
+  std::optional<std::string> fallback_;
+  std::string key_prefix_;
+};
+
+/// Tracks the circuits of any number of backends in one KV store.
+class CircuitBreaker {
+public:
+  /// Create a breaker that shares circuit state through the KV store named
+  /// `kv_store_name`.
+  explicit CircuitBreaker(std::string_view kv_store_name,
+                          CircuitPolicy policy = CircuitPolicy());
+
+  /// The current state of the circuit for `backend_name`.
+  State state(std::string_view backend_name);
+
+  /// Whether a request may be sent to `backend_name` now. When an open
+  /// circuit is due for a probe, the first caller gets `true` and the circuit
+  /// becomes half-open.
+  bool allow(std::string_view backend_name);
+
+  /// Record a successful request to `backend_name`.
+  void record_success(std::string_view backend_name);
+
+  /// Record a failed request to `backend_name`.
+  void record_failure(std::string_view backend_name);
+
+  /// Record the outcome of a request to `backend_name`, classifying it
+  /// according to the policy.
+  void record(std::string_view backend_name,
+              fastly::expected<Response> &result);
+
+  /// Send a request through the circuit of `backend`, recording its outcome.
+  ///
+  /// If the circuit is open, the request goes to the policy's fallback if
+  /// there is one and its circuit allows it, and otherwise fails with
+  /// `FastlyErrorCode::CircuitOpen` without contacting any backend.
+  fastly::expected<Response> send(Request req,
+                                  fastly::backend::Backend &backend);
+  fastly::expected<Response> send(Request req, std::string_view backend_name);
+
+  /// Begin sending a request through the circuit of `backend`, like
+  /// `CircuitBreaker::send()`. The outcome isn't known until the
+  /// `PendingRequest` completes, so it must be passed to
+  /// `CircuitBreaker::record()` with the name of the backend that answered.
+  fastly::expected<request::PendingRequest>
+  send_async(Request req, fastly::backend::Backend &backend);
+  fastly::expected<request::PendingRequest>
+  send_async(Request req, std::string_view backend_name);
+
+private:
+  struct Circuit {
+    State state{State::Closed};
+    uint32_t failures{0};
+    int64_t window_start{0};
+    int64_t opened_at{0};
+    // Whether this execution holds the half-open probe.
+    bool probing{false};
+  };
+
+  static bool parse(std::string_view text, Circuit &circuit);
+  static std::string serialize(const Circuit &circuit);
+  Circuit &load(std::string_view backend_name);
+  // Apply `change` to the circuit, and write it to the store if `change`
+  // returns `true`.
+  void save(std::string_view backend_name,
+            const std::function<bool(Circuit &)> &change);
+  // The backend to send to instead of `backend_name`, or an error if the
+  // circuit is open and no fallback can take the request.
+  fastly::expected<std::string> route(std::string_view backend_name);
+
+  CircuitPolicy policy_;
+  std::optional<fastly::kv_store::KVStore> store_;
+  std::map<std::string, Circuit, std::less<>> circuits_;
+};
+
+} // namespace fastly::http::circuit
+
+#endif
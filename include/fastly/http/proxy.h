@@ -0,0 +1,75 @@
+#ifndef FASTLY_HTTP_PROXY_H
+#define FASTLY_HTTP_PROXY_H
+
+#include <cstdint>
+#include <fastly/backend.h>
+#include <fastly/error.h>
+#include <fastly/http/request.h>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace fastly::http {
+
+/// Options for `proxy_streaming()`.
+class ProxyOptions {
+  friend fastly::expected<request::PendingRequest>
+  proxy_streaming(Request client_req, fastly::backend::Backend &backend,
+                  ProxyOptions options);
+
+public:
+  /// The type of the inspection hook. It is called with each block of the
+  /// body before that block is forwarded, and returns `false` to abort the
+  /// upload.
+  using inspect_type = std::function<bool(std::span<const uint8_t>)>;
+
+  ProxyOptions() = default;
+
+  /// Size of the blocks the body is read and forwarded in when an inspection
+  /// hook is set. Defaults to 64KiB.
+  ProxyOptions block_size(size_t size) &&;
+
+  /// Set a hook that sees every block of the body before it is forwarded.
+  ProxyOptions inspect(inspect_type hook) &&;
+
+private:
+  size_t block_size_{64 * 1024};
+  std::optional<inspect_type> inspect_;
+};
+
+/// Forward a request, typically the client request, to a backend while its
+/// body is still arriving, and return the pending backend response.
+///
+/// Without an inspection hook, the body is handed to the backend request on
+/// the host and never passes through this program. With a hook, the body is
+/// read in `ProxyOptions::block_size()` blocks, each block is passed to the
+/// hook and then written to the backend, so memory use stays constant no
+/// matter how large the upload is.
+///
+/// If the hook returns `false`, the upload is abandoned without finishing the
+/// backend request body, and an error is returned.
+///
+/// # Examples
+///
+/// ```cpp
+/// size_t total{0};
+/// auto pending{fastly::http::proxy_streaming(
+///     Request::from_client(), "example_backend",
+///     fastly::http::ProxyOptions().inspect(
+///         [&total](std::span<const uint8_t> block) {
+///           total += block.size();
+///           return total <= max_upload_size;
+///         }))};
+/// pending.value().wait().value().send_to_client();
+/// ```
+fastly::expected<request::PendingRequest>
+proxy_streaming(Request client_req, fastly::backend::Backend &backend,
+                ProxyOptions options = ProxyOptions());
+fastly::expected<request::PendingRequest>
+proxy_streaming(Request client_req, std::string_view backend_name,
+                ProxyOptions options = ProxyOptions());
+
+} // namespace fastly::http
+
+#endif
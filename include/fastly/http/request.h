@@ -2,16 +2,23 @@
 #define FASTLY_HTTP_REQUEST_H
 
 #include <algorithm>
+#include <chrono>
+#include <concepts>
 #include <fastly/backend.h>
 #include <fastly/detail/access_bridge_internals.h>
+#include <fastly/detail/in_flight.h>
+#include <fastly/detail/rust_bridge_tags.h>
 #include <fastly/error.h>
 #include <fastly/http/body.h>
 #include <fastly/http/header.h>
 #include <fastly/http/http.h>
 #include <fastly/http/response.h>
+#include <fastly/http/status_code.h>
 #include <fastly/sdk-sys.h>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -23,6 +30,14 @@ namespace fastly::backend {
 class Backend;
 }
 
+namespace fastly::async_io {
+class WaitSet;
+}
+
+namespace fastly::director {
+class Director;
+}
+
 namespace fastly::http {
 
 class Body;
@@ -46,6 +61,7 @@ class PendingRequest {
   friend std::pair<fastly::expected<Response>, std::vector<PendingRequest>>
   select(std::vector<PendingRequest> &reqs);
 
+public:
   /// Try to get the result of a pending request without blocking.
   ///
   /// This method returns immediately with a `std::variant` containing either
@@ -66,8 +82,23 @@ class PendingRequest {
   Request cloned_sent_req();
 
 private:
+  friend fastly::director::Director;
+  friend fastly::async_io::WaitSet;
+
   auto &inner() { return req; }
   rust::Box<fastly::sys::http::request::PendingRequest> req;
+  std::shared_ptr<fastly::detail::InFlight> in_flight_;
+  std::optional<uint32_t> timing_;
+
+  // Complete the `http::timing` record `id`, if any, with `result`.
+  static void record_timing(std::optional<uint32_t> id,
+                            fastly::expected<Response> &result);
+
+  // Block until one of `reqs` is ready, and remove it from `reqs`, returning
+  // its position and its result. The rest keep their order. If the wait itself
+  // fails, nothing is removed and the position is `reqs.size()`.
+  static std::pair<std::size_t, fastly::expected<Response>>
+  select_index(std::vector<PendingRequest> &reqs);
 
   PendingRequest(rust::Box<fastly::sys::http::request::PendingRequest> r)
       : req(std::move(r)) {};
@@ -81,8 +112,7 @@ private:
 /// - `result` is the result of the request that became ready.
 ///
 /// - `remaining` is a vector containing all of the requests that did not become
-/// ready. The order of the requests in this vector is not guaranteed to match
-/// the order of the requests in the argument collection.
+/// ready, in the order they were given in.
 ///
 /// ### Panics
 ///
@@ -92,6 +122,143 @@ select(std::vector<PendingRequest> &reqs);
 
 } // namespace request
 
+/// A backend response that is about to be stored in the HTTP cache, as seen by
+/// an `AfterSendFn`.
+///
+/// Changes made here affect both what is cached and what `Request::send()`
+/// returns. This only borrows the response, and must not outlive the hook it
+/// is passed to.
+class CandidateResponse {
+public:
+  explicit CandidateResponse(fastly::sys::http::CandidateResponse &res)
+      : res(res) {}
+  CandidateResponse(const CandidateResponse &) = delete;
+  CandidateResponse &operator=(const CandidateResponse &) = delete;
+
+  /// Cache the response, even if its headers say not to.
+  void set_cacheable();
+
+  /// Don't cache the response. If `record_uncacheable` is `true`, requests
+  /// for the same object over the next few minutes skip request collapsing
+  /// and go straight to the backend, as they would for a pass.
+  void set_uncacheable(bool record_uncacheable = false);
+
+  /// Set the time for which the response is fresh, overriding its headers.
+  void set_ttl(std::chrono::milliseconds ttl);
+
+  /// Set the time for which the response can be served stale while it is
+  /// being revalidated, overriding its headers.
+  void set_stale_while_revalidate(std::chrono::milliseconds swr);
+
+  /// Enable or disable PCI/HIPAA-compliant non-volatile caching.
+  void set_pci(bool pci);
+
+  /// Get a response header. Surrogate keys can be changed by setting the
+  /// `Surrogate-Key` header.
+  fastly::expected<std::optional<HeaderValue>>
+  get_header(std::string_view name) const;
+  fastly::expected<void> set_header(std::string_view name,
+                                    std::string_view value);
+  fastly::expected<void> append_header(std::string_view name,
+                                       std::string_view value);
+  fastly::expected<std::optional<std::string>>
+  remove_header(std::string_view name);
+
+  /// Get the HTTP status code of the response.
+  StatusCode get_status() const;
+
+  /// Set the HTTP status code of the response.
+  void set_status(StatusCode status);
+
+private:
+  fastly::sys::http::CandidateResponse &res;
+};
+
+/// A hook run on a request just before it is sent to a backend, set with
+/// `Request::set_before_send()`.
+///
+/// It is only run if the request is actually sent, and not if the response is
+/// served from the cache. The request may be modified, but not moved from or
+/// replaced, since the hook only borrows it.
+class BeforeSendFn : public detail::rust_bridge_tags::http::BeforeSendFnTag {
+public:
+  /// The type of the hook function.
+  using function_type = std::function<void(Request &)>;
+
+  template <std::convertible_to<function_type> F>
+  BeforeSendFn(F &&fn) : fn_(std::forward<F>(fn)) {}
+
+private:
+  friend detail::AccessBridgeInternals;
+  auto &inner() const { return fn_; }
+  function_type fn_;
+};
+
+/// A hook run on a response from a backend before it is stored in the HTTP
+/// cache, set with `Request::set_after_send()`.
+///
+/// It can change how long the response is cached for, or whether it is cached
+/// at all, based on the response itself.
+class AfterSendFn : public detail::rust_bridge_tags::http::AfterSendFnTag {
+public:
+  /// The type of the hook function.
+  using function_type = std::function<void(CandidateResponse &)>;
+
+  template <std::convertible_to<function_type> F>
+  AfterSendFn(F &&fn) : fn_(std::forward<F>(fn)) {}
+
+private:
+  friend detail::AccessBridgeInternals;
+  auto &inner() const { return fn_; }
+  function_type fn_;
+};
+
+/// A set of overrides of the caching behavior of a request, which can be
+/// built once and applied to any number of requests with
+/// `Request::set_cache_override()`.
+///
+/// The settings are as for the individual setters, such as
+/// `Request::set_ttl()`.
+///
+/// # Example
+///
+/// ```cpp
+/// auto policy{fastly::http::CacheOverride::ttl(300)
+///                 .with_stale_while_revalidate(60)};
+/// req.set_cache_override(policy);
+/// ```
+class CacheOverride {
+public:
+  /// No override: the response headers decide.
+  static CacheOverride none();
+
+  /// Don't cache the response.
+  static CacheOverride pass();
+
+  /// Cache the response for `ttl` seconds.
+  static CacheOverride ttl(uint32_t ttl);
+
+  /// As with the `Request` setters, setting any of these clears a pass.
+  CacheOverride with_ttl(uint32_t ttl) &&;
+  CacheOverride with_stale_while_revalidate(uint32_t swr) &&;
+  CacheOverride with_pci(bool pci) &&;
+  CacheOverride with_surrogate_key(std::string_view sk) &&;
+
+  CacheOverride clone() const;
+
+  bool is_pass() const;
+  std::optional<uint32_t> get_ttl() const;
+  std::optional<uint32_t> get_stale_while_revalidate() const;
+  bool get_pci() const;
+  std::optional<std::string> get_surrogate_key() const;
+
+private:
+  friend Request;
+  CacheOverride(rust::Box<fastly::sys::http::CacheOverride> co)
+      : co_(std::move(co)) {}
+  rust::Box<fastly::sys::http::CacheOverride> co_;
+};
+
 /// An HTTP request, including body, headers, method, and URL.
 ///
 /// # Getting the client request
@@ -301,6 +468,15 @@ public:
   fastly::expected<request::PendingRequest>
   send_async(std::string_view backend_name);
 
+  /// Send the request to a backend chosen by `director`.
+  ///
+  /// See `fastly::director::Director` for how backends are chosen.
+  fastly::expected<Response> send(fastly::director::Director &director);
+
+  /// Begin sending the request to a backend chosen by `director`.
+  fastly::expected<request::PendingRequest>
+  send_async(fastly::director::Director &director);
+
   /// Begin sending the request to the given backend server, and return a
   /// `PendingRequest` that
   /// can yield the backend response or an error along with a `StreamingBody`
@@ -665,6 +841,42 @@ public:
   /// the backend.
   fastly::expected<void> set_surrogate_key(std::string_view sk);
 
+  /// Builder-style equivalent of `Request::set_cache_override()`.
+  fastly::expected<Request> with_cache_override(const CacheOverride &co) &&;
+
+  /// Replace all of the caching overrides of this request with `co`.
+  ///
+  /// Unlike the individual setters, this also clears any overrides that `co`
+  /// doesn't set.
+  fastly::expected<void> set_cache_override(const CacheOverride &co);
+
+  /// Builder-style equivalent of `Request::set_before_send()`.
+  Request with_before_send(BeforeSendFn fn) &&;
+
+  /// Run `fn` on the request just before it is sent to the backend, which
+  /// only happens if it can't be answered from the cache.
+  ///
+  /// This is the place to add headers that are only needed by the backend,
+  /// such as authentication, so that computing them is skipped on cache hits.
+  void set_before_send(BeforeSendFn fn);
+
+  /// Builder-style equivalent of `Request::set_after_send()`.
+  Request with_after_send(AfterSendFn fn) &&;
+
+  /// Run `fn` on the response from the backend before it is stored in the
+  /// cache, to decide whether and for how long to cache it.
+  ///
+  /// # Example
+  ///
+  /// ```cpp
+  /// req.set_after_send([](fastly::http::CandidateResponse &resp) {
+  ///   if (resp.get_status() != fastly::http::StatusCode::OK) {
+  ///     resp.set_uncacheable();
+  ///   }
+  /// });
+  /// ```
+  void set_after_send(AfterSendFn fn);
+
   std::optional<std::string> get_client_ip_addr();
   std::optional<std::string> get_server_ip_addr();
 
@@ -707,9 +919,19 @@ public:
   /// `Request::set_auto_decompress_gzip()`.
   Request with_auto_decompress_gzip(bool gzip) &&;
 
-  // TODO(@zkat): needs enum
-  // void set_framing_headers_mode(FramingHeadersMode mode);
-  // Request *set_framing_headers_mode(FramingHeadersMode mode);
+  /// Set how the framing headers (`Content-Length` and `Transfer-Encoding`)
+  /// of this request are determined when it is sent to a backend.
+  ///
+  /// With `FramingHeadersMode::Automatic`, the default, any framing headers
+  /// set on the request are replaced according to how its body is sent. With
+  /// `FramingHeadersMode::ManuallyFromHeaders`, the framing headers already on
+  /// the request are used as they are, so a body of known length can be
+  /// streamed with `Request::send_async_streaming()` without chunked encoding.
+  /// If the headers are missing or invalid, automatic framing is used instead.
+  void set_framing_headers_mode(FramingHeadersMode mode);
+
+  /// Builder-style equivalent of `Request::set_framing_headers_mode()`.
+  Request with_framing_headers_mode(FramingHeadersMode mode) &&;
 
   /// Returns whether or not the client request had a `Fastly-Key` header
   /// which is valid for purging content for the service.
@@ -718,8 +940,36 @@ public:
   /// this request.
   bool fastly_key_is_valid();
 
-  // void handoff_websocket(fastly::backend::Backend backend);
-  // void handoff_fanout(fastly::backend::Backend backend);
+  /// Pass the WebSocket connection of this client request directly to a
+  /// backend.
+  ///
+  /// The platform takes over proxying the connection, so this program can
+  /// exit without keeping the instance alive for the lifetime of the
+  /// connection. This consumes the request, and must be used on the client
+  /// request of a WebSocket upgrade.
+  ///
+  /// # Examples
+  ///
+  /// ```cpp
+  /// auto req{Request::from_client()};
+  /// auto upgrade{req.get_header("Upgrade").value()};
+  /// if (upgrade && upgrade->string() == "websocket") {
+  ///   req.handoff_websocket("example_backend").value();
+  ///   return 0;
+  /// }
+  /// ```
+  fastly::expected<void> handoff_websocket(fastly::backend::Backend &backend);
+  fastly::expected<void> handoff_websocket(std::string_view backend_name);
+
+  /// Pass this client request to the Fanout GRIP proxy, which forwards it to
+  /// the given backend and then holds the connection for real-time
+  /// publishing.
+  ///
+  /// Like `Request::handoff_websocket()`, this consumes the request and
+  /// releases the instance from holding the connection.
+  fastly::expected<void> handoff_fanout(fastly::backend::Backend &backend);
+  fastly::expected<void> handoff_fanout(std::string_view backend_name);
+
   // Request *on_behalf_of(std::string_view service);
 
   /// Set the cache key to be used when attempting to satisfy this request
@@ -308,6 +308,9 @@ public:
   fastly::expected<std::optional<std::string>>
   remove_header(std::string_view name);
 
+  /// Get the HTTP status code of the response.
+  StatusCode get_status();
+
   /// Builder-style equivalent of `Response::set_status()`.
   Response with_status(StatusCode status) &&;
 
@@ -341,9 +344,30 @@ public:
   /// Set the HTTP version of this response.
   void set_version(Version version);
 
-  // TODO(@zkat): needs enum
-  // void set_framing_headers_mode(FramingHeadersMode mode);
-  // Response set_framing_headers_mode(FramingHeadersMode mode);
+  /// Set how the framing headers (`Content-Length` and `Transfer-Encoding`)
+  /// of this response are determined when it is sent to the client.
+  ///
+  /// With `FramingHeadersMode::Automatic`, the default, any framing headers
+  /// set on the response are replaced according to how its body is sent. With
+  /// `FramingHeadersMode::ManuallyFromHeaders`, the framing headers already on
+  /// the response are used as they are. This lets a backend response that is
+  /// passed through with `Response::stream_to_client()` keep the backend's
+  /// `Content-Length` instead of being sent with chunked encoding. If the
+  /// headers are missing or invalid, automatic framing is used instead.
+  ///
+  /// # Examples
+  ///
+  /// ```cpp
+  /// auto resp{Request::from_client().send("example_backend").value()};
+  /// resp.set_framing_headers_mode(
+  ///     fastly::http::FramingHeadersMode::ManuallyFromHeaders);
+  /// auto client_body{resp.stream_to_client()};
+  /// client_body.finish().value();
+  /// ```
+  void set_framing_headers_mode(FramingHeadersMode mode);
+
+  /// Builder-style equivalent of `Response::set_framing_headers_mode()`.
+  Response with_framing_headers_mode(FramingHeadersMode mode) &&;
 
   /// Get the name of the `Backend` this response came from, or `std::nullopt`
   /// if the response is synthetic.
@@ -453,6 +477,9 @@ public:
   /// body. To stream additional data to a response body after it begins to
   /// send, use `Response::stream_to_client()`.
   ///
+  /// Work queued in `fastly::background` is drained once the response has
+  /// begun sending, so this may not return immediately if any is queued.
+  ///
   /// # Panics
   ///
   /// This method panics if another response has already been sent to the client
@@ -560,6 +587,9 @@ private:
   Response(rust::Box<fastly::sys::http::Response> response)
       : res(std::move(response)) {};
   rust::Box<fastly::sys::http::Response> res;
+  // The `http::timing` record of this response, if it came from a backend
+  // while timing was enabled.
+  std::optional<uint32_t> timing_;
 };
 
 } // namespace fastly::http
@@ -0,0 +1,165 @@
+#ifndef FASTLY_HTTP_RETRY_H
+#define FASTLY_HTTP_RETRY_H
+
+#include <chrono>
+#include <cstdint>
+#include <fastly/backend.h>
+#include <fastly/error.h>
+#include <fastly/http/request.h>
+#include <fastly/http/response.h>
+#include <fastly/http/status_code.h>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+/// Retrying backend sends.
+///
+/// `Request::send()` consumes the request, so retrying a request by hand means
+/// calling `Request::clone_with_body()` before every attempt, which reads and
+/// copies the whole body even when the first attempt succeeds. The functions in
+/// this namespace instead stream the body to the backend on the first attempt
+/// while keeping a replay copy on the side, and only build a new request from
+/// that copy if a retry actually happens.
+///
+/// # Example
+///
+/// ```cpp
+/// auto policy{fastly::http::retry::RetryPolicy()
+///                 .max_attempts(3)
+///                 .initial_backoff(std::chrono::milliseconds(20))
+///                 .time_budget(std::chrono::milliseconds(2000))};
+/// auto resp{fastly::http::retry::send(fastly::Request::from_client(),
+///                                     "example_backend", policy)};
+/// ```
+namespace fastly::http::retry {
+
+class PendingRetry;
+
+/// Describes when, and how often, a backend send should be retried.
+///
+/// The defaults retry idempotent requests up to 3 times in total on
+/// `502`/`503`/`504` responses and on send errors, with an exponential backoff
+/// starting at 50ms and capped at 1s.
+class RetryPolicy {
+  friend PendingRetry;
+
+public:
+  RetryPolicy();
+
+  /// Total number of attempts, including the first one. A value of `1`
+  /// disables retries.
+  RetryPolicy max_attempts(uint32_t attempts) &&;
+
+  /// Delay before the first retry.
+  RetryPolicy initial_backoff(std::chrono::milliseconds backoff) &&;
+
+  /// Upper bound for the delay between two attempts.
+  RetryPolicy max_backoff(std::chrono::milliseconds backoff) &&;
+
+  /// Factor the delay grows by after each retry.
+  RetryPolicy backoff_multiplier(double multiplier) &&;
+
+  /// Whether to randomize each delay between half and all of its nominal
+  /// value, so that many instances retrying at once don't synchronize.
+  /// Enabled by default.
+  RetryPolicy jitter(bool enable) &&;
+
+  /// Overall time allowed for all attempts, measured from the initial send.
+  /// No retry is started if its backoff would end past this budget.
+  RetryPolicy time_budget(std::chrono::milliseconds budget) &&;
+
+  /// Response statuses that cause a retry. Replaces the default set.
+  RetryPolicy retry_on_status(std::vector<StatusCode> statuses) &&;
+
+  /// Error codes that cause a retry. Replaces the default set, which only
+  /// contains `FastlyErrorCode::FastlySendError`.
+  RetryPolicy retry_on_error(std::vector<FastlyErrorCode> codes) &&;
+
+  /// Whether requests with non-idempotent methods (`POST`, `PATCH`,
+  /// `CONNECT`) may be retried. Disabled by default.
+  RetryPolicy retry_non_idempotent(bool enable) &&;
+
+  /// Largest request body that will be kept for replaying. Bodies larger than
+  /// this are still sent, but the request is not retried. Defaults to 1MiB.
+  RetryPolicy max_replay_bytes(size_t bytes) &&;
+
+private:
+  uint32_t max_attempts_;
+  std::chrono::milliseconds initial_backoff_;
+  std::chrono::milliseconds max_backoff_;
+  double backoff_multiplier_;
+  bool jitter_;
+  std::optional<std::chrono::milliseconds> time_budget_;
+  std::vector<StatusCode> statuses_;
+  std::vector<FastlyErrorCode> errors_;
+  bool retry_non_idempotent_;
+  size_t max_replay_bytes_;
+};
+
+/// A backend send that may still be retried, returned by `retry::send_async()`.
+///
+/// Like `request::PendingRequest`, it can be evaluated with
+/// `PendingRetry::poll()` or `PendingRetry::wait()`. Backoff delays between
+/// attempts only block in `PendingRetry::wait()`; `PendingRetry::poll()`
+/// returns the pending handle until the next attempt is due.
+class PendingRetry {
+  friend fastly::expected<PendingRetry>
+  send_async(Request req, fastly::backend::Backend &backend,
+             const RetryPolicy &policy);
+
+public:
+  /// Try to get the final result without blocking, starting the next attempt
+  /// if one is due.
+  std::variant<PendingRetry, fastly::expected<Response>> poll();
+
+  /// Block until the final result is ready, sleeping through backoff delays.
+  fastly::expected<Response> wait();
+
+  /// Number of attempts started so far.
+  uint32_t attempts() const { return attempt_; }
+
+private:
+  PendingRetry(Request tmpl, fastly::backend::Backend backend,
+               RetryPolicy policy);
+
+  fastly::expected<void> start(Request req);
+  fastly::expected<void> launch();
+  bool should_retry(fastly::expected<Response> &result);
+
+  Request template_;
+  fastly::backend::Backend backend_;
+  RetryPolicy policy_;
+  std::vector<uint8_t> replay_;
+  bool replayable_{true};
+  uint32_t attempt_{0};
+  std::chrono::steady_clock::time_point started_;
+  std::chrono::steady_clock::time_point next_attempt_at_;
+  std::optional<request::PendingRequest> pending_;
+};
+
+/// Send a request to a backend, retrying according to `policy`.
+///
+/// Returns the first response that is not retryable, or the last response or
+/// error once the attempts or the time budget are exhausted.
+fastly::expected<Response> send(Request req, fastly::backend::Backend &backend,
+                                const RetryPolicy &policy = RetryPolicy());
+fastly::expected<Response> send(Request req, std::string_view backend_name,
+                                const RetryPolicy &policy = RetryPolicy());
+
+/// Begin sending a request to a backend, returning a `PendingRetry` that
+/// retries according to `policy` as it is polled or waited on.
+///
+/// If the request has a body, it is streamed to the backend before this
+/// function returns, so that a replay copy can be kept without a second read.
+/// If reading the body fails, the upload is aborted and the error returned.
+fastly::expected<PendingRetry>
+send_async(Request req, fastly::backend::Backend &backend,
+           const RetryPolicy &policy = RetryPolicy());
+fastly::expected<PendingRetry>
+send_async(Request req, std::string_view backend_name,
+           const RetryPolicy &policy = RetryPolicy());
+
+} // namespace fastly::http::retry
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef FASTLY_HTTP_TIMING_H
+#define FASTLY_HTTP_TIMING_H
+
+#include <chrono>
+#include <cstdint>
+#include <fastly/error.h>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fastly::http {
+class Response;
+}
+
+/// Opt-in timing of backend sends.
+///
+/// Once enabled with `timing::enable()`, every `Request::send()`,
+/// `Request::send_async()` and `Request::send_async_streaming()` records when
+/// the request was submitted, when its response headers were available, and
+/// when its response body was read to the end, along with the number of body
+/// bytes read. The records can be inspected with `timing::records()`, added to
+/// the client response as a `Server-Timing` header, or logged to an endpoint,
+/// for example to tune `first_byte_timeout` and `between_bytes_timeout` per
+/// backend.
+///
+/// Times are observed from the program, not by the host: for a
+/// `PendingRequest` that is polled, the response time is the first poll that
+/// found it ready, and a body is only complete once the program has read all
+/// of it. Connection setup is not visible separately from time to first byte.
+///
+/// # Examples
+///
+/// ```cpp
+/// fastly::http::timing::enable();
+/// auto resp{fastly::Request::from_client().send("example_backend").value()};
+/// fastly::http::timing::add_server_timing(resp);
+/// fastly::http::timing::log_to("timings");
+/// resp.send_to_client();
+/// ```
+namespace fastly::http::timing {
+
+/// Timing of a single backend send.
+struct Record {
+  std::string backend;
+  std::string url;
+  std::chrono::steady_clock::time_point submitted;
+  /// When the response headers were available.
+  std::optional<std::chrono::steady_clock::time_point> response;
+  /// When the response body had been read to the end.
+  std::optional<std::chrono::steady_clock::time_point> body_complete;
+  /// The response status, or `std::nullopt` if the send failed or is still
+  /// pending.
+  std::optional<uint16_t> status;
+  bool failed{false};
+  /// Response body bytes read so far.
+  uint64_t bytes_received{0};
+
+  /// Time from submission to the response headers.
+  std::optional<std::chrono::microseconds> time_to_first_byte() const;
+  /// Time from submission to the end of the response body.
+  std::optional<std::chrono::microseconds> total_time() const;
+};
+
+/// Start or stop recording backend sends.
+void enable(bool enabled = true);
+
+/// Whether backend sends are currently being recorded.
+bool enabled();
+
+/// All sends recorded so far, in submission order.
+const std::vector<Record> &records();
+
+/// Forget all recorded sends.
+void clear();
+
+/// The recorded sends as a `Server-Timing` header value, with a time to first
+/// byte and, if the body was read to the end, a total time metric per send.
+std::string server_timing();
+
+/// Append the recorded sends to `resp` as a `Server-Timing` header.
+fastly::expected<void> add_server_timing(Response &resp);
+
+/// Log each recorded send as a JSON line to the named log endpoint.
+void log_to(std::string_view endpoint);
+
+namespace detail {
+// Hooks called by the request and body code of the SDK. These are intended
+// for internal use only.
+uint32_t submitted(std::string backend, std::string url);
+void responded(uint32_t id, fastly::expected<Response> &result);
+void body_read(uint32_t id, size_t bytes);
+} // namespace detail
+
+} // namespace fastly::http::timing
+
+#endif
@@ -1,12 +1,20 @@
 #ifndef FASTLY_KV_STORE_H
 #define FASTLY_KV_STORE_H
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <fastly/detail/rust_iterator_range.h>
 #include <fastly/error.h>
 #include <fastly/http/body.h>
 #include <fastly/sdk-sys.h>
 #include <functional>
+#include <iterator>
 #include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace fastly::kv_store {
 using fastly::sys::kv_store::KVStoreErrorCode;
@@ -16,6 +24,9 @@ public:
       : err_(rust::Box<fastly::sys::kv_store::KVStoreError>::from_raw(e)) {};
   KVStoreError(rust::Box<fastly::sys::kv_store::KVStoreError> e)
       : err_(std::move(e)) {};
+  /// An `ItemBadRequest` error, for values that can't be used as asked. A
+  /// non-empty `reason` is added to its message.
+  static KVStoreError item_bad_request(std::string_view reason = {});
   KVStoreErrorCode error_code();
   std::string error_msg();
 
@@ -85,11 +96,16 @@ struct PendingListHandle : public detail::KVPendingHandle<PendingListHandle> {
 };
 
 class LookupBuilder;
+class KVCodec;
 class LookupResponse {
   friend LookupBuilder;
 
 public:
   /// Returns the body, making the `LookupResponse` bodyless.
+  ///
+  /// This, `try_take_body()`, `take_body_bytes()` and `append_to()` return
+  /// the value as it is stored, so a value inserted with a `KVCodec` comes
+  /// back still encoded. Use `take_decoded_body()` to read it.
   Body take_body();
 
   /// Returns the body if it exists, making the `LookupResponse` bodyless.
@@ -100,12 +116,61 @@ public:
   /// bodyless.
   std::vector<uint8_t> take_body_bytes();
 
+  /// Returns the body, decoded if the value was inserted with a `KVCodec`,
+  /// making the `LookupResponse` bodyless. Returns an error if the value
+  /// can't be decoded, e.g. because its dictionary hasn't been loaded.
+  ///
+  /// The value is decoded a buffer at a time into a new body.
+  fastly::expected<Body> take_decoded_body();
+
   /// Reads the metadata of the `KVStore` item.
   std::optional<std::vector<std::uint8_t>> metadata() const;
 
   /// Reads the generation of the `KVStore` item.
   std::uint64_t current_generation() const;
 
+  /// The codec the value was inserted with, so that a new value can be
+  /// inserted the same way. Returns `std::nullopt` if it was inserted without
+  /// one, or with a dictionary that hasn't been loaded in this instance.
+  std::optional<KVCodec> codec() const;
+
+  /// Reads the decoded body from byte `offset` into `buf`, making the
+  /// `LookupResponse` bodyless. Returns the number of bytes read, which is
+  /// less than `buf.size()` only if the value ends first. Returns an error if
+  /// the body has already been taken.
+  ///
+  /// Only `buf.size()` bytes of the value are held in memory at a time, no
+  /// matter where `offset` is.
+  fastly::expected<std::size_t> read_range(std::uint64_t offset,
+                                           std::span<std::uint8_t> buf);
+
+  /// Writes `length` bytes of the decoded body, from byte `offset`, to `out`,
+  /// making the `LookupResponse` bodyless. If `length` is `std::nullopt`,
+  /// writes the rest of the value. Returns the number of bytes written, or an
+  /// error if the body has already been taken.
+  ///
+  /// The bytes are copied a small buffer at a time, without passing through
+  /// the caller, so that ranges of large values can be served in constant
+  /// memory.
+  ///
+  /// # Example
+  ///
+  /// ```cpp
+  /// auto found{store.lookup("video.mp4").value()};
+  /// auto stream{Response().with_status(206).stream_to_client()};
+  /// found.stream_range_to(stream, 1 << 20, 1 << 20);
+  /// stream.finish();
+  /// ```
+  fastly::expected<std::uint64_t>
+  stream_range_to(http::StreamingBody &out, std::uint64_t offset,
+                  std::optional<std::uint64_t> length = std::nullopt);
+
+  /// Appends the whole body to `out`, making the `LookupResponse` bodyless.
+  ///
+  /// The host moves the bytes itself, so this is the cheapest way of sending
+  /// a value to the client.
+  void append_to(http::StreamingBody &out);
+
 private:
   friend class KVStore;
   LookupResponse(rust::Box<fastly::sys::kv_store::LookupResponse> response)
@@ -113,6 +178,28 @@ private:
   rust::Box<fastly::sys::kv_store::LookupResponse> response_;
 };
 
+/// The metadata and generation of a `KVStore` item, looked up without its
+/// value. Returned by `KVStore::lookup_info()`.
+class LookupInfo {
+public:
+  /// A view of the metadata of the item, valid for as long as the
+  /// `LookupInfo`.
+  std::optional<std::span<const std::uint8_t>> metadata() const;
+
+  /// The metadata of the item, as a string view valid for as long as the
+  /// `LookupInfo`.
+  std::optional<std::string_view> metadata_str() const;
+
+  /// The generation of the item.
+  std::uint64_t current_generation() const;
+
+private:
+  friend class KVStore;
+  LookupInfo(rust::Box<fastly::sys::kv_store::LookupInfo> info)
+      : info_(std::move(info)) {}
+  rust::Box<fastly::sys::kv_store::LookupInfo> info_;
+};
+
 class LookupBuilder {
 public:
   /// Execute the lookup and wait for the response.
@@ -146,6 +233,49 @@ private:
 using InsertMode = fastly::sys::kv_store::InsertMode;
 
 class KVStore;
+/// A compression codec for values inserted with `InsertBuilder::codec()`.
+///
+/// The codec is recorded in front of the value's metadata, and left out of
+/// `LookupResponse::metadata()`. `LookupResponse::take_decoded_body()` and the
+/// ranged reads decode the value, and the other methods that read the body
+/// return it as stored. Decoding streams the value a buffer at a time, so it
+/// never has to fit in memory.
+///
+/// # Example
+///
+/// ```cpp
+/// static const auto codec{KVCodec::zstd()};
+/// store.build_insert().codec(codec).execute("page.html", std::move(body));
+/// // Reads the HTML, not the compressed bytes.
+/// auto html{store.lookup("page.html")->take_decoded_body().value()};
+/// ```
+class KVCodec {
+public:
+  /// zstd at the given compression level.
+  static KVCodec zstd(int level = 3);
+
+  /// LZ4, which compresses less than zstd but is faster.
+  static KVCodec lz4();
+
+  /// zstd with a trained dictionary, which compresses small, similar values,
+  /// such as JSON documents of the same shape, far better.
+  ///
+  /// The dictionary is prepared once, and registered for this instance under
+  /// `name`, which can't contain newlines. Values compressed with it can only
+  /// be read once a codec with the same name and dictionary has been created,
+  /// so create it once, before any lookups, and keep it, e.g. as a static.
+  static KVCodec zstd_with_dictionary(std::string_view name,
+                                      std::span<const std::uint8_t> dictionary,
+                                      int level = 3);
+
+private:
+  friend class InsertBuilder;
+  friend class LookupResponse;
+  KVCodec(rust::Box<fastly::sys::kv_store::KVCodec> codec)
+      : codec_(std::move(codec)) {}
+  rust::Box<fastly::sys::kv_store::KVCodec> codec_;
+};
+
 class InsertBuilder {
 public:
   /// Change the behavior in the case when the new key matches an existing key.
@@ -163,8 +293,15 @@ public:
   InsertBuilder if_generation_match(std::uint64_t gen) &&;
 
   /// Sets an arbitrary data field which can contain up to 2000B of data.
+  ///
+  /// Metadata starting with `fastly-codec:` is reserved for `codec()`. Unless
+  /// a codec is also set, inserting it fails with an `ItemBadRequest` error.
   InsertBuilder metadata(const std::string &data) &&;
 
+  /// Compress the value with `codec`. The codec takes up a few bytes of the
+  /// metadata.
+  InsertBuilder codec(const KVCodec &codec) &&;
+
   /// Sets a time for the key to expire. Deletion will take place up to 24 hours
   /// after the ttl reaches 0.
   InsertBuilder time_to_live(std::chrono::milliseconds ttl) &&;
@@ -192,6 +329,51 @@ struct ListModeOther {
 };
 using ListMode = std::variant<ListModeStrong, ListModeEventual, ListModeOther>;
 
+/// The keys of a `ListPage`, as views into the page itself, so that reading
+/// them needs no copies or allocations. The page must outlive them.
+class ListKeys {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = std::string_view;
+
+    iterator() = default;
+    std::string_view operator*() const { return {key_->data(), key_->size()}; }
+    iterator &operator++() {
+      ++key_;
+      return *this;
+    }
+    iterator operator++(int) {
+      auto tmp{*this};
+      ++key_;
+      return tmp;
+    }
+    bool operator==(const iterator &other) const = default;
+
+  private:
+    friend ListKeys;
+    explicit iterator(const rust::String *key) : key_(key) {}
+    const rust::String *key_{nullptr};
+  };
+
+  iterator begin() const { return iterator(keys_.data()); }
+  iterator end() const { return iterator(keys_.data() + keys_.size()); }
+  std::size_t size() const { return keys_.size(); }
+  bool empty() const { return keys_.empty(); }
+  std::string_view operator[](std::size_t i) const {
+    return {keys_[i].data(), keys_[i].size()};
+  }
+
+private:
+  friend class ListPage;
+  explicit ListKeys(rust::Slice<const rust::String> keys) : keys_(keys) {}
+  rust::Slice<const rust::String> keys_;
+};
+
 class ListResponse;
 class KVStore;
 class ListPage {
@@ -205,6 +387,10 @@ public:
   /// page.
   std::vector<std::string> into_keys();
 
+  /// Returns the listed keys in the current page as views into the page,
+  /// without copying them.
+  ListKeys key_views() const;
+
   /// Returns the next cursor of the List operation.
   std::optional<std::string> next_cursor() const;
 
@@ -248,6 +434,9 @@ public:
   }
 };
 
+class PipelinedListResponse;
+class ShardedListScan;
+
 class ListBuilder {
 public:
   /// Rather than read data from the primary data source, which is slower
@@ -275,13 +464,136 @@ public:
   /// Initiate async list of values in the KV Store.
   expected<PendingListHandle> execute_async() const;
 
+  /// Produce a `PipelinedListResponse`, which iterates over the pages like
+  /// `ListBuilder::iter()`, but requests each page as soon as the previous one
+  /// arrives, so that it is fetched while the previous one is being
+  /// processed.
+  PipelinedListResponse iter_pipelined() &&;
+
+  /// Produce a `ShardedListScan`, which lists the keys starting with the
+  /// prefix followed by each of `suffixes` in parallel.
+  ///
+  /// Keys that don't continue with one of `suffixes` are skipped, including
+  /// the key equal to the prefix itself. To cover every key, the suffixes
+  /// must cover every possible first character after the prefix.
+  ShardedListScan iter_sharded(const std::vector<std::string> &suffixes) &&;
+
 private:
   friend class KVStore;
-  ListBuilder(rust::Box<fastly::sys::kv_store::ListBuilder> builder)
-      : builder_(std::move(builder)) {}
+  ListBuilder(rust::Box<fastly::sys::kv_store::ListBuilder> builder,
+              const KVStore &store)
+      : builder_(std::move(builder)), store_(&store) {}
   rust::Box<fastly::sys::kv_store::ListBuilder> builder_;
+
+  // The settings so far, for the pipelined and sharded lists, which need
+  // to build one request per page.
+  const KVStore *store_;
+  std::optional<std::string> cursor_;
+  std::optional<std::uint32_t> limit_;
+  std::string prefix_;
+  bool eventual_{false};
+};
+
+/// The pages of a list, returned by `ListBuilder::iter_pipelined()`.
+///
+/// The next page is requested as soon as a page arrives, before `next()`
+/// returns it. The `KVStore` must outlive this.
+class PipelinedListResponse {
+public:
+  /// Wait for the next page, or return `std::nullopt` once the last one has
+  /// been returned. An error ends the list.
+  std::optional<expected<ListPage>> next();
+
+private:
+  friend class ListBuilder;
+  friend class ShardedListScan;
+  PipelinedListResponse(const KVStore &store, std::string prefix,
+                        std::optional<std::uint32_t> limit, bool eventual,
+                        std::optional<std::string> cursor);
+  void request(std::optional<std::string> cursor);
+
+  const KVStore *store_;
+  std::string prefix_;
+  std::optional<std::uint32_t> limit_;
+  bool eventual_;
+  std::optional<PendingListHandle> pending_;
+  // An error from requesting the next page, returned after the current one.
+  std::optional<KVStoreError> error_;
+};
+
+/// A page of a `ShardedListScan`, and the index of the suffix of its shard.
+struct ShardedListPage {
+  std::size_t shard;
+  expected<ListPage> page;
+};
+
+/// A list split into shards by prefix, returned by
+/// `ListBuilder::iter_sharded()`.
+///
+/// Every shard has a page request in flight at a time, and pages are returned
+/// in the order in which they arrive. The `KVStore` must outlive this.
+class ShardedListScan {
+public:
+  /// Wait for the next page of any shard, or return `std::nullopt` once every
+  /// shard is finished. An error ends its shard.
+  std::optional<ShardedListPage> next();
+
+  /// The number of shards that aren't finished.
+  std::size_t remaining_shards() const;
+
+private:
+  friend class ListBuilder;
+  explicit ShardedListScan(std::vector<PipelinedListResponse> shards)
+      : shards_(std::move(shards)) {}
+  std::vector<PipelinedListResponse> shards_;
+};
+
+/// One result of `KVStore::lookup_many()`.
+struct LookupManyItem {
+  /// The position of the key in the keys passed to `lookup_many()`.
+  std::size_t index;
+  expected<LookupResponse> response;
 };
 
+/// The results of `KVStore::lookup_many()`, produced in the order in which the
+/// lookups complete.
+///
+/// Lookups are started as earlier ones finish, keeping up to `max_in_flight`
+/// of them in flight, so that a slow key doesn't hold up the others. The
+/// `KVStore` must outlive this.
+class LookupMany {
+public:
+  /// Wait for the next lookup to complete and return its result, or
+  /// `std::nullopt` once every key has been returned.
+  std::optional<LookupManyItem> next();
+
+  /// The number of keys whose results haven't been returned yet.
+  std::size_t remaining() const {
+    return this->keys_.size() - this->returned_;
+  }
+
+private:
+  friend class KVStore;
+  LookupMany(const KVStore &store, std::vector<std::string> keys,
+             std::size_t max_in_flight);
+  void start_lookups();
+
+  const KVStore *store_;
+  std::vector<std::string> keys_;
+  std::size_t max_in_flight_;
+  std::size_t started_{0};
+  std::size_t returned_{0};
+  std::vector<std::size_t> in_flight_;
+  std::vector<std::uint32_t> handles_;
+  // Lookups that failed to start, to be returned before waiting on others.
+  std::deque<LookupManyItem> failed_;
+};
+
+/// A transform for `KVStore::update()`, from the current value of an item to
+/// its new value.
+using UpdateFn = std::function<std::optional<std::string>(
+    const std::optional<std::string> &current)>;
+
 class KVStore {
 public:
   /// Opens a key-value store with the given name.
@@ -295,6 +607,18 @@ public:
   expected<LookupResponse>
   pending_lookup_wait(PendingLookupHandle pending_request_handle) const;
 
+  /// Look up only the metadata and generation of an item, for version checks
+  /// and existence tests that don't need its value.
+  ///
+  /// The value is never read, so this costs the same no matter how large it
+  /// is.
+  expected<LookupInfo> lookup_info(std::string_view key) const;
+
+  /// Wait for a pending lookup, like `KVStore::pending_lookup_wait()`, but
+  /// keep only the metadata and generation of the item.
+  expected<LookupInfo>
+  pending_lookup_info_wait(PendingLookupHandle pending_request_handle) const;
+
   /// Insert a value into the KV Store.
   ///
   /// If the store already contained a value for this key, it will be
@@ -333,6 +657,80 @@ public:
   expected<ListPage>
   pending_list_wait(PendingListHandle pending_request_handle) const;
 
+  /// Look up many keys at once, with up to `max_in_flight` lookups in flight,
+  /// returning the results as they complete.
+  ///
+  /// # Example
+  ///
+  /// ```cpp
+  /// std::vector<std::string_view> keys{"a", "b", "c"};
+  /// auto results{store.lookup_many(keys)};
+  /// while (auto item{results.next()}) {
+  ///   if (item->response) {
+  ///     use(keys[item->index], item->response->take_body());
+  ///   }
+  /// }
+  /// ```
+  LookupMany lookup_many(std::span<const std::string_view> keys,
+                         std::size_t max_in_flight = 16) const;
+
+  /// Like `KVStore::lookup_many()`, but waits for every lookup and returns the
+  /// results in the same order as `keys`.
+  std::vector<expected<LookupResponse>>
+  lookup_many_ordered(std::span<const std::string_view> keys,
+                      std::size_t max_in_flight = 16) const;
+
+  /// Atomically replace the value of `key` with `fn(current)`, where
+  /// `current` is `std::nullopt` if there is no value. If `fn` returns
+  /// `std::nullopt`, the value is left as it is.
+  ///
+  /// The new value is only inserted if the item hasn't changed since it was
+  /// read. If it has, or the store is rate limiting, the update is tried
+  /// again with a fresh value after a jittered backoff, until `deadline` runs
+  /// out, so `fn` may be called more than once. The item's metadata and
+  /// `KVCodec` are kept. The host doesn't report an item's time to live, so
+  /// the new value gets `time_to_live` if it's given, and never expires
+  /// otherwise.
+  ///
+  /// Returns the value the item has once the update is done, or an
+  /// `ItemBadRequest` error if its current value can't be decoded.
+  ///
+  /// # Example
+  ///
+  /// ```cpp
+  /// auto updated{store.update("greeting", [](const auto &current) {
+  ///   return current.value_or("hello") + "!";
+  /// })};
+  /// ```
+  expected<std::optional<std::string>>
+  update(std::string_view key, UpdateFn fn,
+         std::chrono::milliseconds deadline = std::chrono::seconds(1),
+         std::optional<std::chrono::milliseconds> time_to_live =
+             std::nullopt) const;
+
+  /// Atomically add `delta` to the counter stored at `key`, as a decimal
+  /// integer, and return its new value. A missing counter starts at zero.
+  /// It's written like `update()` writes, with the same `deadline` and
+  /// `time_to_live`.
+  ///
+  /// Returns an `ItemBadRequest` error if the value isn't an integer, or if
+  /// adding `delta` to it would overflow.
+  expected<std::int64_t>
+  increment(std::string_view key, std::int64_t delta = 1,
+            std::chrono::milliseconds deadline = std::chrono::seconds(1),
+            std::optional<std::chrono::milliseconds> time_to_live =
+                std::nullopt) const;
+
+  /// Atomically add `members` to the set stored at `key`, as sorted lines,
+  /// and return the members of the set. Members can't contain newlines, and
+  /// an `ItemBadRequest` error is returned if any does. The set is written
+  /// like `update()` writes, with the same `deadline` and `time_to_live`.
+  expected<std::vector<std::string>>
+  merge_set(std::string_view key, const std::vector<std::string> &members,
+            std::chrono::milliseconds deadline = std::chrono::seconds(1),
+            std::optional<std::chrono::milliseconds> time_to_live =
+                std::nullopt) const;
+
 private:
   /// Create a new KVStore from the underlying Rust type.
   explicit KVStore(rust::Box<fastly::sys::kv_store::KVStore> store)
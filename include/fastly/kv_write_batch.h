@@ -0,0 +1,89 @@
+#ifndef FASTLY_KV_WRITE_BATCH_H
+#define FASTLY_KV_WRITE_BATCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <fastly/http/body.h>
+#include <fastly/kv_store.h>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fastly::kv_store {
+
+/// A write in a `KVWriteBatch` that failed.
+struct KVWriteFailure {
+  std::string key;
+  KVStoreError error;
+};
+
+namespace detail {
+struct BatchedWrite {
+  bool erase;
+  InsertMode mode;
+  std::optional<Body> value;
+  std::optional<std::chrono::milliseconds> ttl;
+};
+} // namespace detail
+
+/// Inserts and erases collected over a request, and written to a KV store all
+/// at once.
+///
+/// Writes to the same key are coalesced: an overwrite or erase replaces the
+/// writes queued before it, and appends and prepends are joined onto the
+/// value they follow where the result is the same. Committing the batch then
+/// starts the write of every key at once, so the batch costs about as much
+/// as its slowest write. Writes to a key that couldn't be coalesced run one
+/// after the other, in the order they were queued.
+///
+/// # Example
+///
+/// ```cpp
+/// namespace kv = fastly::kv_store;
+/// auto batch{kv::KVWriteBatch::open("sessions").value().value()};
+/// batch.insert("user/42/last-seen", fastly::Body(now));
+/// batch.insert("user/42/pages", fastly::Body(path + "\n"),
+///              kv::InsertMode::Append);
+/// batch.erase("user/42/cart");
+/// // The writes start now, and are waited for after the response is sent.
+/// std::move(batch).commit_in_background();
+/// ```
+class KVWriteBatch {
+public:
+  /// Open the KV store with the given name, to write a batch to.
+  static expected<std::optional<KVWriteBatch>> open(std::string_view name);
+
+  /// Queue an insert of `value` at `key`.
+  void insert(std::string key, Body value,
+              InsertMode mode = InsertMode::Overwrite,
+              std::optional<std::chrono::milliseconds> ttl = std::nullopt);
+
+  /// Queue an erase of `key`.
+  void erase(std::string key);
+
+  /// The number of writes queued, after coalescing.
+  std::size_t size() const;
+
+  /// Whether no writes are queued.
+  bool empty() const { return this->writes_.empty(); }
+
+  /// Start every write, wait for them, and return the ones that failed.
+  std::vector<KVWriteFailure> commit() &&;
+
+  /// Start every write now, and wait for them once the response has been
+  /// sent, through `fastly::background`. Failures are logged with
+  /// `fastly::log::warn()`.
+  void commit_in_background() &&;
+
+private:
+  explicit KVWriteBatch(KVStore store) : store_(std::move(store)) {}
+
+  KVStore store_;
+  std::map<std::string, std::vector<detail::BatchedWrite>> writes_;
+};
+
+} // namespace fastly::kv_store
+
+#endif
@@ -0,0 +1,36 @@
+use fastly_shared::FastlyStatus;
+
+use crate::error::{ErrPtr, FastlyStatusWrapper};
+use crate::try_fe;
+
+// The fastly crate only exposes `select` for HTTP requests, but the host can
+// wait on any kind of pending operation, so this calls it directly.
+#[link(wasm_import_module = "fastly_async_io")]
+unsafe extern "C" {
+    #[link_name = "select"]
+    fn fastly_async_io_select(
+        handles: *const u32,
+        handles_len: usize,
+        timeout_ms: u32,
+        done_index_out: *mut u32,
+    ) -> FastlyStatus;
+}
+
+/// Wait until one of `handles` is ready, for at most `timeout_ms`, or without a limit if it
+/// is 0. Returns the index of the ready handle, or `None` if the timeout passed first.
+pub(crate) fn select(
+    handles: &[u32],
+    timeout_ms: u32,
+) -> Result<Option<usize>, FastlyStatusWrapper> {
+    let mut done_index = u32::MAX;
+    unsafe { fastly_async_io_select(handles.as_ptr(), handles.len(), timeout_ms, &mut done_index) }
+        .result()
+        .map_err(FastlyStatusWrapper)?;
+    Ok((done_index != u32::MAX).then_some(done_index as usize))
+}
+
+/// As `select`, but returns `u32::MAX` if the timeout passed first. This fails if a handle
+/// isn't a pending operation.
+pub fn f_async_io_select(handles: &[u32], timeout_ms: u32, mut err: ErrPtr) -> u32 {
+    try_fe!(err, select(handles, timeout_ms)).map_or(u32::MAX, |index| index as u32)
+}
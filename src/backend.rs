@@ -2,7 +2,11 @@ use std::{num::NonZero, pin::Pin, time::Duration};
 
 use cxx::CxxString;
 
-use crate::{error::ErrPtr, try_fe};
+use crate::{
+    error::{ErrPtr, FastlyStatusWrapper},
+    ffi::BackendHealth,
+    try_fe,
+};
 
 pub struct Backend(pub(crate) fastly::backend::Backend);
 
@@ -99,6 +103,26 @@ impl Backend {
     pub fn is_ssl(&self) -> bool {
         self.0.is_ssl()
     }
+
+    pub fn is_healthy(&self, mut err: ErrPtr) -> BackendHealth {
+        try_fe!(err, self.0.is_healthy().map_err(FastlyStatusWrapper)).into()
+    }
+}
+
+impl Default for BackendHealth {
+    fn default() -> Self {
+        BackendHealth::Unknown
+    }
+}
+
+impl From<fastly::backend::BackendHealth> for BackendHealth {
+    fn from(val: fastly::backend::BackendHealth) -> Self {
+        match val {
+            fastly::backend::BackendHealth::Healthy => BackendHealth::Healthy,
+            fastly::backend::BackendHealth::Unhealthy => BackendHealth::Unhealthy,
+            _ => BackendHealth::Unknown,
+        }
+    }
 }
 
 fn ensure_u32(num: u128) -> u32 {
@@ -0,0 +1,504 @@
+use std::{fmt::Write, pin::Pin, time::Duration};
+
+use cxx::{CxxString, CxxVector};
+use fastly::http::{HeaderName, HeaderValue};
+
+use crate::{
+    ffi::CacheErrorCode,
+    http::body::{Body, StreamingBody},
+};
+
+pub struct CacheError(pub(crate) fastly::cache::core::CacheError);
+
+impl CacheError {
+    pub fn error_msg(&self, mut out: Pin<&mut CxxString>) {
+        write!(out, "{}", self.0).expect("This should never fail.");
+    }
+
+    pub fn error_code(&self) -> CacheErrorCode {
+        match self.0 {
+            fastly::cache::core::CacheError::LimitExceeded => CacheErrorCode::LimitExceeded,
+            fastly::cache::core::CacheError::InvalidOperation => CacheErrorCode::InvalidOperation,
+            fastly::cache::core::CacheError::Unsupported => CacheErrorCode::Unsupported,
+            _ => CacheErrorCode::Other,
+        }
+    }
+}
+
+#[macro_export]
+macro_rules! try_ce {
+    ( $err:ident, $x:expr ) => {
+        match $x {
+            std::result::Result::Ok(val) => {
+                $err.set(std::ptr::null_mut());
+                val
+            }
+            std::result::Result::Err(e) => {
+                $err.set(Box::into_raw(Box::new(CacheError(e))));
+                return Default::default();
+            }
+        }
+    };
+}
+
+// The builder methods can't report an error themselves, so an invalid header name or value, or a
+// surrogate key that isn't UTF-8, is left out and marks the builder as invalid instead. Its
+// `execute()` then fails with `InvalidOperation`.
+fn header(name: &CxxString, value: &CxxString) -> Option<(HeaderName, HeaderValue)> {
+    Some((
+        HeaderName::try_from(name.as_bytes()).ok()?,
+        HeaderValue::try_from(value.as_bytes()).ok()?,
+    ))
+}
+
+fn header_names(names: &CxxVector<CxxString>) -> Option<Vec<HeaderName>> {
+    names.iter().map(|name| HeaderName::try_from(name.as_bytes()).ok()).collect()
+}
+
+fn strings(values: &CxxVector<CxxString>) -> Option<Vec<&str>> {
+    values.iter().map(|v| v.to_str().ok()).collect()
+}
+
+fn check_valid(invalid: bool) -> Result<(), fastly::cache::core::CacheError> {
+    if invalid {
+        Err(fastly::cache::core::CacheError::InvalidOperation)
+    } else {
+        Ok(())
+    }
+}
+
+pub struct Found(pub(crate) fastly::cache::core::Found);
+
+impl Found {
+    pub fn ttl(&self) -> u64 {
+        self.0.ttl().as_millis() as u64
+    }
+
+    pub fn age(&self) -> u64 {
+        self.0.age().as_millis() as u64
+    }
+
+    pub fn stale_while_revalidate(&self) -> u64 {
+        self.0.stale_while_revalidate().as_millis() as u64
+    }
+
+    pub fn is_usable(&self) -> bool {
+        self.0.is_usable()
+    }
+
+    pub fn is_stale(&self) -> bool {
+        self.0.is_stale()
+    }
+
+    pub fn known_length(&self, out: Pin<&mut u64>) -> bool {
+        self.0.known_length().map(|len| out.set(len)).is_some()
+    }
+
+    pub fn user_metadata(&self, mut out: Pin<&mut CxxVector<u8>>) {
+        for byte in self.0.user_metadata().iter() {
+            out.as_mut().push(*byte);
+        }
+    }
+
+    pub fn hits(&self) -> u64 {
+        self.0.hits()
+    }
+
+    pub fn to_stream(&self, mut out: Pin<&mut *mut Body>, mut err: Pin<&mut *mut CacheError>) {
+        let body = try_ce!(err, self.0.to_stream());
+        out.set(Box::into_raw(Box::new(Body(body))));
+    }
+
+    pub unsafe fn to_stream_from_range(
+        &self,
+        from: *const u64,
+        to: *const u64,
+        mut out: Pin<&mut *mut Body>,
+        mut err: Pin<&mut *mut CacheError>,
+    ) {
+        // SAFETY: the C++ side passes either null or a pointer to a live value.
+        let (from, to) = unsafe { (from.as_ref().copied(), to.as_ref().copied()) };
+        let body = try_ce!(err, self.0.to_stream_from_range(from, to));
+        out.set(Box::into_raw(Box::new(Body(body))));
+    }
+}
+
+// The second field records whether the builder was given an invalid argument.
+pub struct CacheLookupBuilder(pub(crate) fastly::cache::core::LookupBuilder, pub(crate) bool);
+
+pub fn f_cache_core_lookup(key: &[u8]) -> Box<CacheLookupBuilder> {
+    Box::new(CacheLookupBuilder(fastly::cache::core::lookup(key.to_vec().into()), false))
+}
+
+pub fn m_cache_core_lookup_builder_header(
+    mut builder: Box<CacheLookupBuilder>,
+    name: &CxxString,
+    value: &CxxString,
+) -> Box<CacheLookupBuilder> {
+    match header(name, value) {
+        Some((name, value)) => builder.0 = builder.0.header(name, value),
+        None => builder.1 = true,
+    }
+    builder
+}
+
+pub fn m_cache_core_lookup_builder_execute(
+    builder: Box<CacheLookupBuilder>,
+    mut out: Pin<&mut *mut Found>,
+    mut err: Pin<&mut *mut CacheError>,
+) -> bool {
+    try_ce!(err, check_valid(builder.1));
+    try_ce!(err, builder.0.execute())
+        .map(|found| out.set(Box::into_raw(Box::new(Found(found)))))
+        .is_some()
+}
+
+// The second field records whether the builder was given an invalid argument.
+pub struct CacheInsertBuilder(pub(crate) fastly::cache::core::InsertBuilder, pub(crate) bool);
+
+pub fn f_cache_core_insert(key: &[u8], ttl: u64) -> Box<CacheInsertBuilder> {
+    Box::new(CacheInsertBuilder(
+        fastly::cache::core::insert(key.to_vec().into(), Duration::from_millis(ttl)),
+        false,
+    ))
+}
+
+pub fn m_cache_core_insert_builder_header(
+    mut builder: Box<CacheInsertBuilder>,
+    name: &CxxString,
+    value: &CxxString,
+) -> Box<CacheInsertBuilder> {
+    match header(name, value) {
+        Some((name, value)) => builder.0 = builder.0.header(name, value),
+        None => builder.1 = true,
+    }
+    builder
+}
+
+pub fn m_cache_core_insert_builder_vary_by(
+    mut builder: Box<CacheInsertBuilder>,
+    headers: &CxxVector<CxxString>,
+) -> Box<CacheInsertBuilder> {
+    match header_names(headers) {
+        Some(names) => builder.0 = builder.0.vary_by(names),
+        None => builder.1 = true,
+    }
+    builder
+}
+
+pub fn m_cache_core_insert_builder_initial_age(
+    mut builder: Box<CacheInsertBuilder>,
+    age: u64,
+) -> Box<CacheInsertBuilder> {
+    builder.0 = builder.0.initial_age(Duration::from_millis(age));
+    builder
+}
+
+pub fn m_cache_core_insert_builder_stale_while_revalidate(
+    mut builder: Box<CacheInsertBuilder>,
+    duration: u64,
+) -> Box<CacheInsertBuilder> {
+    builder.0 = builder.0.stale_while_revalidate(Duration::from_millis(duration));
+    builder
+}
+
+pub fn m_cache_core_insert_builder_surrogate_keys(
+    mut builder: Box<CacheInsertBuilder>,
+    keys: &CxxVector<CxxString>,
+) -> Box<CacheInsertBuilder> {
+    match strings(keys) {
+        Some(keys) => builder.0 = builder.0.surrogate_keys(keys),
+        None => builder.1 = true,
+    }
+    builder
+}
+
+pub fn m_cache_core_insert_builder_known_length(
+    mut builder: Box<CacheInsertBuilder>,
+    length: u64,
+) -> Box<CacheInsertBuilder> {
+    builder.0 = builder.0.known_length(length);
+    builder
+}
+
+pub fn m_cache_core_insert_builder_user_metadata(
+    mut builder: Box<CacheInsertBuilder>,
+    metadata: &[u8],
+) -> Box<CacheInsertBuilder> {
+    builder.0 = builder.0.user_metadata(metadata.to_vec().into());
+    builder
+}
+
+pub fn m_cache_core_insert_builder_sensitive_data(
+    mut builder: Box<CacheInsertBuilder>,
+    sensitive: bool,
+) -> Box<CacheInsertBuilder> {
+    builder.0 = builder.0.sensitive_data(sensitive);
+    builder
+}
+
+pub fn m_cache_core_insert_builder_deliver_node_max_age(
+    mut builder: Box<CacheInsertBuilder>,
+    max_age: u64,
+) -> Box<CacheInsertBuilder> {
+    builder.0 = builder.0.deliver_node_max_age(Duration::from_millis(max_age));
+    builder
+}
+
+pub fn m_cache_core_insert_builder_execute(
+    builder: Box<CacheInsertBuilder>,
+    mut out: Pin<&mut *mut StreamingBody>,
+    mut err: Pin<&mut *mut CacheError>,
+) {
+    try_ce!(err, check_valid(builder.1));
+    let body = try_ce!(err, builder.0.execute());
+    out.set(Box::into_raw(Box::new(StreamingBody(body))));
+}
+
+pub struct Transaction(pub(crate) fastly::cache::core::Transaction);
+
+impl Transaction {
+    pub fn found(&self, mut out: Pin<&mut *mut Found>) -> bool {
+        self.0
+            .found()
+            .map(|found| out.set(Box::into_raw(Box::new(Found(found)))))
+            .is_some()
+    }
+
+    pub fn must_insert(&self) -> bool {
+        self.0.must_insert()
+    }
+
+    pub fn must_insert_or_update(&self) -> bool {
+        self.0.must_insert_or_update()
+    }
+
+    pub fn cancel_insert_or_update(&self, mut err: Pin<&mut *mut CacheError>) {
+        try_ce!(err, self.0.cancel_insert_or_update());
+    }
+}
+
+// The second field records whether the builder was given an invalid argument.
+pub struct TransactionLookupBuilder(
+    pub(crate) fastly::cache::core::TransactionLookupBuilder,
+    pub(crate) bool,
+);
+
+pub fn m_static_cache_core_transaction_lookup(key: &[u8]) -> Box<TransactionLookupBuilder> {
+    Box::new(TransactionLookupBuilder(
+        fastly::cache::core::Transaction::lookup(key.to_vec().into()),
+        false,
+    ))
+}
+
+pub fn m_cache_core_transaction_lookup_builder_header(
+    mut builder: Box<TransactionLookupBuilder>,
+    name: &CxxString,
+    value: &CxxString,
+) -> Box<TransactionLookupBuilder> {
+    match header(name, value) {
+        Some((name, value)) => builder.0 = builder.0.header(name, value),
+        None => builder.1 = true,
+    }
+    builder
+}
+
+pub fn m_cache_core_transaction_lookup_builder_execute(
+    builder: Box<TransactionLookupBuilder>,
+    mut out: Pin<&mut *mut Transaction>,
+    mut err: Pin<&mut *mut CacheError>,
+) {
+    try_ce!(err, check_valid(builder.1));
+    let transaction = try_ce!(err, builder.0.execute());
+    out.set(Box::into_raw(Box::new(Transaction(transaction))));
+}
+
+// The second field records whether the builder was given an invalid argument.
+pub struct TransactionInsertBuilder(
+    pub(crate) fastly::cache::core::TransactionInsertBuilder,
+    pub(crate) bool,
+);
+
+pub fn m_cache_core_transaction_insert(
+    transaction: Box<Transaction>,
+    ttl: u64,
+) -> Box<TransactionInsertBuilder> {
+    Box::new(TransactionInsertBuilder(transaction.0.insert(Duration::from_millis(ttl)), false))
+}
+
+pub fn m_cache_core_transaction_insert_builder_vary_by(
+    mut builder: Box<TransactionInsertBuilder>,
+    headers: &CxxVector<CxxString>,
+) -> Box<TransactionInsertBuilder> {
+    match header_names(headers) {
+        Some(names) => builder.0 = builder.0.vary_by(names),
+        None => builder.1 = true,
+    }
+    builder
+}
+
+pub fn m_cache_core_transaction_insert_builder_initial_age(
+    mut builder: Box<TransactionInsertBuilder>,
+    age: u64,
+) -> Box<TransactionInsertBuilder> {
+    builder.0 = builder.0.initial_age(Duration::from_millis(age));
+    builder
+}
+
+pub fn m_cache_core_transaction_insert_builder_stale_while_revalidate(
+    mut builder: Box<TransactionInsertBuilder>,
+    duration: u64,
+) -> Box<TransactionInsertBuilder> {
+    builder.0 = builder.0.stale_while_revalidate(Duration::from_millis(duration));
+    builder
+}
+
+pub fn m_cache_core_transaction_insert_builder_surrogate_keys(
+    mut builder: Box<TransactionInsertBuilder>,
+    keys: &CxxVector<CxxString>,
+) -> Box<TransactionInsertBuilder> {
+    match strings(keys) {
+        Some(keys) => builder.0 = builder.0.surrogate_keys(keys),
+        None => builder.1 = true,
+    }
+    builder
+}
+
+pub fn m_cache_core_transaction_insert_builder_known_length(
+    mut builder: Box<TransactionInsertBuilder>,
+    length: u64,
+) -> Box<TransactionInsertBuilder> {
+    builder.0 = builder.0.known_length(length);
+    builder
+}
+
+pub fn m_cache_core_transaction_insert_builder_user_metadata(
+    mut builder: Box<TransactionInsertBuilder>,
+    metadata: &[u8],
+) -> Box<TransactionInsertBuilder> {
+    builder.0 = builder.0.user_metadata(metadata.to_vec().into());
+    builder
+}
+
+pub fn m_cache_core_transaction_insert_builder_sensitive_data(
+    mut builder: Box<TransactionInsertBuilder>,
+    sensitive: bool,
+) -> Box<TransactionInsertBuilder> {
+    builder.0 = builder.0.sensitive_data(sensitive);
+    builder
+}
+
+pub fn m_cache_core_transaction_insert_builder_deliver_node_max_age(
+    mut builder: Box<TransactionInsertBuilder>,
+    max_age: u64,
+) -> Box<TransactionInsertBuilder> {
+    builder.0 = builder.0.deliver_node_max_age(Duration::from_millis(max_age));
+    builder
+}
+
+pub fn m_cache_core_transaction_insert_builder_execute(
+    builder: Box<TransactionInsertBuilder>,
+    mut out: Pin<&mut *mut StreamingBody>,
+    mut err: Pin<&mut *mut CacheError>,
+) {
+    try_ce!(err, check_valid(builder.1));
+    let body = try_ce!(err, builder.0.execute());
+    out.set(Box::into_raw(Box::new(StreamingBody(body))));
+}
+
+pub fn m_cache_core_transaction_insert_builder_execute_and_stream_back(
+    builder: Box<TransactionInsertBuilder>,
+    mut out_body: Pin<&mut *mut StreamingBody>,
+    mut out_found: Pin<&mut *mut Found>,
+    mut err: Pin<&mut *mut CacheError>,
+) {
+    try_ce!(err, check_valid(builder.1));
+    let (body, found) = try_ce!(err, builder.0.execute_and_stream_back());
+    out_body.set(Box::into_raw(Box::new(StreamingBody(body))));
+    out_found.set(Box::into_raw(Box::new(Found(found))));
+}
+
+// The second field records whether the builder was given an invalid argument.
+pub struct TransactionUpdateBuilder(
+    pub(crate) fastly::cache::core::TransactionUpdateBuilder,
+    pub(crate) bool,
+);
+
+pub fn m_cache_core_transaction_update(
+    transaction: Box<Transaction>,
+    ttl: u64,
+) -> Box<TransactionUpdateBuilder> {
+    Box::new(TransactionUpdateBuilder(transaction.0.update(Duration::from_millis(ttl)), false))
+}
+
+pub fn m_cache_core_transaction_update_builder_vary_by(
+    mut builder: Box<TransactionUpdateBuilder>,
+    headers: &CxxVector<CxxString>,
+) -> Box<TransactionUpdateBuilder> {
+    match header_names(headers) {
+        Some(names) => builder.0 = builder.0.vary_by(names),
+        None => builder.1 = true,
+    }
+    builder
+}
+
+pub fn m_cache_core_transaction_update_builder_age(
+    mut builder: Box<TransactionUpdateBuilder>,
+    age: u64,
+) -> Box<TransactionUpdateBuilder> {
+    builder.0 = builder.0.age(Duration::from_millis(age));
+    builder
+}
+
+pub fn m_cache_core_transaction_update_builder_stale_while_revalidate(
+    mut builder: Box<TransactionUpdateBuilder>,
+    duration: u64,
+) -> Box<TransactionUpdateBuilder> {
+    builder.0 = builder.0.stale_while_revalidate(Duration::from_millis(duration));
+    builder
+}
+
+pub fn m_cache_core_transaction_update_builder_surrogate_keys(
+    mut builder: Box<TransactionUpdateBuilder>,
+    keys: &CxxVector<CxxString>,
+) -> Box<TransactionUpdateBuilder> {
+    match strings(keys) {
+        Some(keys) => builder.0 = builder.0.surrogate_keys(keys),
+        None => builder.1 = true,
+    }
+    builder
+}
+
+pub fn m_cache_core_transaction_update_builder_user_metadata(
+    mut builder: Box<TransactionUpdateBuilder>,
+    metadata: &[u8],
+) -> Box<TransactionUpdateBuilder> {
+    builder.0 = builder.0.user_metadata(metadata.to_vec().into());
+    builder
+}
+
+pub fn m_cache_core_transaction_update_builder_deliver_node_max_age(
+    mut builder: Box<TransactionUpdateBuilder>,
+    max_age: u64,
+) -> Box<TransactionUpdateBuilder> {
+    builder.0 = builder.0.deliver_node_max_age(Duration::from_millis(max_age));
+    builder
+}
+
+pub fn m_cache_core_transaction_update_builder_execute(
+    builder: Box<TransactionUpdateBuilder>,
+    mut err: Pin<&mut *mut CacheError>,
+) {
+    try_ce!(err, check_valid(builder.1));
+    try_ce!(err, builder.0.execute());
+}
+
+pub fn f_cache_core_cache_error_force_symbols(x: Box<CacheError>) -> Box<CacheError> {
+    x
+}
+pub fn f_cache_core_found_force_symbols(x: Box<Found>) -> Box<Found> {
+    x
+}
+pub fn f_cache_core_transaction_force_symbols(x: Box<Transaction>) -> Box<Transaction> {
+    x
+}
@@ -0,0 +1,117 @@
+#include <fastly/async_io.h>
+
+namespace fastly::async_io {
+
+std::size_t WaitSet::add(http::request::PendingRequest pending) {
+  auto id{this->next_id_++};
+  this->http_.emplace_back(id, std::move(pending));
+  return id;
+}
+
+std::size_t WaitSet::add(const kv_store::KVStore &store,
+                         kv_store::PendingLookupHandle handle) {
+  return this->add_kv(store, KVKind::Lookup, handle.as_u32());
+}
+
+std::size_t WaitSet::add(const kv_store::KVStore &store,
+                         kv_store::PendingInsertHandle handle) {
+  return this->add_kv(store, KVKind::Insert, handle.as_u32());
+}
+
+std::size_t WaitSet::add(const kv_store::KVStore &store,
+                         kv_store::PendingEraseHandle handle) {
+  return this->add_kv(store, KVKind::Erase, handle.as_u32());
+}
+
+std::size_t WaitSet::add(const kv_store::KVStore &store,
+                         kv_store::PendingListHandle handle) {
+  return this->add_kv(store, KVKind::List, handle.as_u32());
+}
+
+std::size_t WaitSet::add_kv(const kv_store::KVStore &store, KVKind kind,
+                            std::uint32_t handle) {
+  auto id{this->next_id_++};
+  this->kv_.push_back({id, kind, &store});
+  this->kv_handles_.push_back(handle);
+  return id;
+}
+
+std::optional<Ready> WaitSet::wait() { return this->wait_until(std::nullopt); }
+
+std::optional<Ready> WaitSet::wait_for(std::chrono::milliseconds timeout) {
+  return this->wait_until(std::chrono::steady_clock::now() + timeout);
+}
+
+Ready WaitSet::take_http(std::size_t index) {
+  auto [id, pending]{std::move(this->http_[index])};
+  this->http_.erase(this->http_.begin() + index);
+  return {id, ResponseReady{pending.wait()}};
+}
+
+Ready WaitSet::take_kv(std::size_t index) {
+  auto entry{this->kv_[index]};
+  auto handle{this->kv_handles_[index]};
+  this->kv_.erase(this->kv_.begin() + index);
+  this->kv_handles_.erase(this->kv_handles_.begin() + index);
+  auto &store{*entry.store};
+  switch (entry.kind) {
+  case KVKind::Lookup:
+    return {entry.id,
+            LookupReady{store.pending_lookup_wait(
+                kv_store::PendingLookupHandle::from_u32(handle))}};
+  case KVKind::Insert:
+    return {entry.id,
+            InsertReady{store.pending_insert_wait(
+                kv_store::PendingInsertHandle::from_u32(handle))}};
+  case KVKind::Erase:
+    return {entry.id,
+            EraseReady{store.pending_erase_wait(
+                kv_store::PendingEraseHandle::from_u32(handle))}};
+  case KVKind::List:
+  default:
+    return {entry.id, ListReady{store.pending_list_wait(
+                          kv_store::PendingListHandle::from_u32(handle))}};
+  }
+}
+
+std::optional<Ready> WaitSet::wait_until(
+    std::optional<std::chrono::steady_clock::time_point> deadline) {
+  if (this->empty()) {
+    return std::nullopt;
+  }
+  // The host treats a timeout of zero as no timeout at all.
+  uint32_t timeout_ms{0};
+  if (deadline) {
+    auto remaining{std::chrono::ceil<std::chrono::milliseconds>(
+        *deadline - std::chrono::steady_clock::now())};
+    if (remaining.count() <= 0) {
+      return std::nullopt;
+    }
+    timeout_ms = static_cast<uint32_t>(remaining.count());
+  }
+
+  // Both kinds of operation go to the host as one set, KV store operations
+  // first, so a single select blocks until any of them is ready.
+  auto handles{this->kv_handles_};
+  for (auto &[id, pending] : this->http_) {
+    handles.push_back(pending.req->handle());
+  }
+  fastly::sys::error::FastlyError *err;
+  auto done{fastly::sys::async_io::f_async_io_select(
+      {handles.data(), handles.size()}, timeout_ms, err)};
+  if (err != nullptr) {
+    // The host refused the set as a whole, so wait on the first operation on
+    // its own, which reports the failure in its own result.
+    rust::Box<fastly::sys::error::FastlyError>::from_raw(err);
+    done = 0;
+  }
+  if (done >= handles.size()) {
+    return std::nullopt;
+  }
+  if (done < this->kv_.size()) {
+    return this->take_kv(done);
+  }
+  return this->take_http(done - this->kv_.size());
+}
+
+} // namespace fastly::async_io
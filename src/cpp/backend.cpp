@@ -1,6 +1,10 @@
+#include "hash.h"
 #include "util.h"
+#include <array>
 #include <fastly/backend.h>
 #include <fastly/sdk-sys.h>
+#include <format>
+#include <unordered_map>
 
 namespace fastly::backend {
 
@@ -83,6 +87,16 @@ std::chrono::milliseconds Backend::get_tcp_keepalive_time() {
 
 bool Backend::is_ssl() { return this->backend->is_ssl(); }
 
+fastly::expected<BackendHealth> Backend::is_healthy() {
+  fastly::sys::error::FastlyError *err;
+  auto health{this->backend->is_healthy(err)};
+  if (err != nullptr) {
+    return fastly::unexpected(err);
+  } else {
+    return health;
+  }
+}
+
 // TODO(@zkat): optional stuff is weird.
 // SslVersion get_ssl_min_version();
 // SslVersion get_ssl_max_version();
@@ -210,4 +224,233 @@ fastly::expected<Backend> BackendBuilder::finish() && {
   }
 }
 
+BackendSpec BackendSpec::override_host(std::string_view value) && {
+  this->override_host_ = std::string(value);
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::connect_timeout(std::chrono::milliseconds value) && {
+  this->connect_timeout_ = value;
+  return std::move(*this);
+}
+
+BackendSpec
+BackendSpec::first_byte_timeout(std::chrono::milliseconds value) && {
+  this->first_byte_timeout_ = value;
+  return std::move(*this);
+}
+
+BackendSpec
+BackendSpec::between_bytes_timeout(std::chrono::milliseconds value) && {
+  this->between_bytes_timeout_ = value;
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::check_certificate(std::string_view value) && {
+  this->check_certificate_ = std::string(value);
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::ca_certificate(std::string_view value) && {
+  this->ca_certificate_ = std::string(value);
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::tls_ciphers(std::string_view value) && {
+  this->tls_ciphers_ = std::string(value);
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::sni_hostname(std::string_view value) && {
+  this->sni_hostname_ = std::string(value);
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::enable_pooling(bool value) && {
+  this->pooling_ = value;
+  return std::move(*this);
+}
+
+BackendSpec
+BackendSpec::http_keepalive_time(std::chrono::milliseconds value) && {
+  this->http_keepalive_time_ = value;
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::tcp_keepalive_enable(bool value) && {
+  this->tcp_keepalive_enable_ = value;
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::tcp_keepalive_interval_secs(uint32_t value) && {
+  this->tcp_keepalive_interval_secs_ = value;
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::tcp_keepalive_probes(uint32_t value) && {
+  this->tcp_keepalive_probes_ = value;
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::tcp_keepalive_time_secs(uint32_t value) && {
+  this->tcp_keepalive_time_secs_ = value;
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::enable_ssl() && {
+  this->ssl_ = true;
+  return std::move(*this);
+}
+
+BackendSpec BackendSpec::disable_ssl() && {
+  this->ssl_ = false;
+  return std::move(*this);
+}
+
+namespace {
+
+// 64-bit FNV-1a. Every field is fed with a presence byte and, for strings, its
+// length, so that different settings can't serialize to the same bytes.
+class SpecHasher {
+public:
+  void bytes(const void *data, size_t len) { this->fnv_.bytes(data, len); }
+  void integer(uint64_t v) {
+    std::array<uint8_t, 8> le;
+    for (size_t i{0}; i < le.size(); i++) {
+      le[i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+    this->bytes(le.data(), le.size());
+  }
+  void string(std::string_view s) {
+    this->integer(s.size());
+    this->bytes(s.data(), s.size());
+  }
+  template <typename T> void field(const std::optional<T> &v) {
+    this->integer(v.has_value());
+    if (!v) {
+      return;
+    }
+    if constexpr (std::is_same_v<T, std::string>) {
+      this->string(*v);
+    } else if constexpr (std::is_same_v<T, std::chrono::milliseconds>) {
+      this->integer(static_cast<uint64_t>(v->count()));
+    } else {
+      this->integer(static_cast<uint64_t>(*v));
+    }
+  }
+  uint64_t finish() const { return this->fnv_.finish(); }
+
+private:
+  fastly::detail::Fnv1a fnv_;
+};
+
+std::unordered_map<std::string, Backend> &registry() {
+  static std::unordered_map<std::string, Backend> backends;
+  return backends;
+}
+
+} // namespace
+
+uint64_t BackendSpec::hash() const {
+  SpecHasher h;
+  h.string(this->target_);
+  h.field(this->override_host_);
+  h.field(this->connect_timeout_);
+  h.field(this->first_byte_timeout_);
+  h.field(this->between_bytes_timeout_);
+  h.field(this->ssl_);
+  h.field(this->check_certificate_);
+  h.field(this->ca_certificate_);
+  h.field(this->tls_ciphers_);
+  h.field(this->sni_hostname_);
+  h.field(this->pooling_);
+  h.field(this->http_keepalive_time_);
+  h.field(this->tcp_keepalive_enable_);
+  h.field(this->tcp_keepalive_interval_secs_);
+  h.field(this->tcp_keepalive_probes_);
+  h.field(this->tcp_keepalive_time_secs_);
+  return h.finish();
+}
+
+BackendBuilder BackendSpec::builder(std::string_view name) const {
+  BackendBuilder b{name, this->target_};
+  if (this->override_host_) {
+    b = std::move(b).override_host(*this->override_host_);
+  }
+  if (this->connect_timeout_) {
+    b = std::move(b).connect_timeout(*this->connect_timeout_);
+  }
+  if (this->first_byte_timeout_) {
+    b = std::move(b).first_byte_timeout(*this->first_byte_timeout_);
+  }
+  if (this->between_bytes_timeout_) {
+    b = std::move(b).between_bytes_timeout(*this->between_bytes_timeout_);
+  }
+  if (this->ssl_) {
+    b = *this->ssl_ ? std::move(b).enable_ssl() : std::move(b).disable_ssl();
+  }
+  if (this->check_certificate_) {
+    b = std::move(b).check_certificate(*this->check_certificate_);
+  }
+  if (this->ca_certificate_) {
+    b = std::move(b).ca_certificate(*this->ca_certificate_);
+  }
+  if (this->tls_ciphers_) {
+    b = std::move(b).tls_ciphers(*this->tls_ciphers_);
+  }
+  if (this->sni_hostname_) {
+    b = std::move(b).sni_hostname(*this->sni_hostname_);
+  }
+  if (this->pooling_) {
+    b = std::move(b).enable_pooling(*this->pooling_);
+  }
+  if (this->http_keepalive_time_) {
+    b = std::move(b).http_keepalive_time(*this->http_keepalive_time_);
+  }
+  if (this->tcp_keepalive_enable_) {
+    b = std::move(b).tcp_keepalive_enable(*this->tcp_keepalive_enable_);
+  }
+  if (this->tcp_keepalive_interval_secs_) {
+    b = std::move(b).tcp_keepalive_interval_secs(
+        *this->tcp_keepalive_interval_secs_);
+  }
+  if (this->tcp_keepalive_probes_) {
+    b = std::move(b).tcp_keepalive_probes(*this->tcp_keepalive_probes_);
+  }
+  if (this->tcp_keepalive_time_secs_) {
+    b = std::move(b).tcp_keepalive_time_secs(*this->tcp_keepalive_time_secs_);
+  }
+  return b;
+}
+
+std::string BackendRegistry::backend_name(std::string_view name,
+                                          const BackendSpec &spec) {
+  return std::format("{}-{:016x}", name, spec.hash());
+}
+
+fastly::expected<Backend>
+BackendRegistry::get_or_create(std::string_view name, const BackendSpec &spec) {
+  auto full_name{backend_name(name, spec)};
+  auto &backends{registry()};
+  if (auto found{backends.find(full_name)}; found != backends.end()) {
+    return found->second.clone();
+  }
+  auto created{spec.builder(full_name).finish()};
+  if (!created) {
+    // Most likely registered by an earlier call in this session, before the
+    // cache was populated; any other error resurfaces from the lookup.
+    if (created.error().error_code() != FastlyErrorCode::BackendCreationError) {
+      return created;
+    }
+    created = Backend::from_name(full_name);
+    if (!created) {
+      return created;
+    }
+  }
+  auto &cached{backends.emplace(full_name, std::move(*created)).first->second};
+  return cached.clone();
+}
+
+void BackendRegistry::clear() { registry().clear(); }
+
 } // namespace fastly::backend
@@ -0,0 +1,259 @@
+#include <cstdlib>
+#include <fastly/background.h>
+#include <fastly/http/purge.h>
+#include <fastly/log.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace fastly::background {
+
+namespace {
+
+// Largest number of pending requests handed to `request::select()` at once.
+constexpr size_t SELECT_BATCH_SIZE{64};
+
+const auto program_start{std::chrono::steady_clock::now()};
+
+struct QueuedSend {
+  http::Request req;
+  backend::Backend backend;
+};
+
+struct QueuedInsert {
+  std::string store;
+  std::string key;
+  http::Body value;
+  std::optional<std::chrono::milliseconds> ttl;
+};
+
+struct QueuedInsertHandle {
+  std::string store;
+  kv_store::PendingInsertHandle handle;
+};
+
+struct QueuedPurge {
+  std::string surrogate_key;
+  bool soft;
+};
+
+struct Queue {
+  std::vector<QueuedSend> sends;
+  std::vector<http::request::PendingRequest> requests;
+  std::vector<QueuedInsert> inserts;
+  std::vector<QueuedInsertHandle> insert_handles;
+  std::vector<QueuedPurge> purges;
+  std::vector<std::function<void()>> deferred;
+  std::optional<std::chrono::milliseconds> budget;
+  bool draining{false};
+
+  size_t size() const {
+    return sends.size() + requests.size() + inserts.size() +
+           insert_handles.size() + purges.size() + deferred.size();
+  }
+};
+
+Queue &queue() {
+  static Queue q;
+  return q;
+}
+
+// Register the exit-time drain on first use. The handler is registered after
+// the queue is constructed, so it runs before the queue is destroyed.
+Queue &enqueue() {
+  static bool registered{false};
+  auto &q{queue()};
+  if (!registered) {
+    registered = true;
+    std::atexit(drain);
+  }
+  return q;
+}
+
+bool expired() {
+  auto &budget{queue().budget};
+  return budget &&
+         std::chrono::steady_clock::now() >= program_start + *budget;
+}
+
+// Start and wait for everything queued so far. Work queued while this runs is
+// left in the queue for the next round.
+void drain_once() {
+  auto &q{queue()};
+  auto sends{std::move(q.sends)};
+  auto requests{std::move(q.requests)};
+  auto inserts{std::move(q.inserts)};
+  auto insert_handles{std::move(q.insert_handles)};
+  auto purges{std::move(q.purges)};
+  auto deferred{std::move(q.deferred)};
+  q.sends.clear();
+  q.requests.clear();
+  q.inserts.clear();
+  q.insert_handles.clear();
+  q.purges.clear();
+  q.deferred.clear();
+
+  for (auto &send : sends) {
+    if (expired()) {
+      break;
+    }
+    auto pending{send.req.send_async(send.backend)};
+    if (!pending) {
+      fastly::log::warn("background send failed: {}",
+                        pending.error().error_msg());
+      continue;
+    }
+    requests.push_back(std::move(*pending));
+  }
+
+  // Inserts into the same store share one open handle.
+  std::map<std::string, kv_store::KVStore> stores;
+  auto open_store{[&](const std::string &name) -> kv_store::KVStore * {
+    if (auto found{stores.find(name)}; found != stores.end()) {
+      return &found->second;
+    }
+    auto opened{kv_store::KVStore::open(name)};
+    if (!opened || !*opened) {
+      fastly::log::warn("background KV insert: can't open store {}", name);
+      return nullptr;
+    }
+    return &stores.emplace(name, std::move(**opened)).first->second;
+  }};
+  std::vector<std::pair<kv_store::KVStore *, kv_store::PendingInsertHandle>>
+      pending_inserts;
+  for (auto &insert : inserts) {
+    if (expired()) {
+      break;
+    }
+    auto *store{open_store(insert.store)};
+    if (store == nullptr) {
+      continue;
+    }
+    auto builder{store->build_insert()};
+    if (insert.ttl) {
+      builder = std::move(builder).time_to_live(*insert.ttl);
+    }
+    auto handle{
+        std::move(builder).execute_async(insert.key, std::move(insert.value))};
+    if (!handle) {
+      fastly::log::warn("background KV insert of {} failed: {}", insert.key,
+                        handle.error().error_msg());
+      continue;
+    }
+    pending_inserts.emplace_back(store, *handle);
+  }
+  for (auto &queued : insert_handles) {
+    if (auto *store{open_store(queued.store)}) {
+      pending_inserts.emplace_back(store, queued.handle);
+    }
+  }
+
+  // Purges and deferred functions run while the sends and inserts are in
+  // flight.
+  for (auto &purge : purges) {
+    if (expired()) {
+      break;
+    }
+    auto purged{purge.soft
+                    ? http::purge::soft_purge_surrogate_key(purge.surrogate_key)
+                    : http::purge::purge_surrogate_key(purge.surrogate_key)};
+    if (!purged) {
+      fastly::log::warn("background purge of {} failed: {}",
+                        purge.surrogate_key, purged.error().error_msg());
+    }
+  }
+  for (auto &fn : deferred) {
+    if (expired()) {
+      break;
+    }
+    fn();
+  }
+
+  for (auto &[store, handle] : pending_inserts) {
+    if (expired()) {
+      return;
+    }
+    if (auto inserted{store->pending_insert_wait(handle)}; !inserted) {
+      fastly::log::warn("background KV insert failed: {}",
+                        inserted.error().error_msg());
+    }
+  }
+  while (!requests.empty() && !expired()) {
+    std::vector<http::request::PendingRequest> batch;
+    while (!requests.empty() && batch.size() < SELECT_BATCH_SIZE) {
+      batch.push_back(std::move(requests.back()));
+      requests.pop_back();
+    }
+    while (!batch.empty() && !expired()) {
+      auto [resp, rest] = http::request::select(batch);
+      if (!resp) {
+        fastly::log::warn("background send failed: {}",
+                          resp.error().error_msg());
+      }
+      batch = std::move(rest);
+    }
+  }
+}
+
+} // namespace
+
+void send(http::Request req, std::string_view backend_name) {
+  auto backend{backend::Backend::from_name(backend_name)};
+  if (!backend) {
+    fastly::log::warn("background send: no backend named {}", backend_name);
+    return;
+  }
+  send(std::move(req), *backend);
+}
+
+void send(http::Request req, backend::Backend &backend) {
+  enqueue().sends.push_back({std::move(req), backend.clone()});
+}
+
+void add(http::request::PendingRequest pending) {
+  enqueue().requests.push_back(std::move(pending));
+}
+
+void kv_insert(std::string_view store_name, std::string key, http::Body value,
+               std::optional<std::chrono::milliseconds> ttl) {
+  enqueue().inserts.push_back(
+      {std::string(store_name), std::move(key), std::move(value), ttl});
+}
+
+void add(std::string_view store_name, kv_store::PendingInsertHandle handle) {
+  enqueue().insert_handles.push_back({std::string(store_name), handle});
+}
+
+void purge_surrogate_key(std::string surrogate_key, bool soft) {
+  enqueue().purges.push_back({std::move(surrogate_key), soft});
+}
+
+void defer(std::function<void()> fn) {
+  enqueue().deferred.push_back(std::move(fn));
+}
+
+void set_time_budget(std::chrono::milliseconds budget) {
+  queue().budget = budget;
+}
+
+size_t pending() { return queue().size(); }
+
+void drain() {
+  auto &q{queue()};
+  // Deferred functions may end up calling back in here, e.g. by finishing a
+  // streamed client response.
+  if (q.draining) {
+    return;
+  }
+  q.draining = true;
+  while (q.size() > 0 && !expired()) {
+    drain_once();
+  }
+  q.draining = false;
+}
+
+namespace detail {
+void response_sent() { drain(); }
+} // namespace detail
+
+} // namespace fastly::background
@@ -0,0 +1,71 @@
+#ifndef FASTLY_SRC_BACKOFF_H
+#define FASTLY_SRC_BACKOFF_H
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <random>
+
+namespace fastly::detail {
+
+// Exponential backoff with optional "equal jitter": the delay for a given
+// retry is drawn uniformly from [d/2, d], where d grows by `multiplier` per
+// retry and is capped at `max`.
+// This is intended for internal use only.
+class Backoff {
+public:
+  Backoff(std::chrono::milliseconds initial, std::chrono::milliseconds max,
+          double multiplier, bool jitter)
+      : initial_(initial), max_(max), multiplier_(multiplier),
+        jitter_(jitter) {}
+
+  // Delay to wait before the given retry. `retry` is 1-based, so the delay
+  // before the second attempt is `delay(1)`.
+  std::chrono::milliseconds delay(uint32_t retry) const {
+    double ms{static_cast<double>(initial_.count())};
+    for (uint32_t i{1}; i < retry && ms < max_.count(); i++) {
+      ms *= multiplier_;
+    }
+    auto capped{std::min(static_cast<int64_t>(ms),
+                         static_cast<int64_t>(max_.count()))};
+    if (!jitter_ || capped < 2) {
+      return std::chrono::milliseconds(capped);
+    }
+    std::uniform_int_distribution<int64_t> dist(capped / 2, capped);
+    return std::chrono::milliseconds(dist(rng()));
+  }
+
+private:
+  static std::minstd_rand &rng() {
+    static std::minstd_rand gen{std::random_device{}()};
+    return gen;
+  }
+
+  std::chrono::milliseconds initial_;
+  std::chrono::milliseconds max_;
+  double multiplier_;
+  bool jitter_;
+};
+
+// Block the instance for the given duration.
+//
+// `std::this_thread` is not available on WASI targets without threads, so
+// this goes through `nanosleep`, which the host implements with a clock
+// subscription.
+inline void sleep_for(std::chrono::milliseconds dur) {
+  if (dur.count() <= 0) {
+    return;
+  }
+  auto secs{std::chrono::duration_cast<std::chrono::seconds>(dur)};
+  struct timespec ts {
+    static_cast<time_t>(secs.count()),
+        static_cast<long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(dur - secs)
+                .count())
+  };
+  nanosleep(&ts, nullptr);
+}
+
+} // namespace fastly::detail
+
+#endif
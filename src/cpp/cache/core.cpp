@@ -0,0 +1,391 @@
+#include <fastly/cache/core.h>
+
+namespace fastly::cache::core {
+
+namespace {
+
+rust::Slice<const uint8_t> key_slice(std::string_view key) {
+  return {reinterpret_cast<const uint8_t *>(key.data()), key.size()};
+}
+
+uint64_t millis(std::chrono::milliseconds duration) {
+  return static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+}
+
+} // namespace
+
+CacheErrorCode CacheError::error_code() { return err_->error_code(); }
+std::string CacheError::error_msg() {
+  std::string msg;
+  err_->error_msg(msg);
+  return msg;
+}
+
+std::chrono::milliseconds Found::ttl() const {
+  return std::chrono::milliseconds(found_->ttl());
+}
+
+std::chrono::milliseconds Found::age() const {
+  return std::chrono::milliseconds(found_->age());
+}
+
+std::chrono::milliseconds Found::stale_while_revalidate() const {
+  return std::chrono::milliseconds(found_->stale_while_revalidate());
+}
+
+bool Found::is_usable() const { return found_->is_usable(); }
+
+bool Found::is_stale() const { return found_->is_stale(); }
+
+std::optional<uint64_t> Found::known_length() const {
+  uint64_t length;
+  if (found_->known_length(length)) {
+    return length;
+  }
+  return std::nullopt;
+}
+
+std::vector<uint8_t> Found::user_metadata() const {
+  std::vector<uint8_t> metadata;
+  found_->user_metadata(metadata);
+  return metadata;
+}
+
+uint64_t Found::hits() const { return found_->hits(); }
+
+expected<Body> Found::to_stream() const {
+  fastly::sys::http::Body *body;
+  fastly::sys::cache::CacheError *err;
+  found_->to_stream(body, err);
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  return Body{rust::Box<fastly::sys::http::Body>::from_raw(body)};
+}
+
+expected<Body> Found::to_stream_from_range(std::optional<uint64_t> from,
+                                           std::optional<uint64_t> to) const {
+  fastly::sys::http::Body *body;
+  fastly::sys::cache::CacheError *err;
+  found_->to_stream_from_range(from ? &*from : nullptr, to ? &*to : nullptr,
+                               body, err);
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  return Body{rust::Box<fastly::sys::http::Body>::from_raw(body)};
+}
+
+LookupBuilder LookupBuilder::header(std::string_view name,
+                                    std::string_view value) && {
+  builder_ = fastly::sys::cache::m_cache_core_lookup_builder_header(
+      std::move(builder_), std::string(name), std::string(value));
+  return std::move(*this);
+}
+
+expected<std::optional<Found>> LookupBuilder::execute() && {
+  fastly::sys::cache::Found *found;
+  fastly::sys::cache::CacheError *err;
+  auto some{fastly::sys::cache::m_cache_core_lookup_builder_execute(
+      std::move(builder_), found, err)};
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  if (!some) {
+    return std::nullopt;
+  }
+  return Found{rust::Box<fastly::sys::cache::Found>::from_raw(found)};
+}
+
+LookupBuilder lookup(std::string_view key) {
+  return {fastly::sys::cache::f_cache_core_lookup(key_slice(key))};
+}
+
+InsertBuilder InsertBuilder::header(std::string_view name,
+                                    std::string_view value) && {
+  builder_ = fastly::sys::cache::m_cache_core_insert_builder_header(
+      std::move(builder_), std::string(name), std::string(value));
+  return std::move(*this);
+}
+
+InsertBuilder
+InsertBuilder::vary_by(const std::vector<std::string> &headers) && {
+  builder_ = fastly::sys::cache::m_cache_core_insert_builder_vary_by(
+      std::move(builder_), headers);
+  return std::move(*this);
+}
+
+InsertBuilder InsertBuilder::initial_age(std::chrono::milliseconds age) && {
+  builder_ = fastly::sys::cache::m_cache_core_insert_builder_initial_age(
+      std::move(builder_), millis(age));
+  return std::move(*this);
+}
+
+InsertBuilder
+InsertBuilder::stale_while_revalidate(std::chrono::milliseconds duration) && {
+  builder_ =
+      fastly::sys::cache::m_cache_core_insert_builder_stale_while_revalidate(
+          std::move(builder_), millis(duration));
+  return std::move(*this);
+}
+
+InsertBuilder
+InsertBuilder::surrogate_keys(const std::vector<std::string> &keys) && {
+  builder_ = fastly::sys::cache::m_cache_core_insert_builder_surrogate_keys(
+      std::move(builder_), keys);
+  return std::move(*this);
+}
+
+InsertBuilder InsertBuilder::known_length(uint64_t length) && {
+  builder_ = fastly::sys::cache::m_cache_core_insert_builder_known_length(
+      std::move(builder_), length);
+  return std::move(*this);
+}
+
+InsertBuilder
+InsertBuilder::user_metadata(const std::vector<uint8_t> &metadata) && {
+  builder_ = fastly::sys::cache::m_cache_core_insert_builder_user_metadata(
+      std::move(builder_), {metadata.data(), metadata.size()});
+  return std::move(*this);
+}
+
+InsertBuilder InsertBuilder::sensitive_data(bool sensitive) && {
+  builder_ = fastly::sys::cache::m_cache_core_insert_builder_sensitive_data(
+      std::move(builder_), sensitive);
+  return std::move(*this);
+}
+
+InsertBuilder
+InsertBuilder::deliver_node_max_age(std::chrono::milliseconds max_age) && {
+  builder_ =
+      fastly::sys::cache::m_cache_core_insert_builder_deliver_node_max_age(
+          std::move(builder_), millis(max_age));
+  return std::move(*this);
+}
+
+expected<fastly::http::StreamingBody> InsertBuilder::execute() && {
+  fastly::sys::http::StreamingBody *body;
+  fastly::sys::cache::CacheError *err;
+  fastly::sys::cache::m_cache_core_insert_builder_execute(std::move(builder_),
+                                                          body, err);
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  return fastly::http::StreamingBody{
+      rust::Box<fastly::sys::http::StreamingBody>::from_raw(body)};
+}
+
+InsertBuilder insert(std::string_view key, std::chrono::milliseconds ttl) {
+  return {fastly::sys::cache::f_cache_core_insert(key_slice(key), millis(ttl))};
+}
+
+TransactionLookupBuilder Transaction::lookup(std::string_view key) {
+  return {fastly::sys::cache::m_static_cache_core_transaction_lookup(
+      key_slice(key))};
+}
+
+std::optional<Found> Transaction::found() const {
+  fastly::sys::cache::Found *found;
+  if (transaction_->found(found)) {
+    return Found{rust::Box<fastly::sys::cache::Found>::from_raw(found)};
+  }
+  return std::nullopt;
+}
+
+bool Transaction::must_insert() const { return transaction_->must_insert(); }
+
+bool Transaction::must_insert_or_update() const {
+  return transaction_->must_insert_or_update();
+}
+
+expected<> Transaction::cancel_insert_or_update() const {
+  fastly::sys::cache::CacheError *err;
+  transaction_->cancel_insert_or_update(err);
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  return {};
+}
+
+TransactionInsertBuilder
+Transaction::insert(std::chrono::milliseconds ttl) && {
+  return {fastly::sys::cache::m_cache_core_transaction_insert(
+      std::move(transaction_), millis(ttl))};
+}
+
+TransactionUpdateBuilder
+Transaction::update(std::chrono::milliseconds ttl) && {
+  return {fastly::sys::cache::m_cache_core_transaction_update(
+      std::move(transaction_), millis(ttl))};
+}
+
+TransactionLookupBuilder
+TransactionLookupBuilder::header(std::string_view name,
+                                 std::string_view value) && {
+  builder_ = fastly::sys::cache::m_cache_core_transaction_lookup_builder_header(
+      std::move(builder_), std::string(name), std::string(value));
+  return std::move(*this);
+}
+
+expected<Transaction> TransactionLookupBuilder::execute() && {
+  fastly::sys::cache::Transaction *transaction;
+  fastly::sys::cache::CacheError *err;
+  fastly::sys::cache::m_cache_core_transaction_lookup_builder_execute(
+      std::move(builder_), transaction, err);
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  return Transaction{
+      rust::Box<fastly::sys::cache::Transaction>::from_raw(transaction)};
+}
+
+TransactionInsertBuilder
+TransactionInsertBuilder::vary_by(const std::vector<std::string> &headers) && {
+  builder_ =
+      fastly::sys::cache::m_cache_core_transaction_insert_builder_vary_by(
+          std::move(builder_), headers);
+  return std::move(*this);
+}
+
+TransactionInsertBuilder
+TransactionInsertBuilder::initial_age(std::chrono::milliseconds age) && {
+  builder_ =
+      fastly::sys::cache::m_cache_core_transaction_insert_builder_initial_age(
+          std::move(builder_), millis(age));
+  return std::move(*this);
+}
+
+TransactionInsertBuilder TransactionInsertBuilder::stale_while_revalidate(
+    std::chrono::milliseconds duration) && {
+  builder_ = fastly::sys::cache::
+      m_cache_core_transaction_insert_builder_stale_while_revalidate(
+          std::move(builder_), millis(duration));
+  return std::move(*this);
+}
+
+TransactionInsertBuilder TransactionInsertBuilder::surrogate_keys(
+    const std::vector<std::string> &keys) && {
+  builder_ = fastly::sys::cache::
+      m_cache_core_transaction_insert_builder_surrogate_keys(
+          std::move(builder_), keys);
+  return std::move(*this);
+}
+
+TransactionInsertBuilder
+TransactionInsertBuilder::known_length(uint64_t length) && {
+  builder_ =
+      fastly::sys::cache::m_cache_core_transaction_insert_builder_known_length(
+          std::move(builder_), length);
+  return std::move(*this);
+}
+
+TransactionInsertBuilder TransactionInsertBuilder::user_metadata(
+    const std::vector<uint8_t> &metadata) && {
+  builder_ =
+      fastly::sys::cache::m_cache_core_transaction_insert_builder_user_metadata(
+          std::move(builder_), {metadata.data(), metadata.size()});
+  return std::move(*this);
+}
+
+TransactionInsertBuilder
+TransactionInsertBuilder::sensitive_data(bool sensitive) && {
+  builder_ = fastly::sys::cache::
+      m_cache_core_transaction_insert_builder_sensitive_data(
+          std::move(builder_), sensitive);
+  return std::move(*this);
+}
+
+TransactionInsertBuilder TransactionInsertBuilder::deliver_node_max_age(
+    std::chrono::milliseconds max_age) && {
+  builder_ = fastly::sys::cache::
+      m_cache_core_transaction_insert_builder_deliver_node_max_age(
+          std::move(builder_), millis(max_age));
+  return std::move(*this);
+}
+
+expected<fastly::http::StreamingBody> TransactionInsertBuilder::execute() && {
+  fastly::sys::http::StreamingBody *body;
+  fastly::sys::cache::CacheError *err;
+  fastly::sys::cache::m_cache_core_transaction_insert_builder_execute(
+      std::move(builder_), body, err);
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  return fastly::http::StreamingBody{
+      rust::Box<fastly::sys::http::StreamingBody>::from_raw(body)};
+}
+
+expected<std::pair<fastly::http::StreamingBody, Found>>
+TransactionInsertBuilder::execute_and_stream_back() && {
+  fastly::sys::http::StreamingBody *body;
+  fastly::sys::cache::Found *found;
+  fastly::sys::cache::CacheError *err;
+  fastly::sys::cache::
+      m_cache_core_transaction_insert_builder_execute_and_stream_back(
+          std::move(builder_), body, found, err);
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  return std::pair<fastly::http::StreamingBody, Found>(
+      fastly::http::StreamingBody{
+          rust::Box<fastly::sys::http::StreamingBody>::from_raw(body)},
+      Found{rust::Box<fastly::sys::cache::Found>::from_raw(found)});
+}
+
+TransactionUpdateBuilder
+TransactionUpdateBuilder::vary_by(const std::vector<std::string> &headers) && {
+  builder_ =
+      fastly::sys::cache::m_cache_core_transaction_update_builder_vary_by(
+          std::move(builder_), headers);
+  return std::move(*this);
+}
+
+TransactionUpdateBuilder
+TransactionUpdateBuilder::age(std::chrono::milliseconds age) && {
+  builder_ = fastly::sys::cache::m_cache_core_transaction_update_builder_age(
+      std::move(builder_), millis(age));
+  return std::move(*this);
+}
+
+TransactionUpdateBuilder TransactionUpdateBuilder::stale_while_revalidate(
+    std::chrono::milliseconds duration) && {
+  builder_ = fastly::sys::cache::
+      m_cache_core_transaction_update_builder_stale_while_revalidate(
+          std::move(builder_), millis(duration));
+  return std::move(*this);
+}
+
+TransactionUpdateBuilder TransactionUpdateBuilder::surrogate_keys(
+    const std::vector<std::string> &keys) && {
+  builder_ = fastly::sys::cache::
+      m_cache_core_transaction_update_builder_surrogate_keys(
+          std::move(builder_), keys);
+  return std::move(*this);
+}
+
+TransactionUpdateBuilder TransactionUpdateBuilder::user_metadata(
+    const std::vector<uint8_t> &metadata) && {
+  builder_ =
+      fastly::sys::cache::m_cache_core_transaction_update_builder_user_metadata(
+          std::move(builder_), {metadata.data(), metadata.size()});
+  return std::move(*this);
+}
+
+TransactionUpdateBuilder TransactionUpdateBuilder::deliver_node_max_age(
+    std::chrono::milliseconds max_age) && {
+  builder_ = fastly::sys::cache::
+      m_cache_core_transaction_update_builder_deliver_node_max_age(
+          std::move(builder_), millis(max_age));
+  return std::move(*this);
+}
+
+expected<> TransactionUpdateBuilder::execute() && {
+  fastly::sys::cache::CacheError *err;
+  fastly::sys::cache::m_cache_core_transaction_update_builder_execute(
+      std::move(builder_), err);
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  return {};
+}
+
+} // namespace fastly::cache::core
@@ -0,0 +1,125 @@
+#include "../hash.h"
+#include <cstdlib>
+#include <fastly/cache/simple.h>
+#include <fastly/http/purge.h>
+#include <format>
+#include <vector>
+
+namespace fastly::cache::simple {
+
+namespace {
+
+std::optional<std::string> pop() {
+  if (auto *pop{std::getenv("FASTLY_POP")}; pop != nullptr && *pop != '\0') {
+    return pop;
+  }
+  return std::nullopt;
+}
+
+// The surrogate key that purges `key` from `pop`, or from every POP.
+std::string surrogate_key(std::string_view key,
+                          const std::optional<std::string> &pop) {
+  if (pop) {
+    return fastly::detail::surrogate_key(
+        std::format("simple-cache/{}/", *pop), key);
+  }
+  return fastly::detail::surrogate_key("simple-cache/", key);
+}
+
+std::vector<std::string> surrogate_keys(std::string_view key) {
+  std::vector<std::string> keys{surrogate_key(key, std::nullopt)};
+  if (auto here{pop()}) {
+    keys.push_back(surrogate_key(key, here));
+  }
+  return keys;
+}
+
+} // namespace
+
+expected<std::optional<Body>> get(std::string_view key) {
+  auto found{core::lookup(key).execute()};
+  if (!found) {
+    return unexpected(std::move(found.error()));
+  }
+  if (!*found) {
+    return std::nullopt;
+  }
+  auto body{(*found)->to_stream()};
+  if (!body) {
+    return unexpected(std::move(body.error()));
+  }
+  return std::move(*body);
+}
+
+expected<std::optional<Body>>
+get_or_set_with(std::string_view key,
+                const std::function<std::optional<CacheEntry>()> &make_entry) {
+  auto tx{core::Transaction::lookup(key).execute()};
+  if (!tx) {
+    return unexpected(std::move(tx.error()));
+  }
+  if (!tx->must_insert_or_update()) {
+    auto found{tx->found()};
+    if (!found) {
+      return std::nullopt;
+    }
+    auto body{found->to_stream()};
+    if (!body) {
+      return unexpected(std::move(body.error()));
+    }
+    return std::move(*body);
+  }
+
+  auto entry{make_entry()};
+  if (!entry) {
+    // Let a waiting request have a go instead.
+    if (auto cancelled{tx->cancel_insert_or_update()}; !cancelled) {
+      return unexpected(std::move(cancelled.error()));
+    }
+    return std::nullopt;
+  }
+  auto inserted{std::move(*tx)
+                    .insert(entry->ttl)
+                    .surrogate_keys(surrogate_keys(key))
+                    .execute_and_stream_back()};
+  if (!inserted) {
+    return unexpected(std::move(inserted.error()));
+  }
+  auto &[writer, found]{*inserted};
+  writer.append(std::move(entry->value));
+  // If this fails, the insert is abandoned, and reading the item reports the
+  // error.
+  (void)writer.finish();
+  auto body{found.to_stream()};
+  if (!body) {
+    return unexpected(std::move(body.error()));
+  }
+  return std::move(*body);
+}
+
+expected<Body> get_or_set(std::string_view key, Body value,
+                          std::chrono::milliseconds ttl) {
+  auto body{get_or_set_with(key, [&]() -> std::optional<CacheEntry> {
+    return CacheEntry{std::move(value), ttl};
+  })};
+  if (!body) {
+    return unexpected(std::move(body.error()));
+  }
+  if (!*body) {
+    // A transaction that doesn't have to insert always finds an item, so
+    // this is only a safeguard.
+    return Body();
+  }
+  return std::move(**body);
+}
+
+fastly::expected<void> purge(std::string_view key, PurgeScope scope) {
+  auto here{scope == PurgeScope::Pop ? pop() : std::nullopt};
+  if (scope == PurgeScope::Pop && !here) {
+    return fastly::unexpected(fastly::FastlyError::io_error(
+        "FASTLY_POP isn't set, so there's no POP to purge"));
+  }
+  return fastly::http::purge::purge_surrogate_key(surrogate_key(key, here));
+}
+
+} // namespace fastly::cache::simple
@@ -0,0 +1,232 @@
+#include "hash.h"
+#include <fastly/background.h>
+#include <fastly/cache/core.h>
+#include <fastly/cached_kv_store.h>
+#include <fastly/http/purge.h>
+#include <format>
+#include <memory>
+
+namespace fastly::kv_store {
+
+namespace core = fastly::cache::core;
+
+namespace {
+
+// What the helpers below need from a `CachedKVStore`, by value, so that a
+// revalidation can outlive it.
+struct Settings {
+  std::string name;
+  std::chrono::milliseconds ttl;
+  std::chrono::milliseconds swr;
+  std::string key_prefix;
+
+  std::string cache_key(std::string_view key) const {
+    return std::format("{}{}/{}", this->key_prefix, this->name, key);
+  }
+
+  std::string surrogate_key(std::string_view key) const {
+    return fastly::detail::surrogate_key(this->key_prefix,
+                                         this->cache_key(key));
+  }
+};
+
+// The user metadata of a cached item is the generation of the value, as 8
+// little-endian bytes, followed by the value's own metadata, if it has any.
+std::vector<uint8_t>
+encode_metadata(uint64_t generation,
+                const std::optional<std::vector<uint8_t>> &metadata) {
+  std::vector<uint8_t> out;
+  for (int i{0}; i < 8; i++) {
+    out.push_back(static_cast<uint8_t>(generation >> (8 * i)));
+  }
+  out.push_back(metadata ? 1 : 0);
+  if (metadata) {
+    out.insert(out.end(), metadata->begin(), metadata->end());
+  }
+  return out;
+}
+
+std::optional<std::pair<uint64_t, std::optional<std::vector<uint8_t>>>>
+decode_metadata(const std::vector<uint8_t> &bytes) {
+  if (bytes.size() < 9) {
+    return std::nullopt;
+  }
+  uint64_t generation{0};
+  for (int i{0}; i < 8; i++) {
+    generation |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+  }
+  std::optional<std::vector<uint8_t>> metadata;
+  if (bytes[8] != 0) {
+    metadata.emplace(bytes.begin() + 9, bytes.end());
+  }
+  return std::make_pair(generation, std::move(metadata));
+}
+
+std::optional<CachedLookup> from_found(const core::Found &found) {
+  auto decoded{decode_metadata(found.user_metadata())};
+  if (!decoded) {
+    return std::nullopt;
+  }
+  auto body{found.to_stream()};
+  if (!body) {
+    return std::nullopt;
+  }
+  return CachedLookup{std::move(*body), std::move(decoded->second),
+                      decoded->first};
+}
+
+CachedLookup from_response(LookupResponse &response) {
+  auto metadata{response.metadata()};
+  return CachedLookup{response.take_body(), std::move(metadata),
+                      response.current_generation()};
+}
+
+expected<CachedLookup> read_store(const KVStore &store, std::string_view key) {
+  auto response{store.lookup(key)};
+  if (!response) {
+    return unexpected(std::move(response.error()));
+  }
+  return from_response(*response);
+}
+
+// Read `key` from the KV store and fill the cache with it, through `tx`,
+// which must insert or update the cached item. `stale` is the generation of
+// the stale item being revalidated, if any.
+expected<CachedLookup> fill(const KVStore &store, const Settings &settings,
+                            std::string_view key, core::Transaction tx,
+                            std::optional<uint64_t> stale) {
+  auto response{store.lookup(key)};
+  if (!response) {
+    // Leave it to the next lookup, rather than caching the miss.
+    (void)tx.cancel_insert_or_update();
+    return unexpected(std::move(response.error()));
+  }
+  auto metadata{response->metadata()};
+  auto generation{response->current_generation()};
+  auto user_metadata{encode_metadata(generation, metadata)};
+  std::vector<std::string> surrogate_keys{settings.surrogate_key(key)};
+
+  if (stale == generation) {
+    // The value hasn't changed, so only the item's TTL needs renewing.
+    (void)std::move(tx)
+        .update(settings.ttl)
+        .stale_while_revalidate(settings.swr)
+        .surrogate_keys(surrogate_keys)
+        .user_metadata(user_metadata)
+        .execute();
+    return from_response(*response);
+  }
+
+  auto inserted{std::move(tx)
+                    .insert(settings.ttl)
+                    .stale_while_revalidate(settings.swr)
+                    .surrogate_keys(surrogate_keys)
+                    .user_metadata(user_metadata)
+                    .execute_and_stream_back()};
+  if (!inserted) {
+    return from_response(*response);
+  }
+  auto &[writer, found]{*inserted};
+  writer.append(response->take_body());
+  // If this fails, the insert is abandoned, and reading the item reports the
+  // error.
+  (void)writer.finish();
+  auto body{found.to_stream()};
+  if (!body) {
+    return read_store(store, key);
+  }
+  return CachedLookup{std::move(*body), std::move(metadata), generation};
+}
+
+} // namespace
+
+KVCachePolicy::KVCachePolicy()
+    : ttl_(60000), swr_(60000), key_prefix_("kv-cache/") {}
+
+KVCachePolicy KVCachePolicy::ttl(std::chrono::milliseconds ttl) && {
+  this->ttl_ = ttl;
+  return std::move(*this);
+}
+
+KVCachePolicy
+KVCachePolicy::stale_while_revalidate(std::chrono::milliseconds swr) && {
+  this->swr_ = swr;
+  return std::move(*this);
+}
+
+KVCachePolicy KVCachePolicy::key_prefix(std::string_view prefix) && {
+  this->key_prefix_ = std::string(prefix);
+  return std::move(*this);
+}
+
+expected<std::optional<CachedKVStore>>
+CachedKVStore::open(std::string_view name, KVCachePolicy policy) {
+  auto store{KVStore::open(name)};
+  if (!store) {
+    return unexpected(std::move(store.error()));
+  }
+  if (!*store) {
+    return std::nullopt;
+  }
+  return CachedKVStore(std::move(**store), std::string(name),
+                       std::move(policy));
+}
+
+expected<CachedLookup> CachedKVStore::lookup(std::string_view key) const {
+  Settings settings{this->name_, this->policy_.ttl_, this->policy_.swr_,
+                    this->policy_.key_prefix_};
+  auto tx{core::Transaction::lookup(settings.cache_key(key)).execute()};
+  if (!tx) {
+    return read_store(this->store_, key);
+  }
+
+  auto found{tx->found()};
+  auto cached{found ? from_found(*found) : std::nullopt};
+  if (!tx->must_insert_or_update()) {
+    if (cached) {
+      return std::move(*cached);
+    }
+    // The item can't be read, so go to the store directly.
+    return read_store(this->store_, key);
+  }
+
+  if (cached && found->is_usable()) {
+    // Serve the stale value now, and revalidate it once the response has been
+    // sent. The transaction keeps other lookups from revalidating it too.
+    auto pending{std::make_shared<core::Transaction>(std::move(*tx))};
+    fastly::background::defer([settings, key = std::string(key), pending,
+                               stale = cached->generation]() {
+      auto store{KVStore::open(settings.name)};
+      if (store && *store) {
+        (void)fill(**store, settings, key, std::move(*pending), stale);
+      }
+    });
+    return std::move(*cached);
+  }
+  return fill(this->store_, settings, key, std::move(*tx),
+              cached ? std::optional(cached->generation) : std::nullopt);
+}
+
+expected<> CachedKVStore::insert(std::string_view key, Body value) const {
+  auto inserted{this->store_.insert(key, std::move(value))};
+  if (inserted) {
+    this->invalidate(key);
+  }
+  return inserted;
+}
+
+expected<> CachedKVStore::erase(std::string_view key) const {
+  auto erased{this->store_.erase(key)};
+  if (erased) {
+    this->invalidate(key);
+  }
+  return erased;
+}
+
+void CachedKVStore::invalidate(std::string_view key) const {
+  Settings settings{this->name_, this->policy_.ttl_, this->policy_.swr_,
+                    this->policy_.key_prefix_};
+  (void)fastly::http::purge::purge_surrogate_key(settings.surrogate_key(key));
+}
+
+} // namespace fastly::kv_store
@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <charconv>
+#include <deque>
+#include <fastly/background.h>
+#include <fastly/chunked_kv_store.h>
+#include <format>
+#include <functional>
+#include <random>
+
+namespace fastly::kv_store {
+
+namespace {
+
+// The metadata of a manifest starts with this, which tells it apart from a
+// plain value.
+constexpr std::string_view manifest_tag{"fastly-chunked/1 "};
+
+// How many times a read starts over from a new manifest after the chunks it
+// was reading were erased.
+constexpr int max_read_attempts{3};
+
+// A manifest is kept in the metadata of the value's key, after its tag, as
+// "<nonce> <chunks> <size>", so that it can be read without the value. Each
+// write of a value uses a new nonce for its chunk keys, so that it never
+// overwrites the chunks of a value that is still being read. The old chunks
+// are erased once the new manifest is in place, and a reader that then finds
+// one missing starts over from the new manifest.
+struct Manifest {
+  std::string nonce;
+  std::uint64_t chunks;
+  std::uint64_t size;
+
+  std::string chunk_key(std::string_view key, std::uint64_t index) const {
+    return std::format("{}/.chunks/{}/{}", key, this->nonce, index);
+  }
+
+  std::string metadata() const {
+    return std::format("{}{} {} {}", manifest_tag, this->nonce, this->chunks,
+                       this->size);
+  }
+};
+
+std::string new_nonce() {
+  std::random_device rd;
+  return std::format("{:08x}{:08x}", rd(), rd());
+}
+
+// Returns `std::nullopt` if `metadata` isn't that of a manifest.
+expected<std::optional<Manifest>>
+parse_manifest(std::optional<std::string_view> metadata) {
+  if (!metadata || !metadata->starts_with(manifest_tag)) {
+    return std::nullopt;
+  }
+  auto text{metadata->substr(manifest_tag.size())};
+  auto space{text.find(' ')};
+  if (space == std::string_view::npos) {
+    return unexpected(KVStoreError::item_bad_request());
+  }
+  Manifest manifest{std::string(text.substr(0, space)), 0, 0};
+  auto end{text.data() + text.size()};
+  auto chunks{
+      std::from_chars(text.data() + space + 1, end, manifest.chunks)};
+  if (chunks.ec != std::errc() || chunks.ptr == end || *chunks.ptr != ' ') {
+    return unexpected(KVStoreError::item_bad_request());
+  }
+  auto size{std::from_chars(chunks.ptr + 1, end, manifest.size)};
+  if (size.ec != std::errc() || size.ptr != end) {
+    return unexpected(KVStoreError::item_bad_request());
+  }
+  return manifest;
+}
+
+expected<std::optional<Manifest>> parse_manifest(LookupResponse &response) {
+  auto metadata{response.metadata()};
+  if (!metadata) {
+    return std::nullopt;
+  }
+  return parse_manifest(std::string_view(
+      reinterpret_cast<const char *>(metadata->data()), metadata->size()));
+}
+
+// The manifest currently stored for `key`, if there is one. Only the metadata
+// of the key is read.
+std::optional<Manifest> current_manifest(const KVStore &store,
+                                         std::string_view key) {
+  auto found{store.lookup_info(key)};
+  if (!found) {
+    return std::nullopt;
+  }
+  auto manifest{parse_manifest(found->metadata_str())};
+  return manifest ? *manifest : std::nullopt;
+}
+
+// Erase the chunks of a value once the response has been sent. Failures
+// only leave unreachable chunks behind, so they are ignored.
+void erase_chunks(std::string_view store_name, std::string_view key,
+                  Manifest manifest, std::size_t max_in_flight) {
+  fastly::background::defer([store_name = std::string(store_name),
+                             key = std::string(key),
+                             manifest = std::move(manifest), max_in_flight]() {
+    auto store{KVStore::open(store_name)};
+    if (!store || !*store) {
+      return;
+    }
+    std::deque<PendingEraseHandle> pending;
+    for (std::uint64_t i{0}; i < manifest.chunks; i++) {
+      if (pending.size() >= max_in_flight) {
+        (void)(*store)->pending_erase_wait(pending.front());
+        pending.pop_front();
+      }
+      auto handle{(*store)->build_erase().execute_async(
+          manifest.chunk_key(key, i))};
+      if (handle) {
+        pending.push_back(*handle);
+      }
+    }
+    for (auto handle : pending) {
+      (void)(*store)->pending_erase_wait(handle);
+    }
+  });
+}
+
+// Fetch the chunks of a value, with up to `max_in_flight` lookups in flight,
+// and hand them to `sink` in order.
+expected<> read_chunks(const KVStore &store, std::string_view key,
+                       const Manifest &manifest, std::size_t max_in_flight,
+                       const std::function<void(LookupResponse &)> &sink) {
+  std::deque<PendingLookupHandle> pending;
+  std::uint64_t next{0};
+  for (std::uint64_t i{0}; i < manifest.chunks; i++) {
+    while (next < manifest.chunks && pending.size() < max_in_flight) {
+      auto handle{
+          store.build_lookup().execute_async(manifest.chunk_key(key, next++))};
+      if (!handle) {
+        return unexpected(std::move(handle.error()));
+      }
+      pending.push_back(*handle);
+    }
+    auto chunk{store.pending_lookup_wait(pending.front())};
+    pending.pop_front();
+    if (!chunk) {
+      return unexpected(std::move(chunk.error()));
+    }
+    sink(*chunk);
+  }
+  return {};
+}
+
+// Whether `read` failed because a chunk was missing, which means that the
+// value was replaced or erased while it was being read.
+bool chunk_missing(expected<> &read) {
+  return !read && read.error().error_code() == KVStoreErrorCode::ItemNotFound;
+}
+
+// Read from `body` until `buf` is full or the body ends, returning the number
+// of bytes read.
+fastly::expected<std::size_t> fill(Body &body, std::vector<std::uint8_t> &buf) {
+  std::size_t filled{0};
+  while (filled < buf.size()) {
+    auto read{body.read(buf.data() + filled, buf.size() - filled)};
+    if (!read) {
+      return read;
+    }
+    if (*read == 0) {
+      break;
+    }
+    filled += *read;
+  }
+  return filled;
+}
+
+} // namespace
+
+expected<std::optional<ChunkedKVStore>>
+ChunkedKVStore::open(std::string_view name, std::size_t chunk_size,
+                     std::size_t max_in_flight) {
+  auto store{KVStore::open(name)};
+  if (!store) {
+    return unexpected(std::move(store.error()));
+  }
+  if (!*store) {
+    return std::nullopt;
+  }
+  return ChunkedKVStore(std::move(**store), std::string(name),
+                        std::max<std::size_t>(chunk_size, 1),
+                        std::max<std::size_t>(max_in_flight, 1));
+}
+
+expected<> ChunkedKVStore::insert(std::string_view key, Body value) const {
+  std::vector<std::uint8_t> buf(this->chunk_size_);
+  auto read{fill(value, buf)};
+  if (!read) {
+    // The value itself couldn't be read.
+    return unexpected(KVStoreError::item_bad_request());
+  }
+  auto old{current_manifest(this->store_, key)};
+
+  if (*read < this->chunk_size_) {
+    buf.resize(*read);
+    auto inserted{this->store_.insert(key, Body(std::move(buf)))};
+    if (inserted && old) {
+      erase_chunks(this->name_, key, std::move(*old), this->max_in_flight_);
+    }
+    return inserted;
+  }
+
+  Manifest manifest{new_nonce(), 0, 0};
+  std::deque<PendingInsertHandle> pending;
+  auto write_chunks{[&]() -> expected<> {
+    while (*read > 0) {
+      buf.resize(*read);
+      manifest.size += *read;
+      auto handle{this->store_.build_insert().execute_async(
+          manifest.chunk_key(key, manifest.chunks++), Body(std::move(buf)))};
+      if (!handle) {
+        return unexpected(std::move(handle.error()));
+      }
+      pending.push_back(*handle);
+      if (pending.size() >= this->max_in_flight_) {
+        auto done{this->store_.pending_insert_wait(pending.front())};
+        pending.pop_front();
+        if (!done) {
+          return done;
+        }
+      }
+      buf = std::vector<std::uint8_t>(this->chunk_size_);
+      read = fill(value, buf);
+      if (!read) {
+        return unexpected(KVStoreError::item_bad_request());
+      }
+    }
+    for (; !pending.empty(); pending.pop_front()) {
+      auto done{this->store_.pending_insert_wait(pending.front())};
+      if (!done) {
+        return done;
+      }
+    }
+    return this->store_.build_insert()
+        .metadata(manifest.metadata())
+        .execute(std::string(key), Body());
+  }};
+
+  auto written{write_chunks()};
+  if (!written) {
+    // Nothing refers to the chunks written so far.
+    erase_chunks(this->name_, key, std::move(manifest), this->max_in_flight_);
+  } else if (old) {
+    erase_chunks(this->name_, key, std::move(*old), this->max_in_flight_);
+  }
+  return written;
+}
+
+expected<Body> ChunkedKVStore::lookup(std::string_view key) const {
+  for (int attempt{1};; attempt++) {
+    auto found{this->store_.lookup(key)};
+    if (!found) {
+      return unexpected(std::move(found.error()));
+    }
+    auto manifest{parse_manifest(*found)};
+    if (!manifest) {
+      return unexpected(std::move(manifest.error()));
+    }
+    if (!*manifest) {
+      return found->take_body();
+    }
+    Body body;
+    auto read{read_chunks(
+        this->store_, key, **manifest, this->max_in_flight_,
+        [&](LookupResponse &chunk) { body.append(chunk.take_body()); })};
+    if (read) {
+      return body;
+    }
+    if (!chunk_missing(read) || attempt == max_read_attempts) {
+      return unexpected(std::move(read.error()));
+    }
+  }
+}
+
+expected<> ChunkedKVStore::stream_to(std::string_view key,
+                                     http::StreamingBody &out) const {
+  for (int attempt{1};; attempt++) {
+    auto found{this->store_.lookup(key)};
+    if (!found) {
+      return unexpected(std::move(found.error()));
+    }
+    auto manifest{parse_manifest(*found)};
+    if (!manifest) {
+      return unexpected(std::move(manifest.error()));
+    }
+    if (!*manifest) {
+      found->append_to(out);
+      return {};
+    }
+    bool started{false};
+    auto read{read_chunks(this->store_, key, **manifest, this->max_in_flight_,
+                          [&](LookupResponse &chunk) {
+                            started = true;
+                            chunk.append_to(out);
+                          })};
+    // Once part of the value has been sent, starting over would mix it with
+    // another value.
+    if (read || started || !chunk_missing(read) ||
+        attempt == max_read_attempts) {
+      return read;
+    }
+  }
+}
+
+expected<> ChunkedKVStore::erase(std::string_view key) const {
+  auto old{current_manifest(this->store_, key)};
+  auto erased{this->store_.erase(key)};
+  if (erased && old) {
+    erase_chunks(this->name_, key, std::move(*old), this->max_in_flight_);
+  }
+  return erased;
+}
+
+} // namespace fastly::kv_store
@@ -0,0 +1,333 @@
+#include "hash.h"
+#include <fastly/director.h>
+#include <random>
+
+namespace fastly::director {
+
+namespace {
+
+std::minstd_rand &rng() {
+  static std::minstd_rand gen{std::random_device{}()};
+  return gen;
+}
+
+// 64-bit FNV-1a, followed by a finalizer so that nearby keys spread over the
+// whole range.
+uint64_t hash_key(std::string_view key, uint64_t seed = 0) {
+  auto h{fastly::detail::fnv1a(key, seed)};
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// A member picked at random among the usable ones, in proportion to weight.
+size_t weighted_random(const std::vector<Member> &members,
+                       const std::vector<bool> &usable) {
+  uint64_t total{0};
+  for (size_t i{0}; i < members.size(); i++) {
+    if (usable[i]) {
+      total += members[i].weight;
+    }
+  }
+  size_t fallback{0};
+  if (total > 0) {
+    std::uniform_int_distribution<uint64_t> dist(0, total - 1);
+    auto target{dist(rng())};
+    for (size_t i{0}; i < members.size(); i++) {
+      if (!usable[i]) {
+        continue;
+      }
+      if (target < members[i].weight) {
+        return i;
+      }
+      target -= members[i].weight;
+    }
+  }
+  // Only zero weights are left.
+  while (!usable[fallback]) {
+    fallback++;
+  }
+  return fallback;
+}
+
+} // namespace
+
+Director::Director(std::vector<Member> members)
+    : members_(std::move(members)), backends_(members_.size()),
+      healthy_(members_.size()) {}
+
+bool Director::usable(size_t member) {
+  auto &healthy{this->healthy_[member]};
+  if (!healthy) {
+    auto &backend{this->backends_[member]};
+    if (!backend) {
+      if (auto found{backend::Backend::from_name(this->members_[member].name)};
+          found) {
+        backend.emplace(std::move(*found));
+      }
+    }
+    if (!backend) {
+      healthy = false;
+    } else {
+      // Backends without a health check report `Unknown`, and a failed check
+      // says nothing about the backend, so both count as healthy.
+      auto health{backend->is_healthy()};
+      healthy = !health || *health != backend::BackendHealth::Unhealthy;
+    }
+  }
+  return *healthy;
+}
+
+std::optional<size_t> Director::choose_index(http::Request &req) {
+  std::vector<bool> usable(this->members_.size());
+  bool any{false};
+  for (size_t i{0}; i < this->members_.size(); i++) {
+    usable[i] = this->usable(i);
+    any = any || usable[i];
+  }
+  if (!any) {
+    return std::nullopt;
+  }
+  return this->pick(req, usable);
+}
+
+fastly::expected<backend::Backend> Director::choose(http::Request &req) {
+  auto member{this->choose_index(req)};
+  if (!member) {
+    return fastly::unexpected(
+        FastlyError::io_error("no healthy backend in director"));
+  }
+  return this->backend_at(*member).clone();
+}
+
+void Director::mark_unhealthy(std::string_view backend_name) {
+  for (size_t i{0}; i < this->members_.size(); i++) {
+    if (this->members_[i].name == backend_name) {
+      this->healthy_[i] = false;
+    }
+  }
+}
+
+std::function<void()> Director::on_send(size_t) { return nullptr; }
+
+fastly::expected<http::Response> Director::send(http::Request req) {
+  auto member{this->choose_index(req)};
+  if (!member) {
+    return fastly::unexpected(
+        FastlyError::io_error("no healthy backend in director"));
+  }
+  auto release{this->on_send(*member)};
+  auto resp{req.send(this->backend_at(*member))};
+  if (release) {
+    release();
+  }
+  return resp;
+}
+
+fastly::expected<http::request::PendingRequest>
+Director::send_async(http::Request req) {
+  auto member{this->choose_index(req)};
+  if (!member) {
+    return fastly::unexpected(
+        FastlyError::io_error("no healthy backend in director"));
+  }
+  auto release{this->on_send(*member)};
+  auto pending{req.send_async(this->backend_at(*member))};
+  if (!pending) {
+    if (release) {
+      release();
+    }
+    return pending;
+  }
+  if (release) {
+    auto in_flight{std::make_shared<fastly::detail::InFlight>()};
+    in_flight->backend = this->members_[*member].name;
+    in_flight->release = std::move(release);
+    pending->in_flight_ = std::move(in_flight);
+  }
+  return pending;
+}
+
+RoundRobin::RoundRobin(std::vector<Member> members)
+    : Director(std::move(members)), current_(this->members().size()) {
+  uint64_t total{0};
+  for (auto &m : this->members()) {
+    total += m.weight;
+  }
+  if (total == 0) {
+    return;
+  }
+  // Start the rotation at a random step of its cycle.
+  std::vector<bool> all(this->members().size(), true);
+  auto steps{std::uniform_int_distribution<uint64_t>(0, total - 1)(rng())};
+  for (uint64_t i{0}; i < steps; i++) {
+    this->step(all);
+  }
+}
+
+size_t RoundRobin::step(const std::vector<bool> &usable) {
+  auto &members{this->members()};
+  int64_t total{0};
+  std::optional<size_t> best;
+  for (size_t i{0}; i < members.size(); i++) {
+    if (!usable[i]) {
+      continue;
+    }
+    this->current_[i] += members[i].weight;
+    total += members[i].weight;
+    if (!best || this->current_[i] > this->current_[*best]) {
+      best = i;
+    }
+  }
+  this->current_[*best] -= total;
+  return *best;
+}
+
+size_t RoundRobin::pick(http::Request &, const std::vector<bool> &usable) {
+  return this->step(usable);
+}
+
+Random::Random(std::vector<Member> members) : Director(std::move(members)) {}
+
+size_t Random::pick(http::Request &, const std::vector<bool> &usable) {
+  return weighted_random(this->members(), usable);
+}
+
+ConsistentHash::ConsistentHash(std::vector<Member> members, KeyFn key,
+                               uint32_t table_size)
+    : Director(std::move(members)), key_(std::move(key)) {
+  auto &pool{this->members()};
+  uint64_t total{0};
+  for (auto &m : pool) {
+    total += m.weight;
+  }
+  if (pool.empty() || total == 0 || table_size < 2) {
+    return;
+  }
+  auto size{static_cast<uint64_t>(table_size)};
+  // Each member walks the table in its own permutation, given by an offset
+  // and a skip derived from its name, and claims the next free slot on each
+  // of its turns. A member gets as many turns per round as its weight.
+  std::vector<uint64_t> offset(pool.size());
+  std::vector<uint64_t> skip(pool.size());
+  std::vector<uint64_t> next(pool.size(), 0);
+  for (size_t i{0}; i < pool.size(); i++) {
+    offset[i] = hash_key(pool[i].name) % size;
+    skip[i] = hash_key(pool[i].name, 0x9e3779b97f4a7c15ULL) % (size - 1) + 1;
+  }
+  constexpr uint32_t EMPTY{UINT32_MAX};
+  this->table_.assign(table_size, EMPTY);
+  uint64_t filled{0};
+  while (filled < size) {
+    for (size_t i{0}; i < pool.size() && filled < size; i++) {
+      for (uint32_t turn{0}; turn < pool[i].weight && filled < size; turn++) {
+        auto slot{(offset[i] + next[i] * skip[i]) % size};
+        while (this->table_[slot] != EMPTY) {
+          next[i]++;
+          // With a table size that isn't prime, a permutation can cycle
+          // before reaching every slot; continue with a linear scan then.
+          slot = next[i] < size ? (offset[i] + next[i] * skip[i]) % size
+                                : (slot + 1) % size;
+        }
+        next[i]++;
+        this->table_[slot] = static_cast<uint32_t>(i);
+        filled++;
+      }
+    }
+  }
+}
+
+size_t ConsistentHash::pick_key(std::string_view key,
+                                const std::vector<bool> &usable) {
+  if (!this->table_.empty()) {
+    auto slot{hash_key(key) % this->table_.size()};
+    for (size_t n{0}; n < this->table_.size(); n++) {
+      auto member{this->table_[(slot + n) % this->table_.size()]};
+      if (usable[member]) {
+        return member;
+      }
+    }
+  }
+  // No table, e.g. all weights are zero.
+  return weighted_random(this->members(), usable);
+}
+
+size_t ConsistentHash::pick(http::Request &req,
+                            const std::vector<bool> &usable) {
+  return this->pick_key(this->key_ ? this->key_(req) : req.get_url(), usable);
+}
+
+fastly::expected<backend::Backend>
+ConsistentHash::choose(std::string_view key) {
+  std::vector<bool> usable(this->members().size());
+  bool any{false};
+  for (size_t i{0}; i < usable.size(); i++) {
+    usable[i] = this->usable(i);
+    any = any || usable[i];
+  }
+  if (!any) {
+    return fastly::unexpected(
+        FastlyError::io_error("no healthy backend in director"));
+  }
+  return this->backend_at(this->pick_key(key, usable)).clone();
+}
+
+LeastInFlight::LeastInFlight(std::vector<Member> members)
+    : Director(std::move(members)),
+      counts_(std::make_shared<std::vector<uint32_t>>(this->members().size())) {
+}
+
+uint32_t LeastInFlight::in_flight(std::string_view backend_name) const {
+  uint32_t total{0};
+  for (size_t i{0}; i < this->members().size(); i++) {
+    if (this->members()[i].name == backend_name) {
+      total += (*this->counts_)[i];
+    }
+  }
+  return total;
+}
+
+size_t LeastInFlight::pick(http::Request &, const std::vector<bool> &usable) {
+  auto &members{this->members()};
+  auto &counts{*this->counts_};
+  std::optional<size_t> best;
+  uint32_t ties{0};
+  for (size_t i{0}; i < members.size(); i++) {
+    if (!usable[i] || members[i].weight == 0) {
+      continue;
+    }
+    if (best) {
+      // Compare counts[i] / weight[i] against counts[best] / weight[best].
+      auto lhs{static_cast<uint64_t>(counts[i]) * members[*best].weight};
+      auto rhs{static_cast<uint64_t>(counts[*best]) * members[i].weight};
+      if (lhs > rhs) {
+        continue;
+      }
+      if (lhs == rhs) {
+        // Reservoir sampling keeps each tied member equally likely.
+        ties++;
+        if (std::uniform_int_distribution<uint32_t>(0, ties)(rng()) != 0) {
+          continue;
+        }
+      } else {
+        ties = 0;
+      }
+    }
+    best = i;
+  }
+  if (!best) {
+    return weighted_random(members, usable);
+  }
+  return *best;
+}
+
+std::function<void()> LeastInFlight::on_send(size_t member) {
+  auto counts{this->counts_};
+  (*counts)[member]++;
+  return [counts, member]() { (*counts)[member]--; };
+}
+
+} // namespace fastly::director
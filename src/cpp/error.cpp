@@ -2,6 +2,16 @@
 
 namespace fastly::error {
 
+FastlyError FastlyError::io_error(std::string_view message) {
+  return {fastly::sys::error::m_static_error_fastly_error_io(
+      static_cast<std::string>(message))};
+}
+
+FastlyError FastlyError::circuit_open(std::string_view backend) {
+  return {fastly::sys::error::m_static_error_fastly_error_circuit_open(
+      static_cast<std::string>(backend))};
+}
+
 FastlyErrorCode FastlyError::error_code() { return this->err->error_code(); }
 
 std::string FastlyError::error_msg() {
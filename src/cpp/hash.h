@@ -0,0 +1,53 @@
+#ifndef FASTLY_SRC_HASH_H
+#define FASTLY_SRC_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <string>
+#include <string_view>
+
+namespace fastly::detail {
+
+// 64-bit FNV-1a, fed a piece at a time. A non-zero `seed` gives an
+// independent hash function.
+// This is intended for internal use only.
+class Fnv1a {
+public:
+  explicit Fnv1a(uint64_t seed = 0) : state_(OFFSET_BASIS ^ seed) {}
+
+  void bytes(const void *data, size_t len) {
+    auto *p{static_cast<const uint8_t *>(data)};
+    for (size_t i{0}; i < len; i++) {
+      state_ ^= p[i];
+      state_ *= PRIME;
+    }
+  }
+  void bytes(std::string_view s) { this->bytes(s.data(), s.size()); }
+
+  uint64_t finish() const { return state_; }
+
+private:
+  static constexpr uint64_t OFFSET_BASIS{0xcbf29ce484222325ULL};
+  static constexpr uint64_t PRIME{0x100000001b3ULL};
+
+  uint64_t state_;
+};
+
+// The 64-bit FNV-1a hash of `data`.
+inline uint64_t fnv1a(std::string_view data, uint64_t seed = 0) {
+  Fnv1a h{seed};
+  h.bytes(data);
+  return h.finish();
+}
+
+// A surrogate key for the cache item `cache_key`: `prefix`, then a hash of
+// the key. Cache keys can be arbitrary bytes, and surrogate keys can't.
+inline std::string surrogate_key(std::string_view prefix,
+                                 std::string_view cache_key) {
+  return std::format("{}{:016x}", prefix, fnv1a(cache_key));
+}
+
+} // namespace fastly::detail
+
+#endif
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <fastly/http/adaptive.h>
+#include <format>
+
+namespace fastly::http::adaptive {
+
+namespace {
+
+// Values below 8 get a bucket each; above that, each power of two is split
+// into 8 buckets by the three bits below the leading one.
+size_t bucket_of(uint64_t value) {
+  if (value < 8) {
+    return value;
+  }
+  auto msb{static_cast<size_t>(std::bit_width(value)) - 1};
+  auto sub{static_cast<size_t>(value >> (msb - 3)) & 7};
+  return std::min((msb - 2) * 8 + sub, LatencyHistogram::BUCKETS - 1);
+}
+
+// The largest value that falls into `bucket`.
+uint64_t bucket_end(size_t bucket) {
+  if (bucket < 8) {
+    return bucket;
+  }
+  auto shift{bucket / 8 - 1};
+  return ((8 + bucket % 8 + 1) << shift) - 1;
+}
+
+int64_t now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+template <typename T> bool parse_number(std::string_view text, T &out) {
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+  return ec == std::errc() && end == text.data() + text.size();
+}
+
+// The stored value is "<decayed at> <histogram>", with the time in
+// milliseconds since the epoch.
+std::optional<LatencyHistogram>
+parse_entry(fastly::kv_store::LookupResponse &stored, int64_t &decayed_at) {
+  auto bytes{stored.take_body_bytes()};
+  std::string_view text{reinterpret_cast<const char *>(bytes.data()),
+                        bytes.size()};
+  auto space{text.find(' ')};
+  int64_t time;
+  if (space == std::string_view::npos ||
+      !parse_number(text.substr(0, space), time)) {
+    return std::nullopt;
+  }
+  auto histogram{LatencyHistogram::parse(text.substr(space + 1))};
+  if (histogram) {
+    decayed_at = time;
+  }
+  return histogram;
+}
+
+} // namespace
+
+void LatencyHistogram::record(std::chrono::microseconds latency) {
+  auto us{static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0))};
+  this->counts_[bucket_of(us)]++;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+  for (size_t i{0}; i < BUCKETS; i++) {
+    this->counts_[i] += other.counts_[i];
+  }
+}
+
+void LatencyHistogram::decay() {
+  for (auto &count : this->counts_) {
+    count /= 2;
+  }
+}
+
+uint64_t LatencyHistogram::count() const {
+  uint64_t total{0};
+  for (auto count : this->counts_) {
+    total += count;
+  }
+  return total;
+}
+
+std::optional<std::chrono::microseconds>
+LatencyHistogram::percentile(double quantile) const {
+  auto total{this->count()};
+  if (total == 0) {
+    return std::nullopt;
+  }
+  auto rank{static_cast<uint64_t>(
+      std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(total)))};
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen{0};
+  for (size_t i{0}; i < BUCKETS; i++) {
+    seen += this->counts_[i];
+    if (seen >= rank) {
+      return std::chrono::microseconds(bucket_end(i));
+    }
+  }
+  return std::chrono::microseconds(bucket_end(BUCKETS - 1));
+}
+
+// Buckets in use as "<bucket>:<count>", separated by commas.
+std::string LatencyHistogram::serialize() const {
+  std::string out;
+  for (size_t i{0}; i < BUCKETS; i++) {
+    if (this->counts_[i] == 0) {
+      continue;
+    }
+    if (!out.empty()) {
+      out.push_back(',');
+    }
+    out += std::format("{}:{}", i, this->counts_[i]);
+  }
+  return out;
+}
+
+std::optional<LatencyHistogram>
+LatencyHistogram::parse(std::string_view text) {
+  LatencyHistogram histogram;
+  while (!text.empty()) {
+    auto comma{text.find(',')};
+    auto item{text.substr(0, comma)};
+    text = comma == std::string_view::npos ? std::string_view()
+                                           : text.substr(comma + 1);
+    auto colon{item.find(':')};
+    if (colon == std::string_view::npos) {
+      return std::nullopt;
+    }
+    size_t bucket;
+    uint64_t count;
+    if (!parse_number(item.substr(0, colon), bucket) ||
+        !parse_number(item.substr(colon + 1), count) || bucket >= BUCKETS) {
+      return std::nullopt;
+    }
+    histogram.counts_[bucket] = count;
+  }
+  return histogram;
+}
+
+AdaptivePolicy::AdaptivePolicy()
+    : percentile_(0.99), factor_(2.0), first_byte_floor_(1000),
+      first_byte_ceiling_(60000), min_samples_(50), decay_interval_(300000),
+      key_prefix_("latency/") {}
+
+AdaptivePolicy AdaptivePolicy::percentile(double quantile) && {
+  this->percentile_ = std::clamp(quantile, 0.0, 1.0);
+  return std::move(*this);
+}
+
+AdaptivePolicy AdaptivePolicy::factor(double factor) && {
+  this->factor_ = factor;
+  return std::move(*this);
+}
+
+AdaptivePolicy
+AdaptivePolicy::first_byte_timeout(std::chrono::milliseconds floor,
+                                   std::chrono::milliseconds ceiling) && {
+  this->first_byte_floor_ = floor;
+  this->first_byte_ceiling_ = std::max(floor, ceiling);
+  return std::move(*this);
+}
+
+AdaptivePolicy AdaptivePolicy::min_samples(uint64_t samples) && {
+  this->min_samples_ = samples;
+  return std::move(*this);
+}
+
+AdaptivePolicy
+AdaptivePolicy::decay_interval(std::chrono::milliseconds interval) && {
+  this->decay_interval_ = interval;
+  return std::move(*this);
+}
+
+AdaptivePolicy AdaptivePolicy::key_prefix(std::string_view prefix) && {
+  this->key_prefix_ = std::string(prefix);
+  return std::move(*this);
+}
+
+AdaptiveTimeouts::AdaptiveTimeouts(std::string_view kv_store_name,
+                                   AdaptivePolicy policy)
+    : policy_(std::move(policy)) {
+  if (auto opened{fastly::kv_store::KVStore::open(kv_store_name)};
+      opened && *opened) {
+    this->store_.emplace(std::move(**opened));
+  }
+}
+
+AdaptiveTimeouts::Entry &
+AdaptiveTimeouts::load(std::string_view backend_name) {
+  if (auto found{this->entries_.find(backend_name)};
+      found != this->entries_.end()) {
+    return found->second;
+  }
+  Entry entry;
+  if (this->store_) {
+    auto key{this->policy_.key_prefix_ + std::string(backend_name)};
+    if (auto stored{this->store_->lookup(key)}) {
+      if (auto histogram{parse_entry(*stored, entry.decayed_at)}) {
+        entry.shared = *histogram;
+        entry.combined = *histogram;
+      }
+    }
+  }
+  return this->entries_.emplace(std::string(backend_name), std::move(entry))
+      .first->second;
+}
+
+void AdaptiveTimeouts::observe(std::string_view backend_name,
+                               std::chrono::microseconds time_to_first_byte) {
+  auto &entry{this->load(backend_name)};
+  entry.local.record(time_to_first_byte);
+  entry.combined.record(time_to_first_byte);
+}
+
+void AdaptiveTimeouts::observe(const timing::Record &record) {
+  auto ttfb{record.time_to_first_byte()};
+  // A failed send says nothing about latency, only that it timed out or
+  // couldn't connect.
+  if (!ttfb || record.failed) {
+    return;
+  }
+  auto alias{this->aliases_.find(record.backend)};
+  this->observe(alias != this->aliases_.end() ? std::string_view(alias->second)
+                                              : record.backend,
+                *ttfb);
+}
+
+void AdaptiveTimeouts::observe_timings() {
+  auto &records{timing::records()};
+  if (records.size() < this->timings_seen_) {
+    // The records were cleared since the last call.
+    this->timings_seen_ = 0;
+  }
+  for (; this->timings_seen_ < records.size(); this->timings_seen_++) {
+    auto &record{records[this->timings_seen_]};
+    if (!record.response) {
+      // Still pending; look at it again next time.
+      break;
+    }
+    this->observe(record);
+  }
+}
+
+const LatencyHistogram &
+AdaptiveTimeouts::histogram(std::string_view backend_name) {
+  return this->load(backend_name).combined;
+}
+
+std::optional<std::chrono::milliseconds>
+AdaptiveTimeouts::first_byte_timeout(std::string_view backend_name) {
+  auto &histogram{this->load(backend_name).combined};
+  if (histogram.count() < this->policy_.min_samples_ ||
+      histogram.count() == 0) {
+    return std::nullopt;
+  }
+  auto us{static_cast<double>(
+              histogram.percentile(this->policy_.percentile_)->count()) *
+          this->policy_.factor_};
+  std::chrono::milliseconds timeout{
+      static_cast<int64_t>(std::ceil(us / 1000.0))};
+  return std::clamp(timeout, this->policy_.first_byte_floor_,
+                    this->policy_.first_byte_ceiling_);
+}
+
+fastly::backend::BackendSpec
+AdaptiveTimeouts::apply(std::string_view backend_name,
+                        fastly::backend::BackendSpec spec) {
+  if (auto timeout{this->first_byte_timeout(backend_name)}) {
+    return std::move(spec).first_byte_timeout(*timeout);
+  }
+  return spec;
+}
+
+fastly::expected<fastly::backend::Backend>
+AdaptiveTimeouts::backend(std::string_view name,
+                          fastly::backend::BackendSpec spec) {
+  auto adapted{this->apply(name, std::move(spec))};
+  auto backend{fastly::backend::BackendRegistry::get_or_create(name, adapted)};
+  if (backend) {
+    this->aliases_.insert_or_assign(backend->name(), std::string(name));
+  }
+  return backend;
+}
+
+void AdaptiveTimeouts::flush() {
+  if (!this->store_) {
+    return;
+  }
+  // After ten halvings an entry holds next to nothing, so there's no point in
+  // keeping it around for longer.
+  auto ttl{10 * this->policy_.decay_interval_};
+  for (auto &[name, entry] : this->entries_) {
+    if (entry.local.count() == 0) {
+      continue;
+    }
+    auto key{this->policy_.key_prefix_ + name};
+    // Re-read the entry and only write if nobody else did in the meantime, so
+    // that concurrent flushes don't drop each other's observations. Under
+    // heavy contention, give up after a few attempts; losing a batch of
+    // observations only makes the histogram a little less current.
+    for (int attempt{0}; attempt < 3; attempt++) {
+      LatencyHistogram merged;
+      std::optional<uint64_t> generation;
+      auto now{now_ms()};
+      int64_t decayed_at{now};
+      if (auto stored{this->store_->lookup(key)}) {
+        generation = stored->current_generation();
+        if (auto histogram{parse_entry(*stored, decayed_at)}) {
+          merged = *histogram;
+        }
+      }
+      merged.merge(entry.local);
+      if (now - decayed_at >= this->policy_.decay_interval_.count()) {
+        merged.decay();
+        decayed_at = now;
+      }
+      auto builder{this->store_->build_insert().time_to_live(ttl)};
+      if (generation) {
+        builder = std::move(builder).if_generation_match(*generation);
+      }
+      auto value{std::format("{} {}", decayed_at, merged.serialize())};
+      if (std::move(builder).execute(key, Body(value))) {
+        entry.shared = merged;
+        entry.combined = merged;
+        entry.local = LatencyHistogram();
+        entry.decayed_at = decayed_at;
+        break;
+      }
+    }
+  }
+}
+
+} // namespace fastly::http::adaptive
@@ -1,6 +1,12 @@
+#include "write_all.h"
+#include <algorithm>
+#include <array>
+#include <fastly/background.h>
 #include <fastly/expected.h>
 #include <fastly/http/body.h>
+#include <fastly/http/timing.h>
 #include <fastly/sdk-sys.h>
+#include <span>
 
 namespace fastly::http {
 
@@ -59,6 +65,16 @@ void Body::append(Body other) {
   return this->bod->append(std::move(other.bod));
 }
 
+std::optional<uint64_t> Body::known_length() {
+  this->flush();
+  uint64_t len;
+  if (this->bod->known_length(len)) {
+    return {len};
+  } else {
+    return std::nullopt;
+  }
+}
+
 fastly::expected<std::size_t> Body::read(uint8_t *buf, std::size_t bufsize) {
   rust::Slice<uint8_t> slice{buf, bufsize};
   fastly::sys::error::FastlyError *err;
@@ -66,6 +82,9 @@ fastly::expected<std::size_t> Body::read(uint8_t *buf, std::size_t bufsize) {
   if (err != nullptr) {
     return fastly::unexpected(err);
   } else {
+    if (this->timing_) {
+      timing::detail::body_read(*this->timing_, ret);
+    }
     return ret;
   }
 }
@@ -140,6 +159,9 @@ fastly::expected<void> StreamingBody::finish() {
   if (err != nullptr) {
     return fastly::unexpected(err);
   } else {
+    if (this->to_client_) {
+      fastly::background::detail::response_sent();
+    }
     return fastly::expected<void>();
   }
 }
@@ -174,3 +196,210 @@ StreamingBody::append_trailer(std::string_view header_name,
 }
 
 } // namespace fastly::http
+
+namespace fastly::detail {
+
+using fastly::http::Body;
+using fastly::http::StreamingBody;
+
+// Shared state behind the readers of a teed body.
+//
+// Bytes are addressed by their absolute offset in the body. `head` is the
+// number of bytes pulled from `source` so far, and the bytes in
+// `[min(pos), head)` are kept in `ring` at `offset % ring.size()`.
+struct TeeState {
+  TeeState(Body body, size_t capacity, StreamingBody *sink)
+      : source(std::move(body)), ring(std::max<size_t>(capacity, 1)),
+        sink(sink) {
+    this->source.flush();
+  }
+
+  Body source;
+  std::vector<uint8_t> ring;
+  StreamingBody *sink;
+  uint64_t head{0};
+  std::array<uint64_t, 2> pos{0, 0};
+  std::array<bool, 2> active{false, false};
+  bool eof{false};
+
+  // Pull the next block from `source` into the ring, returning its size.
+  fastly::expected<size_t> pull() {
+    uint64_t min_pos{this->head};
+    for (size_t i{0}; i < this->pos.size(); i++) {
+      if (this->active[i]) {
+        min_pos = std::min(min_pos, this->pos[i]);
+      }
+    }
+    size_t free{this->ring.size() - static_cast<size_t>(this->head - min_pos)};
+    if (free == 0) {
+      return fastly::unexpected(fastly::FastlyError::io_error(
+          "tee buffer is full: one reader is too far ahead of the other"));
+    }
+    size_t off{static_cast<size_t>(this->head % this->ring.size())};
+    size_t len{std::min(free, this->ring.size() - off)};
+    auto *dst{this->ring.data() + off};
+
+    // Drain whatever the body already buffered before reading from the host.
+    size_t got{0};
+    if (this->source.in_avail() > 0) {
+      got = static_cast<size_t>(this->source.sgetn(
+          reinterpret_cast<char *>(dst),
+          std::min<std::streamsize>(this->source.in_avail(), len)));
+    } else {
+      auto read{this->source.read(dst, len)};
+      if (!read) {
+        return fastly::unexpected(std::move(read.error()));
+      }
+      got = *read;
+    }
+    if (got == 0) {
+      this->eof = true;
+      return 0;
+    }
+    if (this->sink != nullptr) {
+      if (auto res{write_all(*this->sink, dst, got)}; !res) {
+        return fastly::unexpected(std::move(res.error()));
+      }
+    }
+    this->head += got;
+    return got;
+  }
+
+  // The contiguous run of buffered bytes reader `id` can read next, pulling
+  // more from `source` if it has read everything buffered so far. Empty at the
+  // end of the body.
+  fastly::expected<std::span<uint8_t>> window(size_t id) {
+    if (this->pos[id] == this->head) {
+      if (this->eof) {
+        return std::span<uint8_t>();
+      }
+      auto pulled{this->pull()};
+      if (!pulled) {
+        return fastly::unexpected(std::move(pulled.error()));
+      } else if (*pulled == 0) {
+        return std::span<uint8_t>();
+      }
+    }
+    size_t off{static_cast<size_t>(this->pos[id] % this->ring.size())};
+    size_t len{std::min(static_cast<size_t>(this->head - this->pos[id]),
+                        this->ring.size() - off)};
+    return std::span<uint8_t>(this->ring.data() + off, len);
+  }
+};
+
+} // namespace fastly::detail
+
+namespace fastly::http {
+
+std::pair<TeeReader, TeeReader> Body::tee(size_t capacity) && {
+  auto state{std::make_shared<fastly::detail::TeeState>(std::move(*this),
+                                                        capacity, nullptr)};
+  state->active = {true, true};
+  return {TeeReader(state, 0), TeeReader(state, 1)};
+}
+
+TeeReader Body::tee(StreamingBody &sink) && {
+  auto state{std::make_shared<fastly::detail::TeeState>(std::move(*this),
+                                                        16 * 1024, &sink)};
+  state->active = {true, false};
+  return TeeReader(std::move(state), 0);
+}
+
+TeeReader::TeeReader(std::shared_ptr<fastly::detail::TeeState> state,
+                     size_t id)
+    : std::istream(this), state_(std::move(state)), id_(id) {
+  this->setg(nullptr, nullptr, nullptr);
+}
+
+TeeReader::TeeReader(TeeReader &&old)
+    : std::istream(this), state_(std::move(old.state_)), id_(old.id_) {
+  this->setg(old.eback(), old.gptr(), old.egptr());
+  old.setg(nullptr, nullptr, nullptr);
+}
+
+TeeReader::~TeeReader() {
+  if (this->state_) {
+    this->state_->active[this->id_] = false;
+  }
+}
+
+// Account for what was consumed from the current window, then point the get
+// area at the next window of the ring buffer.
+fastly::expected<bool> TeeReader::refill() {
+  if (!this->state_ || !this->state_->active[this->id_]) {
+    return false;
+  }
+  this->state_->pos[this->id_] += this->gptr() - this->eback();
+  this->setg(nullptr, nullptr, nullptr);
+  auto window{this->state_->window(this->id_)};
+  if (!window) {
+    return fastly::unexpected(std::move(window.error()));
+  } else if (window->empty()) {
+    return false;
+  }
+  auto *data{reinterpret_cast<char *>(window->data())};
+  this->setg(data, data, data + window->size());
+  return true;
+}
+
+int TeeReader::underflow() {
+  if (this->gptr() == this->egptr()) {
+    bool more{this->refill()
+                  .or_else([](fastly::FastlyError err) {
+                    std::cerr << err.error_msg() << std::endl;
+                    std::abort();
+                  })
+                  .value()};
+    if (!more) {
+      return traits_type::eof();
+    }
+  }
+  return traits_type::to_int_type(*this->gptr());
+}
+
+fastly::expected<size_t> TeeReader::read(uint8_t *buf, size_t bufsize) {
+  if (this->gptr() == this->egptr()) {
+    auto more{this->refill()};
+    if (!more) {
+      return fastly::unexpected(std::move(more.error()));
+    } else if (!*more) {
+      return 0;
+    }
+  }
+  size_t len{std::min(bufsize, static_cast<size_t>(this->egptr() -
+                                                   this->gptr()))};
+  std::copy_n(this->gptr(), len, reinterpret_cast<char *>(buf));
+  this->gbump(static_cast<int>(len));
+  return len;
+}
+
+fastly::expected<void> TeeReader::detach() {
+  if (!this->state_ || !this->state_->active[this->id_]) {
+    return fastly::expected<void>();
+  }
+  this->state_->pos[this->id_] += this->gptr() - this->eback();
+  this->setg(nullptr, nullptr, nullptr);
+  this->state_->active[this->id_] = false;
+
+  auto &state{*this->state_};
+  if (state.sink != nullptr && !state.eof) {
+    // Bytes still sitting in the body's own read buffer have to go through
+    // this program; everything after them is appended on the host.
+    std::array<char, 512> leftover;
+    while (state.source.in_avail() > 0) {
+      auto n{state.source.sgetn(leftover.data(), leftover.size())};
+      auto written{detail::write_all(
+          *state.sink, reinterpret_cast<uint8_t *>(leftover.data()),
+          static_cast<size_t>(n))};
+      if (!written) {
+        return fastly::unexpected(std::move(written.error()));
+      }
+    }
+    state.sink->flush();
+    state.sink->append(std::move(state.source));
+    state.eof = true;
+  }
+  return fastly::expected<void>();
+}
+
+} // namespace fastly::http
@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <charconv>
+#include <fastly/http/circuit.h>
+#include <format>
+
+namespace fastly::http::circuit {
+
+namespace {
+
+// Wall-clock milliseconds, since circuit state is shared between instances.
+int64_t now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string_view state_name(State state) {
+  switch (state) {
+  case State::Open:
+    return "open";
+  case State::HalfOpen:
+    return "half-open";
+  default:
+    return "closed";
+  }
+}
+
+// Parse the next space-separated integer out of `text`.
+bool parse_int(std::string_view &text, int64_t &out) {
+  auto start{text.find_first_not_of(' ')};
+  if (start == std::string_view::npos) {
+    return false;
+  }
+  text.remove_prefix(start);
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+  if (ec != std::errc()) {
+    return false;
+  }
+  text.remove_prefix(end - text.data());
+  return true;
+}
+
+// How long a write of circuit state is retried while other instances write
+// the same circuit.
+constexpr std::chrono::milliseconds SAVE_DEADLINE{250};
+
+} // namespace
+
+CircuitPolicy::CircuitPolicy()
+    : failure_threshold_(5), failure_window_(10000), open_duration_(30000),
+      failure_statuses_({StatusCode::BAD_GATEWAY,
+                         StatusCode::SERVICE_UNAVAILABLE,
+                         StatusCode::GATEWAY_TIMEOUT}),
+      fallback_(std::nullopt), key_prefix_("circuit/") {}
+
+CircuitPolicy CircuitPolicy::failure_threshold(uint32_t failures) && {
+  this->failure_threshold_ = std::max<uint32_t>(failures, 1);
+  return std::move(*this);
+}
+
+CircuitPolicy
+CircuitPolicy::failure_window(std::chrono::milliseconds window) && {
+  this->failure_window_ = window;
+  return std::move(*this);
+}
+
+CircuitPolicy
+CircuitPolicy::open_duration(std::chrono::milliseconds duration) && {
+  this->open_duration_ = duration;
+  return std::move(*this);
+}
+
+CircuitPolicy
+CircuitPolicy::failure_statuses(std::vector<StatusCode> statuses) && {
+  this->failure_statuses_ = std::move(statuses);
+  return std::move(*this);
+}
+
+CircuitPolicy CircuitPolicy::fallback(std::string_view backend_name) && {
+  this->fallback_ = std::string(backend_name);
+  return std::move(*this);
+}
+
+CircuitPolicy CircuitPolicy::key_prefix(std::string_view prefix) && {
+  this->key_prefix_ = std::string(prefix);
+  return std::move(*this);
+}
+
+CircuitBreaker::CircuitBreaker(std::string_view kv_store_name,
+                               CircuitPolicy policy)
+    : policy_(std::move(policy)) {
+  if (auto opened{fastly::kv_store::KVStore::open(kv_store_name)};
+      opened && *opened) {
+    this->store_.emplace(std::move(**opened));
+  }
+}
+
+// The stored value is "<state> <failures> <window start> <opened at>", with
+// times in milliseconds since the epoch.
+bool CircuitBreaker::parse(std::string_view text, Circuit &circuit) {
+  auto space{text.find(' ')};
+  auto name{text.substr(0, space)};
+  if (space != std::string_view::npos) {
+    text.remove_prefix(space);
+  }
+  int64_t failures, window_start, opened_at;
+  if (!parse_int(text, failures) || !parse_int(text, window_start) ||
+      !parse_int(text, opened_at)) {
+    return false;
+  }
+  circuit.state = name == "open"        ? State::Open
+                  : name == "half-open" ? State::HalfOpen
+                                        : State::Closed;
+  circuit.failures = static_cast<uint32_t>(failures);
+  circuit.window_start = window_start;
+  circuit.opened_at = opened_at;
+  return true;
+}
+
+std::string CircuitBreaker::serialize(const Circuit &circuit) {
+  return std::format("{} {} {} {}", state_name(circuit.state),
+                     circuit.failures, circuit.window_start,
+                     circuit.opened_at);
+}
+
+CircuitBreaker::Circuit &
+CircuitBreaker::load(std::string_view backend_name) {
+  if (auto found{this->circuits_.find(backend_name)};
+      found != this->circuits_.end()) {
+    return found->second;
+  }
+  Circuit circuit;
+  if (this->store_) {
+    auto key{this->policy_.key_prefix_ + std::string(backend_name)};
+    if (auto stored{this->store_->lookup(key)}) {
+      auto bytes{stored->take_body_bytes()};
+      parse({reinterpret_cast<const char *>(bytes.data()), bytes.size()},
+            circuit);
+    }
+  }
+  return this->circuits_.emplace(std::string(backend_name), circuit)
+      .first->second;
+}
+
+void CircuitBreaker::save(std::string_view backend_name,
+                          const std::function<bool(Circuit &)> &change) {
+  auto &circuit{this->load(backend_name)};
+  if (!this->store_) {
+    change(circuit);
+    return;
+  }
+  // Other instances may have written the circuit since it was loaded, so the
+  // change is applied to the stored state, and only written if nobody else
+  // has written it in between; otherwise it is applied again to the fresh
+  // state. Entries don't expire, since the times they hold already age out
+  // the failure window and the open period.
+  auto key{this->policy_.key_prefix_ + std::string(backend_name)};
+  Circuit changed;
+  auto updated{this->store_->update(
+      key,
+      [&](const std::optional<std::string> &current)
+          -> std::optional<std::string> {
+        changed = Circuit();
+        if (current) {
+          parse(*current, changed);
+        }
+        changed.probing = circuit.probing;
+        if (!change(changed)) {
+          return std::nullopt;
+        }
+        return serialize(changed);
+      },
+      SAVE_DEADLINE)};
+  if (updated) {
+    circuit = changed;
+  } else {
+    // The change still holds within this execution.
+    change(circuit);
+  }
+}
+
+State CircuitBreaker::state(std::string_view backend_name) {
+  auto &circuit{this->load(backend_name)};
+  if (circuit.state == State::Open &&
+      now_ms() >= circuit.opened_at + this->policy_.open_duration_.count()) {
+    return State::HalfOpen;
+  }
+  return circuit.state;
+}
+
+bool CircuitBreaker::allow(std::string_view backend_name) {
+  auto &circuit{this->load(backend_name)};
+  auto now{now_ms()};
+  auto open_for{this->policy_.open_duration_.count()};
+  // An open circuit is due for a probe once its open period is over. A
+  // half-open one is held by another instance's probe, unless that instance
+  // has been gone for a whole open period.
+  auto due{[&](const Circuit &c) { return now >= c.opened_at + open_for; }};
+  if (circuit.probing || circuit.state == State::Closed) {
+    return true;
+  }
+  if (!due(circuit)) {
+    return false;
+  }
+  bool allowed{false};
+  this->save(backend_name, [&](Circuit &stored) {
+    if (stored.probing || stored.state == State::Closed) {
+      allowed = true;
+      return false;
+    }
+    allowed = due(stored);
+    if (!allowed) {
+      return false;
+    }
+    stored.state = State::HalfOpen;
+    stored.opened_at = now;
+    stored.probing = true;
+    return true;
+  });
+  return allowed;
+}
+
+void CircuitBreaker::record_success(std::string_view backend_name) {
+  if (this->load(backend_name).state == State::Closed) {
+    // Successes don't reset the count, so that they don't cost a write each;
+    // failures age out with their window instead.
+    return;
+  }
+  this->save(backend_name, [](Circuit &circuit) {
+    if (circuit.state == State::Closed) {
+      circuit.probing = false;
+      return false;
+    }
+    circuit = Circuit();
+    return true;
+  });
+}
+
+void CircuitBreaker::record_failure(std::string_view backend_name) {
+  auto now{now_ms()};
+  this->save(backend_name, [&](Circuit &circuit) {
+    if (circuit.state != State::Closed) {
+      circuit.state = State::Open;
+      circuit.opened_at = now;
+      circuit.probing = false;
+      return true;
+    }
+    if (now - circuit.window_start >= this->policy_.failure_window_.count()) {
+      circuit.window_start = now;
+      circuit.failures = 0;
+    }
+    circuit.failures++;
+    if (circuit.failures >= this->policy_.failure_threshold_) {
+      circuit.state = State::Open;
+      circuit.opened_at = now;
+    }
+    return true;
+  });
+}
+
+void CircuitBreaker::record(std::string_view backend_name,
+                            fastly::expected<Response> &result) {
+  bool failed{!result};
+  if (result) {
+    auto status{result->get_status()};
+    auto &statuses{this->policy_.failure_statuses_};
+    failed = std::find(statuses.begin(), statuses.end(), status) !=
+             statuses.end();
+  }
+  if (failed) {
+    this->record_failure(backend_name);
+  } else {
+    this->record_success(backend_name);
+  }
+}
+
+fastly::expected<std::string>
+CircuitBreaker::route(std::string_view backend_name) {
+  if (this->allow(backend_name)) {
+    return std::string(backend_name);
+  }
+  if (this->policy_.fallback_ && *this->policy_.fallback_ != backend_name &&
+      this->allow(*this->policy_.fallback_)) {
+    return *this->policy_.fallback_;
+  }
+  return fastly::unexpected(FastlyError::circuit_open(backend_name));
+}
+
+fastly::expected<Response>
+CircuitBreaker::send(Request req, fastly::backend::Backend &backend) {
+  auto name{backend.name()};
+  auto target{this->route(name)};
+  if (!target) {
+    return fastly::unexpected(std::move(target.error()));
+  }
+  auto result{*target == name ? req.send(backend) : req.send(*target)};
+  this->record(*target, result);
+  return result;
+}
+
+fastly::expected<Response> CircuitBreaker::send(Request req,
+                                                std::string_view backend_name) {
+  auto target{this->route(backend_name)};
+  if (!target) {
+    return fastly::unexpected(std::move(target.error()));
+  }
+  auto result{req.send(*target)};
+  this->record(*target, result);
+  return result;
+}
+
+fastly::expected<request::PendingRequest>
+CircuitBreaker::send_async(Request req, fastly::backend::Backend &backend) {
+  auto name{backend.name()};
+  auto target{this->route(name)};
+  if (!target) {
+    return fastly::unexpected(std::move(target.error()));
+  }
+  return *target == name ? req.send_async(backend) : req.send_async(*target);
+}
+
+fastly::expected<request::PendingRequest>
+CircuitBreaker::send_async(Request req, std::string_view backend_name) {
+  auto target{this->route(backend_name)};
+  if (!target) {
+    return fastly::unexpected(std::move(target.error()));
+  }
+  return req.send_async(*target);
+}
+
+} // namespace fastly::http::circuit
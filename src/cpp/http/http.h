@@ -4,6 +4,7 @@
 #include <fastly/sdk-sys.h>
 
 namespace fastly::http {
+using fastly::sys::http::FramingHeadersMode;
 using fastly::sys::http::Method;
 using fastly::sys::http::Version;
 } // namespace fastly::http
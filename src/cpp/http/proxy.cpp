@@ -0,0 +1,69 @@
+#include "write_all.h"
+#include <algorithm>
+#include <fastly/http/proxy.h>
+#include <vector>
+
+namespace fastly::http {
+
+ProxyOptions ProxyOptions::block_size(size_t size) && {
+  this->block_size_ = std::max<size_t>(size, 1);
+  return std::move(*this);
+}
+
+ProxyOptions ProxyOptions::inspect(inspect_type hook) && {
+  this->inspect_ = std::move(hook);
+  return std::move(*this);
+}
+
+fastly::expected<request::PendingRequest>
+proxy_streaming(Request client_req, fastly::backend::Backend &backend,
+                ProxyOptions options) {
+  if (!options.inspect_) {
+    // The host streams the body to the backend on its own.
+    return client_req.send_async(backend);
+  }
+
+  auto body{client_req.take_body()};
+  auto streaming{client_req.send_async_streaming(backend)};
+  if (!streaming) {
+    return fastly::unexpected(std::move(streaming.error()));
+  }
+  auto &[backend_body, pending] = *streaming;
+
+  std::vector<uint8_t> block(options.block_size_);
+  while (true) {
+    auto read{body.read(block.data(), block.size())};
+    if (!read) {
+      return fastly::unexpected(std::move(read.error()));
+    } else if (*read == 0) {
+      break;
+    }
+    if (!(*options.inspect_)(std::span<const uint8_t>(block.data(), *read))) {
+      return fastly::unexpected(fastly::FastlyError::io_error(
+          "upload rejected by the inspection hook"));
+    }
+    auto written{
+        fastly::detail::write_all(backend_body, block.data(), *read)};
+    if (!written) {
+      return fastly::unexpected(std::move(written.error()));
+    }
+  }
+
+  auto finished{backend_body.finish()};
+  if (!finished) {
+    return fastly::unexpected(std::move(finished.error()));
+  }
+  return std::move(pending);
+}
+
+fastly::expected<request::PendingRequest>
+proxy_streaming(Request client_req, std::string_view backend_name,
+                ProxyOptions options) {
+  return fastly::backend::Backend::from_name(backend_name)
+      .and_then([&](fastly::backend::Backend backend) {
+        return proxy_streaming(std::move(client_req), backend,
+                               std::move(options));
+      });
+}
+
+} // namespace fastly::http
@@ -1,10 +1,29 @@
 #include "../util.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fastly/director.h>
 #include <fastly/error.h>
 #include <fastly/http/request.h>
+#include <fastly/http/timing.h>
 #include <fastly/sdk-sys.h>
+#include <iostream>
 
 namespace fastly::http {
 
+namespace {
+
+// Start an `http::timing` record for sending `req` to `backend`, if timing is
+// enabled.
+std::optional<uint32_t> start_timing(Request &req,
+                                     fastly::backend::Backend &backend) {
+  if (!timing::enabled()) {
+    return std::nullopt;
+  }
+  return timing::detail::submitted(backend.name(), req.get_url());
+}
+
+} // namespace
+
 namespace request {
 
 std::variant<PendingRequest, fastly::expected<Response>>
@@ -12,19 +31,27 @@ PendingRequest::poll() {
   auto poll_result{
       fastly::sys::http::request::m_http_request_pending_request_poll(
           std::move(this->req))};
-  if (poll_result->is_response()) {
-    return {fastly::expected<Response>(Response(
-        fastly::sys::http::request::m_http_request_poll_result_into_response(
-            std::move(poll_result))))};
-  } else if (poll_result->is_pending()) {
-    return {PendingRequest(
+  if (poll_result->is_pending()) {
+    PendingRequest pending{
         fastly::sys::http::request::m_http_request_poll_result_into_pending(
-            std::move(poll_result)))};
-  } else {
-    return {fastly::unexpected(
-        fastly::sys::http::request::m_http_request_poll_result_into_error(
-            std::move(poll_result)))};
+            std::move(poll_result))};
+    pending.in_flight_ = std::move(this->in_flight_);
+    pending.timing_ = this->timing_;
+    return {std::move(pending)};
   }
+  this->in_flight_.reset();
+  fastly::expected<Response> result{
+      poll_result->is_response()
+          ? fastly::expected<Response>(Response(
+                fastly::sys::http::request::
+                    m_http_request_poll_result_into_response(
+                        std::move(poll_result))))
+          : fastly::unexpected(
+                fastly::sys::http::request::
+                    m_http_request_poll_result_into_error(
+                        std::move(poll_result)))};
+  record_timing(this->timing_, result);
+  return {std::move(result)};
 }
 
 fastly::expected<Response> PendingRequest::wait() {
@@ -32,10 +59,23 @@ fastly::expected<Response> PendingRequest::wait() {
   fastly::sys::error::FastlyError *err;
   fastly::sys::http::request::m_http_request_pending_request_wait(
       std::move(this->req), ret, err);
-  if (err != nullptr) {
-    return fastly::unexpected(err);
-  } else {
-    return FSLY_BOX(http, Response, ret);
+  this->in_flight_.reset();
+  fastly::expected<Response> result{
+      err != nullptr
+          ? fastly::unexpected(err)
+          : fastly::expected<Response>(FSLY_BOX(http, Response, ret))};
+  record_timing(this->timing_, result);
+  return result;
+}
+
+void PendingRequest::record_timing(std::optional<uint32_t> id,
+                                   fastly::expected<Response> &result) {
+  if (!id) {
+    return;
+  }
+  timing::detail::responded(*id, result);
+  if (result) {
+    result->timing_ = id;
   }
 }
 
@@ -43,32 +83,227 @@ Request PendingRequest::cloned_sent_req() {
   return {this->req->cloned_sent_req()};
 }
 
-std::pair<fastly::expected<Response>, std::vector<PendingRequest>>
-select(std::vector<PendingRequest> &reqs) {
+std::pair<std::size_t, fastly::expected<Response>>
+PendingRequest::select_index(std::vector<PendingRequest> &reqs) {
   rust::Vec<fastly::sys::http::request::BoxPendingRequest> vecreqs;
   rust::Vec<fastly::sys::http::request::BoxPendingRequest> others;
-  for (auto &boxed : reqs) {
+  for (auto &pending : reqs) {
     fastly::sys::http::request::f_http_push_box_pending_request_into_vec(
-        vecreqs, std::move(boxed.req));
+        vecreqs, std::move(pending.req));
   }
   fastly::sys::http::Response *resp;
   fastly::sys::error::FastlyError *err;
+  std::size_t done;
   fastly::sys::http::request::f_http_request_select(std::move(vecreqs), resp,
-                                                    others, err);
-  std::vector<PendingRequest> ret_others;
-  for (auto &box : others) {
-    ret_others.push_back(PendingRequest(box.extract_req()));
+                                                    done, others, err);
+  // The rest come back in order, so each goes back to the request it came
+  // from, along with its in-flight and timing records.
+  auto finished{reqs.begin() + done};
+  auto remaining{others.begin()};
+  for (auto it{reqs.begin()}; it != reqs.end(); ++it) {
+    if (it != finished) {
+      it->req = (remaining++)->extract_req();
+    }
+  }
+  if (finished == reqs.end()) {
+    // The wait itself failed, so every request is still pending.
+    return {done, fastly::unexpected(err)};
+  }
+  finished->in_flight_.reset();
+  fastly::expected<Response> result{
+      err != nullptr
+          ? fastly::unexpected(err)
+          : fastly::expected<Response>(FSLY_BOX(http, Response, resp))};
+  record_timing(finished->timing_, result);
+  reqs.erase(finished);
+  return {done, std::move(result)};
+}
+
+std::pair<fastly::expected<Response>, std::vector<PendingRequest>>
+select(std::vector<PendingRequest> &reqs) {
+  auto result{PendingRequest::select_index(reqs).second};
+  return std::make_pair(std::move(result), std::move(reqs));
+}
+
+} // namespace request
+
+extern "C" void fastly$http$manualbridge$BeforeSendFn$call(
+    const detail::rust_bridge_tags::http::BeforeSendFnTag &fn_tag,
+    fastly::sys::http::Request *raw_req) {
+  // The request is only borrowed, so it is released rather than freed once the
+  // hook returns.
+  auto req = detail::AccessBridgeInternals::from_raw<Request>(raw_req);
+  // The hook was cast to its tag type on the way in, so this cast is safe.
+  auto &fn = static_cast<const BeforeSendFn &>(fn_tag);
+  detail::AccessBridgeInternals::get(fn)(req);
+  if (detail::AccessBridgeInternals::get(req).into_raw() != raw_req) {
+    std::cerr << "a before-send hook moved or replaced its request"
+              << std::endl;
+    std::abort();
+  }
+}
+
+extern "C" void fastly$http$manualbridge$BeforeSendFn$drop(
+    detail::rust_bridge_tags::http::BeforeSendFnTag *fn_tag) {
+  delete static_cast<BeforeSendFn *>(fn_tag);
+}
+
+extern "C" void fastly$http$manualbridge$AfterSendFn$call(
+    const detail::rust_bridge_tags::http::AfterSendFnTag &fn_tag,
+    fastly::sys::http::CandidateResponse *raw_candidate) {
+  CandidateResponse candidate{*raw_candidate};
+  auto &fn = static_cast<const AfterSendFn &>(fn_tag);
+  detail::AccessBridgeInternals::get(fn)(candidate);
+}
+
+extern "C" void fastly$http$manualbridge$AfterSendFn$drop(
+    detail::rust_bridge_tags::http::AfterSendFnTag *fn_tag) {
+  delete static_cast<AfterSendFn *>(fn_tag);
+}
+
+void CandidateResponse::set_cacheable() { this->res.set_cacheable(); }
+
+void CandidateResponse::set_uncacheable(bool record_uncacheable) {
+  this->res.set_uncacheable(record_uncacheable);
+}
+
+void CandidateResponse::set_ttl(std::chrono::milliseconds ttl) {
+  this->res.set_ttl(static_cast<uint64_t>(std::max<int64_t>(ttl.count(), 0)));
+}
+
+void CandidateResponse::set_stale_while_revalidate(
+    std::chrono::milliseconds swr) {
+  this->res.set_stale_while_revalidate(
+      static_cast<uint64_t>(std::max<int64_t>(swr.count(), 0)));
+}
+
+void CandidateResponse::set_pci(bool pci) { this->res.set_pci(pci); }
+
+fastly::expected<std::optional<HeaderValue>>
+CandidateResponse::get_header(std::string_view name) const {
+  std::vector<uint8_t> value;
+  fastly::sys::error::FastlyError *err;
+  bool has_header{
+      this->res.get_header(static_cast<std::string>(name), value, err)};
+  if (err != nullptr) {
+    return fastly::unexpected(err);
+  } else if (has_header) {
+    return std::optional<HeaderValue>(std::in_place,
+                                      std::string(value.begin(), value.end()));
+  } else {
+    return std::nullopt;
   }
+}
+
+fastly::expected<void> CandidateResponse::set_header(std::string_view name,
+                                                     std::string_view value) {
+  fastly::sys::error::FastlyError *err;
+  this->res.set_header(static_cast<std::string>(name),
+                       static_cast<std::string>(value), err);
   if (err != nullptr) {
-    return std::make_pair(fastly::unexpected(err), std::move(ret_others));
+    return fastly::unexpected(err);
   } else {
-    return std::make_pair(
-        fastly::expected<Response>(FSLY_BOX(http, Response, resp)),
-        std::move(ret_others));
+    return fastly::expected<void>();
   }
 }
 
-} // namespace request
+fastly::expected<void>
+CandidateResponse::append_header(std::string_view name,
+                                 std::string_view value) {
+  fastly::sys::error::FastlyError *err;
+  this->res.append_header(static_cast<std::string>(name),
+                          static_cast<std::string>(value), err);
+  if (err != nullptr) {
+    return fastly::unexpected(err);
+  } else {
+    return fastly::expected<void>();
+  }
+}
+
+fastly::expected<std::optional<std::string>>
+CandidateResponse::remove_header(std::string_view name) {
+  fastly::sys::error::FastlyError *err;
+  std::string out;
+  bool has_header{
+      this->res.remove_header(static_cast<std::string>(name), out, err)};
+  if (err != nullptr) {
+    return fastly::unexpected(err);
+  } else if (has_header) {
+    return std::optional<std::string>(std::move(out));
+  } else {
+    return std::nullopt;
+  }
+}
+
+StatusCode CandidateResponse::get_status() const {
+  return {this->res.get_status()};
+}
+
+void CandidateResponse::set_status(StatusCode status) {
+  this->res.set_status(status.as_code());
+}
+
+CacheOverride CacheOverride::none() {
+  return fastly::sys::http::m_static_http_cache_override_none();
+}
+
+CacheOverride CacheOverride::pass() {
+  return fastly::sys::http::m_static_http_cache_override_pass();
+}
+
+CacheOverride CacheOverride::ttl(uint32_t ttl) {
+  return CacheOverride::none().with_ttl(ttl);
+}
+
+CacheOverride CacheOverride::with_ttl(uint32_t ttl) && {
+  this->co_->set_ttl(ttl);
+  return std::move(*this);
+}
+
+CacheOverride CacheOverride::with_stale_while_revalidate(uint32_t swr) && {
+  this->co_->set_stale_while_revalidate(swr);
+  return std::move(*this);
+}
+
+CacheOverride CacheOverride::with_pci(bool pci) && {
+  this->co_->set_pci(pci);
+  return std::move(*this);
+}
+
+CacheOverride CacheOverride::with_surrogate_key(std::string_view sk) && {
+  this->co_->set_surrogate_key(static_cast<std::string>(sk));
+  return std::move(*this);
+}
+
+CacheOverride CacheOverride::clone() const { return this->co_->clone(); }
+
+bool CacheOverride::is_pass() const { return this->co_->is_pass(); }
+
+std::optional<uint32_t> CacheOverride::get_ttl() const {
+  uint32_t ttl;
+  if (this->co_->get_ttl(ttl)) {
+    return ttl;
+  }
+  return std::nullopt;
+}
+
+std::optional<uint32_t> CacheOverride::get_stale_while_revalidate() const {
+  uint32_t swr;
+  if (this->co_->get_stale_while_revalidate(swr)) {
+    return swr;
+  }
+  return std::nullopt;
+}
+
+bool CacheOverride::get_pci() const { return this->co_->get_pci(); }
+
+std::optional<std::string> CacheOverride::get_surrogate_key() const {
+  std::string sk;
+  if (this->co_->get_surrogate_key(sk)) {
+    return sk;
+  }
+  return std::nullopt;
+}
 
 Request::Request(Method method, std::string_view url)
     : req(fastly::sys::http::m_static_http_request_new(
@@ -153,15 +388,17 @@ fastly::expected<Response> Request::send(std::string_view backend_name) {
 }
 
 fastly::expected<Response> Request::send(fastly::backend::Backend &backend) {
+  auto timing{start_timing(*this, backend)};
   fastly::sys::http::Response *resp;
   fastly::sys::error::FastlyError *err;
   fastly::sys::http::m_http_request_send(std::move(this->req), *backend.backend,
                                          resp, err);
-  if (err != nullptr) {
-    return fastly::unexpected(err);
-  } else {
-    return FSLY_BOX(http, Response, resp);
-  }
+  fastly::expected<Response> result{
+      err != nullptr
+          ? fastly::unexpected(err)
+          : fastly::expected<Response>(FSLY_BOX(http, Response, resp))};
+  request::PendingRequest::record_timing(timing, result);
+  return result;
 }
 
 fastly::expected<request::PendingRequest>
@@ -174,17 +411,33 @@ Request::send_async(std::string_view backend_name) {
 
 fastly::expected<request::PendingRequest>
 Request::send_async(fastly::backend::Backend &backend) {
+  auto timing{start_timing(*this, backend)};
   fastly::sys::http::request::PendingRequest *req;
   fastly::sys::error::FastlyError *err;
   fastly::sys::http::m_http_request_send_async(std::move(this->req),
                                                *backend.backend, req, err);
   if (err != nullptr) {
-    return fastly::unexpected(err);
+    fastly::expected<Response> failed{fastly::unexpected(err)};
+    request::PendingRequest::record_timing(timing, failed);
+    return fastly::unexpected(std::move(failed.error()));
   } else {
-    return FSLY_BOX(http, request::PendingRequest, req);
+    request::PendingRequest pending{
+        FSLY_BOX(http, request::PendingRequest, req)};
+    pending.timing_ = timing;
+    return pending;
   }
 }
 
+fastly::expected<Response>
+Request::send(fastly::director::Director &director) {
+  return director.send(std::move(*this));
+}
+
+fastly::expected<request::PendingRequest>
+Request::send_async(fastly::director::Director &director) {
+  return director.send_async(std::move(*this));
+}
+
 fastly::expected<std::pair<StreamingBody, request::PendingRequest>>
 Request::send_async_streaming(std::string_view backend_name) {
   return fastly::backend::Backend::from_name(backend_name)
@@ -195,15 +448,19 @@ Request::send_async_streaming(std::string_view backend_name) {
 
 fastly::expected<std::pair<StreamingBody, request::PendingRequest>>
 Request::send_async_streaming(fastly::backend::Backend &backend) {
+  auto timing{start_timing(*this, backend)};
   fastly::sys::http::request::AsyncStreamRes *res;
   fastly::sys::error::FastlyError *err;
   fastly::sys::http::m_http_request_send_async_streaming(
       std::move(this->req), *backend.backend, res, err);
   if (err != nullptr) {
-    return fastly::unexpected(err);
+    fastly::expected<Response> failed{fastly::unexpected(err)};
+    request::PendingRequest::record_timing(timing, failed);
+    return fastly::unexpected(std::move(failed.error()));
   } else {
-    return std::make_pair(StreamingBody(res->take_body()),
-                          request::PendingRequest(res->take_req()));
+    request::PendingRequest pending{res->take_req()};
+    pending.timing_ = timing;
+    return std::make_pair(StreamingBody(res->take_body()), std::move(pending));
   }
 }
 
@@ -531,7 +788,7 @@ Request Request::with_pass(bool pass) && {
 void Request::set_pass(bool pass) { this->req->set_pass(pass); }
 
 Request Request::with_ttl(uint32_t ttl) && {
-  this->set_pass(ttl);
+  this->set_ttl(ttl);
   return std::move(*this);
 }
 
@@ -567,6 +824,41 @@ fastly::expected<void> Request::set_surrogate_key(std::string_view sk) {
   }
 }
 
+fastly::expected<Request>
+Request::with_cache_override(const CacheOverride &co) && {
+  return this->set_cache_override(co).map(
+      [this]() { return std::move(*this); });
+}
+
+fastly::expected<void> Request::set_cache_override(const CacheOverride &co) {
+  fastly::sys::error::FastlyError *err;
+  this->req->set_cache_override(*co.co_, err);
+  if (err != nullptr) {
+    return fastly::unexpected(err);
+  }
+  return fastly::expected<void>();
+}
+
+Request Request::with_before_send(BeforeSendFn fn) && {
+  this->set_before_send(std::move(fn));
+  return std::move(*this);
+}
+
+void Request::set_before_send(BeforeSendFn fn) {
+  // Rust takes ownership, and deletes it through
+  // `fastly$http$manualbridge$BeforeSendFn$drop`.
+  this->req->set_before_send(new BeforeSendFn(std::move(fn)));
+}
+
+Request Request::with_after_send(AfterSendFn fn) && {
+  this->set_after_send(std::move(fn));
+  return std::move(*this);
+}
+
+void Request::set_after_send(AfterSendFn fn) {
+  this->req->set_after_send(new AfterSendFn(std::move(fn)));
+}
+
 std::optional<std::string> Request::get_client_ip_addr() {
   std::string ret;
   if (this->req->get_client_ip_addr(ret)) {
@@ -623,14 +915,57 @@ Request Request::with_auto_decompress_gzip(bool gzip) && {
   return std::move(*this);
 }
 
-// TODO(@zkat): needs enum
-// void set_framing_headers_mode(FramingHeadersMode mode);
-// Request *set_framing_headers_mode(FramingHeadersMode mode);
+void Request::set_framing_headers_mode(FramingHeadersMode mode) {
+  this->req->set_framing_headers_mode(mode);
+}
+
+Request Request::with_framing_headers_mode(FramingHeadersMode mode) && {
+  this->set_framing_headers_mode(mode);
+  return std::move(*this);
+}
+
 bool Request::fastly_key_is_valid() { return this->req->fastly_key_is_valid(); }
 
-// TODO(@zkat): Do these later. I think they're lower-pri.
-// void handoff_websocket(fastly::backend::Backend backend);
-// void handoff_fanout(fastly::backend::Backend backend);
+fastly::expected<void>
+Request::handoff_websocket(fastly::backend::Backend &backend) {
+  fastly::sys::error::FastlyError *err;
+  fastly::sys::http::m_http_request_handoff_websocket(std::move(this->req),
+                                                      *backend.backend, err);
+  if (err != nullptr) {
+    return fastly::unexpected(err);
+  } else {
+    return fastly::expected<void>();
+  }
+}
+
+fastly::expected<void>
+Request::handoff_websocket(std::string_view backend_name) {
+  return fastly::backend::Backend::from_name(backend_name)
+      .and_then([this](fastly::backend::Backend backend) {
+        return this->handoff_websocket(backend);
+      });
+}
+
+fastly::expected<void>
+Request::handoff_fanout(fastly::backend::Backend &backend) {
+  fastly::sys::error::FastlyError *err;
+  fastly::sys::http::m_http_request_handoff_fanout(std::move(this->req),
+                                                   *backend.backend, err);
+  if (err != nullptr) {
+    return fastly::unexpected(err);
+  } else {
+    return fastly::expected<void>();
+  }
+}
+
+fastly::expected<void> Request::handoff_fanout(std::string_view backend_name) {
+  return fastly::backend::Backend::from_name(backend_name)
+      .and_then([this](fastly::backend::Backend backend) {
+        return this->handoff_fanout(backend);
+      });
+}
+
+// TODO(@zkat): Do this later. I think it's lower-pri.
 // Request *on_behalf_of(std::string service);
 
 void Request::set_cache_key(std::string_view key) {
@@ -1,4 +1,5 @@
 #include "../util.h"
+#include <fastly/background.h>
 #include <fastly/error.h>
 #include <fastly/http/response.h>
 #include <fastly/sdk-sys.h>
@@ -45,6 +46,7 @@ void Response::set_body(Body body) {
 
 Body Response::take_body() {
   Body body{this->res->take_body()};
+  body.timing_ = this->timing_;
   return body;
 }
 
@@ -65,8 +67,9 @@ std::string Response::into_body_string() {
 }
 
 Body Response::into_body() {
-  return Body(
-      fastly::sys::http::m_http_response_into_body(std::move(this->res)));
+  Body body{fastly::sys::http::m_http_response_into_body(std::move(this->res))};
+  body.timing_ = this->timing_;
+  return body;
 }
 
 fastly::expected<void> Response::set_body_text_plain(std::string_view body) {
@@ -257,6 +260,8 @@ Response::remove_header(std::string_view name) {
   }
 }
 
+StatusCode Response::get_status() { return {this->res->get_status()}; }
+
 void Response::set_status(StatusCode status) {
   this->res->set_status(status.as_code());
 }
@@ -307,11 +312,14 @@ std::optional<Request> Response::take_backend_request() {
 void Response::send_to_client() {
   // TODO(@zkat): flush body before sending.
   fastly::sys::http::m_http_response_send_to_client(std::move(this->res));
+  fastly::background::detail::response_sent();
 }
 
 StreamingBody Response::stream_to_client() {
-  return {fastly::sys::http::m_http_response_stream_to_client(
+  StreamingBody body{fastly::sys::http::m_http_response_stream_to_client(
       std::move(this->res))};
+  body.to_client_ = true;
+  return body;
 }
 
 std::optional<std::chrono::milliseconds> Response::get_ttl() {
@@ -351,4 +359,13 @@ Response Response::with_version(Version version) && {
   return std::move(*this);
 }
 
+void Response::set_framing_headers_mode(FramingHeadersMode mode) {
+  this->res->set_framing_headers_mode(mode);
+}
+
+Response Response::with_framing_headers_mode(FramingHeadersMode mode) && {
+  this->set_framing_headers_mode(mode);
+  return std::move(*this);
+}
+
 } // namespace fastly::http
@@ -0,0 +1,282 @@
+#include "../backoff.h"
+#include "write_all.h"
+#include <algorithm>
+#include <array>
+#include <fastly/http/retry.h>
+
+namespace fastly::http::retry {
+
+namespace {
+
+// Block size used when streaming the first attempt's body to the backend.
+constexpr size_t REPLAY_CHUNK_SIZE{16 * 1024};
+
+bool is_idempotent(Method method) {
+  switch (method) {
+  case Method::POST:
+  case Method::PATCH:
+  case Method::CONNECT:
+    return false;
+  default:
+    return true;
+  }
+}
+
+} // namespace
+
+RetryPolicy::RetryPolicy()
+    : max_attempts_(3), initial_backoff_(50), max_backoff_(1000),
+      backoff_multiplier_(2.0), jitter_(true), time_budget_(std::nullopt),
+      statuses_({StatusCode::BAD_GATEWAY, StatusCode::SERVICE_UNAVAILABLE,
+                 StatusCode::GATEWAY_TIMEOUT}),
+      errors_({FastlyErrorCode::FastlySendError}),
+      retry_non_idempotent_(false), max_replay_bytes_(1024 * 1024) {}
+
+RetryPolicy RetryPolicy::max_attempts(uint32_t attempts) && {
+  this->max_attempts_ = std::max<uint32_t>(attempts, 1);
+  return std::move(*this);
+}
+
+RetryPolicy RetryPolicy::initial_backoff(std::chrono::milliseconds backoff) && {
+  this->initial_backoff_ = backoff;
+  return std::move(*this);
+}
+
+RetryPolicy RetryPolicy::max_backoff(std::chrono::milliseconds backoff) && {
+  this->max_backoff_ = backoff;
+  return std::move(*this);
+}
+
+RetryPolicy RetryPolicy::backoff_multiplier(double multiplier) && {
+  this->backoff_multiplier_ = multiplier;
+  return std::move(*this);
+}
+
+RetryPolicy RetryPolicy::jitter(bool enable) && {
+  this->jitter_ = enable;
+  return std::move(*this);
+}
+
+RetryPolicy RetryPolicy::time_budget(std::chrono::milliseconds budget) && {
+  this->time_budget_ = budget;
+  return std::move(*this);
+}
+
+RetryPolicy RetryPolicy::retry_on_status(std::vector<StatusCode> statuses) && {
+  this->statuses_ = std::move(statuses);
+  return std::move(*this);
+}
+
+RetryPolicy RetryPolicy::retry_on_error(std::vector<FastlyErrorCode> codes) && {
+  this->errors_ = std::move(codes);
+  return std::move(*this);
+}
+
+RetryPolicy RetryPolicy::retry_non_idempotent(bool enable) && {
+  this->retry_non_idempotent_ = enable;
+  return std::move(*this);
+}
+
+RetryPolicy RetryPolicy::max_replay_bytes(size_t bytes) && {
+  this->max_replay_bytes_ = bytes;
+  return std::move(*this);
+}
+
+PendingRetry::PendingRetry(Request tmpl, fastly::backend::Backend backend,
+                           RetryPolicy policy)
+    : template_(std::move(tmpl)), backend_(std::move(backend)),
+      policy_(std::move(policy)), started_(std::chrono::steady_clock::now()),
+      next_attempt_at_(started_) {}
+
+// Send the first attempt. A request body is streamed to the backend in large
+// blocks, and each block is also kept in `replay_` for as long as the body
+// fits into `max_replay_bytes`.
+fastly::expected<void> PendingRetry::start(Request req) {
+  this->attempt_ = 1;
+  if (!this->policy_.retry_non_idempotent_ &&
+      !is_idempotent(req.get_method())) {
+    this->replayable_ = false;
+  }
+  if (!this->replayable_ || this->policy_.max_attempts_ == 1 ||
+      !req.has_body()) {
+    auto pending{req.send_async(this->backend_)};
+    if (!pending) {
+      return fastly::unexpected(std::move(pending.error()));
+    }
+    this->pending_.emplace(std::move(*pending));
+    return fastly::expected<void>();
+  }
+
+  auto body{req.take_body()};
+  auto streaming{req.send_async_streaming(this->backend_)};
+  if (!streaming) {
+    return fastly::unexpected(std::move(streaming.error()));
+  }
+  auto &[backend_body, pending] = *streaming;
+  this->pending_.emplace(std::move(pending));
+
+  std::array<uint8_t, REPLAY_CHUNK_SIZE> chunk;
+  bool forwarding{true};
+  while (forwarding || this->replayable_) {
+    auto read{body.read(chunk.data(), chunk.size())};
+    if (!read) {
+      // `backend_body` is dropped unfinished, which aborts the upload, so the
+      // backend never takes the partial body for a complete one.
+      this->pending_.reset();
+      return fastly::unexpected(std::move(read.error()));
+    } else if (*read == 0) {
+      break;
+    }
+    if (forwarding) {
+      forwarding =
+          fastly::detail::write_all(backend_body, chunk.data(), *read)
+              .has_value();
+    }
+    if (this->replayable_) {
+      if (this->replay_.size() + *read > this->policy_.max_replay_bytes_) {
+        this->replayable_ = false;
+        std::vector<uint8_t>().swap(this->replay_);
+      } else {
+        this->replay_.insert(this->replay_.end(), chunk.data(),
+                             chunk.data() + *read);
+      }
+    }
+  }
+  if (forwarding) {
+    // An error here surfaces through the pending request.
+    (void)backend_body.finish();
+  }
+  return fastly::expected<void>();
+}
+
+// Send a retry, rebuilt from the bodiless template and the replay buffer.
+fastly::expected<void> PendingRetry::launch() {
+  this->attempt_++;
+  auto req{this->template_.clone_without_body()};
+  if (!this->replay_.empty()) {
+    req.set_body(Body(this->replay_));
+  }
+  auto pending{req.send_async(this->backend_)};
+  if (!pending) {
+    return fastly::unexpected(std::move(pending.error()));
+  }
+  this->pending_.emplace(std::move(*pending));
+  return fastly::expected<void>();
+}
+
+bool PendingRetry::should_retry(fastly::expected<Response> &result) {
+  if (!this->replayable_ || this->attempt_ >= this->policy_.max_attempts_) {
+    return false;
+  }
+  bool retryable{false};
+  if (result) {
+    auto status{result->get_status()};
+    retryable = std::find(this->policy_.statuses_.begin(),
+                          this->policy_.statuses_.end(),
+                          status) != this->policy_.statuses_.end();
+  } else {
+    auto code{result.error().error_code()};
+    retryable = std::find(this->policy_.errors_.begin(),
+                          this->policy_.errors_.end(),
+                          code) != this->policy_.errors_.end();
+  }
+  if (!retryable) {
+    return false;
+  }
+
+  fastly::detail::Backoff backoff{
+      this->policy_.initial_backoff_, this->policy_.max_backoff_,
+      this->policy_.backoff_multiplier_, this->policy_.jitter_};
+  auto now{std::chrono::steady_clock::now()};
+  auto next{now + backoff.delay(this->attempt_)};
+  if (this->policy_.time_budget_ &&
+      next >= this->started_ + *this->policy_.time_budget_) {
+    return false;
+  }
+  this->next_attempt_at_ = next;
+  return true;
+}
+
+std::variant<PendingRetry, fastly::expected<Response>> PendingRetry::poll() {
+  if (!this->pending_) {
+    if (std::chrono::steady_clock::now() < this->next_attempt_at_) {
+      return {std::move(*this)};
+    }
+    if (auto launched{this->launch()}; !launched) {
+      fastly::expected<Response> failed{
+          fastly::unexpected(std::move(launched.error()))};
+      if (!this->should_retry(failed)) {
+        return {std::move(failed)};
+      }
+      return {std::move(*this)};
+    }
+  }
+  auto polled{this->pending_->poll()};
+  this->pending_.reset();
+  if (auto *still_pending{std::get_if<request::PendingRequest>(&polled)}) {
+    this->pending_.emplace(std::move(*still_pending));
+    return {std::move(*this)};
+  }
+  auto result{std::move(std::get<fastly::expected<Response>>(polled))};
+  if (this->should_retry(result)) {
+    return {std::move(*this)};
+  }
+  return {std::move(result)};
+}
+
+fastly::expected<Response> PendingRetry::wait() {
+  while (true) {
+    if (!this->pending_) {
+      fastly::detail::sleep_for(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              this->next_attempt_at_ - std::chrono::steady_clock::now()));
+      if (auto launched{this->launch()}; !launched) {
+        fastly::expected<Response> failed{
+            fastly::unexpected(std::move(launched.error()))};
+        if (!this->should_retry(failed)) {
+          return failed;
+        }
+        continue;
+      }
+    }
+    auto result{this->pending_->wait()};
+    this->pending_.reset();
+    if (!this->should_retry(result)) {
+      return result;
+    }
+  }
+}
+
+fastly::expected<PendingRetry> send_async(Request req,
+                                          fastly::backend::Backend &backend,
+                                          const RetryPolicy &policy) {
+  PendingRetry pending{req.clone_without_body(), backend.clone(), policy};
+  auto started{pending.start(std::move(req))};
+  if (!started) {
+    return fastly::unexpected(std::move(started.error()));
+  }
+  return pending;
+}
+
+fastly::expected<PendingRetry> send_async(Request req,
+                                          std::string_view backend_name,
+                                          const RetryPolicy &policy) {
+  return fastly::backend::Backend::from_name(backend_name)
+      .and_then([&](fastly::backend::Backend backend) {
+        return send_async(std::move(req), backend, policy);
+      });
+}
+
+fastly::expected<Response> send(Request req, fastly::backend::Backend &backend,
+                                const RetryPolicy &policy) {
+  return send_async(std::move(req), backend, policy)
+      .and_then([](PendingRetry pending) { return pending.wait(); });
+}
+
+fastly::expected<Response> send(Request req, std::string_view backend_name,
+                                const RetryPolicy &policy) {
+  return send_async(std::move(req), backend_name, policy)
+      .and_then([](PendingRetry pending) { return pending.wait(); });
+}
+
+} // namespace fastly::http::retry
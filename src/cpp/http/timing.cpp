@@ -0,0 +1,174 @@
+#include <fastly/http/response.h>
+#include <fastly/http/timing.h>
+#include <fastly/log.h>
+#include <format>
+
+namespace fastly::http::timing {
+
+namespace {
+
+struct State {
+  bool enabled{false};
+  std::vector<Record> records;
+};
+
+State &state() {
+  static State s;
+  return s;
+}
+
+double millis(std::chrono::microseconds us) {
+  return static_cast<double>(us.count()) / 1000.0;
+}
+
+// Server-Timing metric names are HTTP tokens.
+std::string metric_name(std::string_view backend) {
+  std::string name;
+  for (auto c : backend) {
+    bool token{(c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+               (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.'};
+    name.push_back(token ? c : '_');
+  }
+  return name;
+}
+
+std::string json_string(std::string_view s) {
+  std::string out{"\""};
+  for (auto c : s) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out += std::format("\\u{:04x}", static_cast<unsigned>(c));
+      } else {
+        out.push_back(c);
+      }
+    }
+  }
+  out.push_back('"');
+  return out;
+}
+
+template <typename T> std::string json_optional(const std::optional<T> &v) {
+  return v ? std::format("{}", *v) : "null";
+}
+
+std::string json_millis(const std::optional<std::chrono::microseconds> &us) {
+  return us ? std::format("{:.3f}", millis(*us)) : "null";
+}
+
+} // namespace
+
+std::optional<std::chrono::microseconds> Record::time_to_first_byte() const {
+  if (!this->response) {
+    return std::nullopt;
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      *this->response - this->submitted);
+}
+
+std::optional<std::chrono::microseconds> Record::total_time() const {
+  if (!this->body_complete) {
+    return std::nullopt;
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      *this->body_complete - this->submitted);
+}
+
+void enable(bool enabled) { state().enabled = enabled; }
+
+bool enabled() { return state().enabled; }
+
+const std::vector<Record> &records() { return state().records; }
+
+void clear() { state().records.clear(); }
+
+std::string server_timing() {
+  std::string value;
+  auto append{[&](std::string metric) {
+    if (!value.empty()) {
+      value += ", ";
+    }
+    value += metric;
+  }};
+  for (auto &record : state().records) {
+    auto name{metric_name(record.backend)};
+    if (auto ttfb{record.time_to_first_byte()}) {
+      append(std::format("{}-ttfb;dur={:.1f}", name, millis(*ttfb)));
+    }
+    if (auto total{record.total_time()}) {
+      append(std::format("{}-total;dur={:.1f}", name, millis(*total)));
+    }
+  }
+  return value;
+}
+
+fastly::expected<void> add_server_timing(Response &resp) {
+  auto value{server_timing()};
+  if (value.empty()) {
+    return fastly::expected<void>();
+  }
+  return resp.append_header("Server-Timing", value);
+}
+
+void log_to(std::string_view endpoint) {
+  for (auto &record : state().records) {
+    fastly::log::info_to(
+        endpoint,
+        "{{\"backend\":{},\"url\":{},\"status\":{},\"failed\":{},"
+        "\"ttfb_ms\":{},\"total_ms\":{},\"bytes_received\":{}}}",
+        json_string(record.backend), json_string(record.url),
+        json_optional(record.status), record.failed,
+        json_millis(record.time_to_first_byte()),
+        json_millis(record.total_time()), record.bytes_received);
+  }
+}
+
+namespace detail {
+
+uint32_t submitted(std::string backend, std::string url) {
+  auto &records{state().records};
+  Record record;
+  record.backend = std::move(backend);
+  record.url = std::move(url);
+  record.submitted = std::chrono::steady_clock::now();
+  records.push_back(std::move(record));
+  return static_cast<uint32_t>(records.size() - 1);
+}
+
+void responded(uint32_t id, fastly::expected<Response> &result) {
+  auto &records{state().records};
+  if (id >= records.size()) {
+    return;
+  }
+  auto &record{records[id]};
+  if (!record.response) {
+    record.response = std::chrono::steady_clock::now();
+    if (result) {
+      record.status = result->get_status().as_code();
+    } else {
+      record.failed = true;
+    }
+  }
+}
+
+void body_read(uint32_t id, size_t bytes) {
+  auto &records{state().records};
+  if (id >= records.size()) {
+    return;
+  }
+  auto &record{records[id]};
+  record.bytes_received += bytes;
+  if (bytes == 0 && !record.body_complete) {
+    record.body_complete = std::chrono::steady_clock::now();
+  }
+}
+
+} // namespace detail
+
+} // namespace fastly::http::timing
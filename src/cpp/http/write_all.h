@@ -0,0 +1,32 @@
+#ifndef FASTLY_SRC_HTTP_WRITE_ALL_H
+#define FASTLY_SRC_HTTP_WRITE_ALL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fastly/error.h>
+#include <fastly/expected.h>
+#include <fastly/http/body.h>
+
+namespace fastly::detail {
+
+// Write all of `buf` to `sink`, failing if it stops accepting data.
+// This is intended for internal use only.
+inline fastly::expected<void> write_all(fastly::http::StreamingBody &sink,
+                                        uint8_t *buf, size_t len) {
+  size_t written{0};
+  while (written < len) {
+    auto res{sink.write(buf + written, len - written)};
+    if (!res) {
+      return fastly::unexpected(std::move(res.error()));
+    } else if (*res == 0) {
+      return fastly::unexpected(
+          fastly::FastlyError::io_error("body stopped accepting data"));
+    }
+    written += *res;
+  }
+  return fastly::expected<void>();
+}
+
+} // namespace fastly::detail
+
+#endif
@@ -1,7 +1,34 @@
+#include "backoff.h"
+#include <algorithm>
+#include <charconv>
 #include <fastly/kv_store.h>
 #include <iostream>
+#include <limits>
+#include <set>
 
 namespace fastly::kv_store {
+KVStoreError KVStoreError::item_bad_request(std::string_view reason) {
+  return {
+      fastly::sys::kv_store::m_static_kv_store_kv_store_error_item_bad_request(
+          {reason.data(), reason.size()})};
+}
+KVCodec KVCodec::zstd(int level) {
+  return {fastly::sys::kv_store::m_static_kv_store_kv_codec_zstd(level)};
+}
+
+KVCodec KVCodec::lz4() {
+  return {fastly::sys::kv_store::m_static_kv_store_kv_codec_lz4()};
+}
+
+KVCodec KVCodec::zstd_with_dictionary(std::string_view name,
+                                      std::span<const std::uint8_t> dictionary,
+                                      int level) {
+  return {
+      fastly::sys::kv_store::m_static_kv_store_kv_codec_zstd_with_dictionary(
+          {name.data(), name.size()}, {dictionary.data(), dictionary.size()},
+          level)};
+}
+
 KVStoreErrorCode KVStoreError::error_code() { return err_->error_code(); }
 std::string KVStoreError::error_msg() {
   std::string msg;
@@ -34,6 +61,12 @@ InsertBuilder InsertBuilder::metadata(const std::string &data) && {
   return std::move(*this);
 }
 
+InsertBuilder InsertBuilder::codec(const KVCodec &codec) && {
+  builder_ = fastly::sys::kv_store::m_kv_store_insert_builder_codec(
+      std::move(builder_), *codec.codec_);
+  return std::move(*this);
+}
+
 InsertBuilder InsertBuilder::time_to_live(std::chrono::milliseconds ttl) && {
   builder_ = fastly::sys::kv_store::m_kv_store_insert_builder_time_to_live(
       std::move(builder_), ttl.count());
@@ -63,15 +96,12 @@ InsertBuilder::execute_async(const std::string &key, Body body) && {
 }
 
 std::vector<std::string> ListPage::keys() const {
-  auto keys = page_->keys();
-  std::vector<std::string> result;
-  result.reserve(keys.size());
-  for (const auto &key : keys) {
-    result.emplace_back(std::move(key));
-  }
-  return result;
+  auto keys = key_views();
+  return std::vector<std::string>(keys.begin(), keys.end());
 }
 
+ListKeys ListPage::key_views() const { return ListKeys(page_->keys()); }
+
 std::vector<std::string> ListPage::into_keys() {
   auto keys =
       fastly::sys::kv_store::m_kv_store_list_page_into_keys(std::move(page_));
@@ -136,6 +166,16 @@ std::vector<uint8_t> LookupResponse::take_body_bytes() {
   return body_bytes;
 }
 
+fastly::expected<Body> LookupResponse::take_decoded_body() {
+  fastly::sys::http::Body *bod;
+  fastly::sys::error::FastlyError *err;
+  response_->take_decoded_body(bod, err);
+  if (err != nullptr) {
+    return fastly::unexpected(err);
+  }
+  return Body{rust::Box<fastly::sys::http::Body>::from_raw(bod)};
+}
+
 std::optional<std::vector<std::uint8_t>> LookupResponse::metadata() const {
   std::vector<std::uint8_t> metadata;
   if (response_->metadata(metadata)) {
@@ -148,6 +188,66 @@ std::uint64_t LookupResponse::current_generation() const {
   return response_->current_generation();
 }
 
+std::optional<KVCodec> LookupResponse::codec() const {
+  fastly::sys::kv_store::KVCodec *codec;
+  if (response_->codec(codec)) {
+    return KVCodec{rust::Box<fastly::sys::kv_store::KVCodec>::from_raw(codec)};
+  }
+  return std::nullopt;
+}
+
+fastly::expected<std::size_t>
+LookupResponse::read_range(std::uint64_t offset, std::span<std::uint8_t> buf) {
+  fastly::sys::error::FastlyError *err;
+  auto read{response_->read_range(offset, {buf.data(), buf.size()}, err)};
+  if (err != nullptr) {
+    return fastly::unexpected(err);
+  }
+  return read;
+}
+
+fastly::expected<std::uint64_t>
+LookupResponse::stream_range_to(http::StreamingBody &out,
+                                std::uint64_t offset,
+                                std::optional<std::uint64_t> length) {
+  // Anything already written to `out` through its stream must go first.
+  out.flush();
+  fastly::sys::error::FastlyError *err;
+  auto written{response_->copy_range_to(
+      offset, length.value_or(std::numeric_limits<std::uint64_t>::max()),
+      *out.bod, err)};
+  if (err != nullptr) {
+    return fastly::unexpected(err);
+  }
+  return written;
+}
+
+void LookupResponse::append_to(http::StreamingBody &out) {
+  out.flush();
+  response_->append_to(*out.bod);
+}
+
+std::optional<std::span<const std::uint8_t>> LookupInfo::metadata() const {
+  if (!info_->has_metadata()) {
+    return std::nullopt;
+  }
+  auto metadata{info_->metadata()};
+  return std::span<const std::uint8_t>{metadata.data(), metadata.size()};
+}
+
+std::optional<std::string_view> LookupInfo::metadata_str() const {
+  auto metadata{this->metadata()};
+  if (!metadata) {
+    return std::nullopt;
+  }
+  return std::string_view{reinterpret_cast<const char *>(metadata->data()),
+                          metadata->size()};
+}
+
+std::uint64_t LookupInfo::current_generation() const {
+  return info_->current_generation();
+}
+
 expected<LookupResponse> LookupBuilder::execute(std::string_view key) const {
   fastly::sys::kv_store::LookupResponse *response;
   fastly::sys::kv_store::KVStoreError *err;
@@ -194,24 +294,28 @@ ListBuilder ListBuilder::eventual_consistency() && {
   builder_ =
       fastly::sys::kv_store::m_kv_store_list_builder_eventual_consistency(
           std::move(builder_));
+  eventual_ = true;
   return std::move(*this);
 }
 
 ListBuilder ListBuilder::cursor(const std::string &cursor) && {
   builder_ = fastly::sys::kv_store::m_kv_store_list_builder_cursor(
       std::move(builder_), cursor);
+  cursor_ = cursor;
   return std::move(*this);
 }
 
 ListBuilder ListBuilder::limit(std::uint32_t limit) && {
   builder_ = fastly::sys::kv_store::m_kv_store_list_builder_limit(
       std::move(builder_), limit);
+  limit_ = limit;
   return std::move(*this);
 }
 
 ListBuilder ListBuilder::prefix(const std::string &prefix) && {
   builder_ = fastly::sys::kv_store::m_kv_store_list_builder_prefix(
       std::move(builder_), prefix);
+  prefix_ = prefix;
   return std::move(*this);
 }
 expected<ListPage> ListBuilder::execute() && {
@@ -240,6 +344,105 @@ expected<PendingListHandle> ListBuilder::execute_async() const {
   return PendingListHandle::from_u32(handle);
 }
 
+PipelinedListResponse ListBuilder::iter_pipelined() && {
+  return PipelinedListResponse(*store_, std::move(prefix_), limit_, eventual_,
+                               std::move(cursor_));
+}
+
+ShardedListScan
+ListBuilder::iter_sharded(const std::vector<std::string> &suffixes) && {
+  std::vector<PipelinedListResponse> shards;
+  shards.reserve(suffixes.size());
+  for (auto &suffix : suffixes) {
+    shards.push_back(PipelinedListResponse(*store_, prefix_ + suffix, limit_,
+                                           eventual_, std::nullopt));
+  }
+  return ShardedListScan(std::move(shards));
+}
+
+PipelinedListResponse::PipelinedListResponse(
+    const KVStore &store, std::string prefix,
+    std::optional<std::uint32_t> limit, bool eventual,
+    std::optional<std::string> cursor)
+    : store_(&store), prefix_(std::move(prefix)), limit_(limit),
+      eventual_(eventual) {
+  this->request(std::move(cursor));
+}
+
+void PipelinedListResponse::request(std::optional<std::string> cursor) {
+  auto builder{store_->build_list()};
+  if (!prefix_.empty()) {
+    builder = std::move(builder).prefix(prefix_);
+  }
+  if (limit_) {
+    builder = std::move(builder).limit(*limit_);
+  }
+  if (eventual_) {
+    builder = std::move(builder).eventual_consistency();
+  }
+  if (cursor) {
+    builder = std::move(builder).cursor(*cursor);
+  }
+  auto pending{builder.execute_async()};
+  if (pending) {
+    pending_ = *pending;
+  } else {
+    error_.emplace(std::move(pending.error()));
+  }
+}
+
+std::optional<expected<ListPage>> PipelinedListResponse::next() {
+  if (!pending_) {
+    if (!error_) {
+      return std::nullopt;
+    }
+    auto error{std::move(*error_)};
+    error_.reset();
+    return unexpected(std::move(error));
+  }
+  auto page{store_->pending_list_wait(*pending_)};
+  pending_.reset();
+  if (page) {
+    if (auto cursor{page->next_cursor()}) {
+      this->request(std::move(cursor));
+    }
+  }
+  return page;
+}
+
+std::optional<ShardedListPage> ShardedListScan::next() {
+  std::vector<std::uint32_t> handles;
+  std::vector<std::size_t> shards;
+  for (std::size_t i{0}; i < shards_.size(); i++) {
+    auto &shard{shards_[i]};
+    if (shard.pending_) {
+      handles.push_back(shard.pending_->as_u32());
+      shards.push_back(i);
+    } else if (shard.error_) {
+      return ShardedListPage{i, std::move(*shard.next())};
+    }
+  }
+  if (handles.empty()) {
+    return std::nullopt;
+  }
+  fastly::sys::error::FastlyError *err;
+  auto done{fastly::sys::async_io::f_async_io_select(
+      {handles.data(), handles.size()}, 0, err)};
+  if (err != nullptr) {
+    // Take the first shard, whose own wait reports the failure.
+    rust::Box<fastly::sys::error::FastlyError>::from_raw(err);
+    done = 0;
+  }
+  auto shard{shards[done]};
+  return ShardedListPage{shard, std::move(*shards_[shard].next())};
+}
+
+std::size_t ShardedListScan::remaining_shards() const {
+  return std::ranges::count_if(shards_, [](auto &shard) {
+    return shard.pending_.has_value() || shard.error_.has_value();
+  });
+}
+
 expected<std::optional<KVStore>> KVStore::open(std::string_view name) {
   fastly::sys::kv_store::KVStore *store;
   fastly::sys::kv_store::KVStoreError *err;
@@ -281,6 +484,29 @@ KVStore::pending_lookup_wait(PendingLookupHandle pending_request_handle) const {
       rust::Box<fastly::sys::kv_store::LookupResponse>::from_raw(response)};
 }
 
+expected<LookupInfo> KVStore::lookup_info(std::string_view key) const {
+  fastly::sys::kv_store::LookupInfo *info;
+  fastly::sys::kv_store::KVStoreError *err;
+  store_->lookup_info({key.data(), key.size()}, info, err);
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  return LookupInfo{
+      rust::Box<fastly::sys::kv_store::LookupInfo>::from_raw(info)};
+}
+
+expected<LookupInfo> KVStore::pending_lookup_info_wait(
+    PendingLookupHandle pending_request_handle) const {
+  fastly::sys::kv_store::LookupInfo *info;
+  fastly::sys::kv_store::KVStoreError *err;
+  store_->pending_lookup_info_wait(pending_request_handle.as_u32(), info, err);
+  if (err != nullptr) {
+    return unexpected(err);
+  }
+  return LookupInfo{
+      rust::Box<fastly::sys::kv_store::LookupInfo>::from_raw(info)};
+}
+
 expected<> KVStore::insert(std::string_view key, Body value) const {
   fastly::sys::kv_store::KVStoreError *err;
   store_->insert({key.data(), key.size()}, std::move(value.bod), err);
@@ -333,7 +559,9 @@ expected<ListPage> KVStore::list() const {
   return ListPage{rust::Box<fastly::sys::kv_store::ListPage>::from_raw(page)};
 }
 
-ListBuilder KVStore::build_list() const { return {store_->build_list()}; }
+ListBuilder KVStore::build_list() const {
+  return {store_->build_list(), *this};
+}
 
 expected<ListPage>
 KVStore::pending_list_wait(PendingListHandle pending_request_handle) const {
@@ -346,4 +574,228 @@ KVStore::pending_list_wait(PendingListHandle pending_request_handle) const {
   return ListPage{rust::Box<fastly::sys::kv_store::ListPage>::from_raw(page)};
 }
 
-} // namespace fastly::kv_store
\ No newline at end of file
+LookupMany::LookupMany(const KVStore &store, std::vector<std::string> keys,
+                       std::size_t max_in_flight)
+    : store_(&store), keys_(std::move(keys)),
+      max_in_flight_(std::max<std::size_t>(max_in_flight, 1)) {
+  this->start_lookups();
+}
+
+void LookupMany::start_lookups() {
+  while (this->in_flight_.size() < this->max_in_flight_ &&
+         this->started_ < this->keys_.size()) {
+    auto index{this->started_++};
+    auto handle{this->store_->build_lookup().execute_async(this->keys_[index])};
+    if (!handle) {
+      this->failed_.push_back({index, unexpected(std::move(handle.error()))});
+      continue;
+    }
+    this->in_flight_.push_back(index);
+    this->handles_.push_back(handle->as_u32());
+  }
+}
+
+std::optional<LookupManyItem> LookupMany::next() {
+  if (!this->failed_.empty()) {
+    auto item{std::move(this->failed_.front())};
+    this->failed_.pop_front();
+    this->returned_++;
+    return item;
+  }
+  if (this->handles_.empty()) {
+    return std::nullopt;
+  }
+  fastly::sys::error::FastlyError *err;
+  auto done{fastly::sys::async_io::f_async_io_select(
+      {this->handles_.data(), this->handles_.size()}, 0, err)};
+  if (err != nullptr) {
+    // Take the first lookup, whose own wait reports the failure.
+    rust::Box<fastly::sys::error::FastlyError>::from_raw(err);
+    done = 0;
+  }
+  auto index{this->in_flight_[done]};
+  auto handle{PendingLookupHandle::from_u32(this->handles_[done])};
+  // Order doesn't matter, so swap the finished lookup out rather than
+  // shifting the rest down.
+  this->in_flight_[done] = this->in_flight_.back();
+  this->in_flight_.pop_back();
+  this->handles_[done] = this->handles_.back();
+  this->handles_.pop_back();
+
+  LookupManyItem item{index, this->store_->pending_lookup_wait(handle)};
+  this->start_lookups();
+  this->returned_++;
+  return item;
+}
+
+LookupMany KVStore::lookup_many(std::span<const std::string_view> keys,
+                                std::size_t max_in_flight) const {
+  return LookupMany(*this, std::vector<std::string>(keys.begin(), keys.end()),
+                    max_in_flight);
+}
+
+std::vector<expected<LookupResponse>>
+KVStore::lookup_many_ordered(std::span<const std::string_view> keys,
+                             std::size_t max_in_flight) const {
+  std::vector<std::optional<expected<LookupResponse>>> slots(keys.size());
+  auto results{this->lookup_many(keys, max_in_flight)};
+  while (auto item{results.next()}) {
+    slots[item->index].emplace(std::move(item->response));
+  }
+  std::vector<expected<LookupResponse>> ordered;
+  ordered.reserve(slots.size());
+  for (auto &slot : slots) {
+    ordered.push_back(std::move(*slot));
+  }
+  return ordered;
+}
+
+namespace {
+
+// How long `KVStore::update()` waits before trying again: long enough for a
+// competing writer to finish, with jitter so that writers that collided don't
+// collide again.
+const fastly::detail::Backoff update_backoff{std::chrono::milliseconds(5),
+                                             std::chrono::milliseconds(200),
+                                             2.0, true};
+
+} // namespace
+
+expected<std::optional<std::string>>
+KVStore::update(std::string_view key, UpdateFn fn,
+                std::chrono::milliseconds deadline,
+                std::optional<std::chrono::milliseconds> time_to_live) const {
+  auto give_up{std::chrono::steady_clock::now() + deadline};
+  for (uint32_t retry{1};; retry++) {
+    std::optional<std::string> current;
+    std::optional<std::vector<std::uint8_t>> metadata;
+    std::optional<KVCodec> codec;
+    std::optional<std::uint64_t> generation;
+    auto found{this->lookup(key)};
+    if (found) {
+      auto body{found->take_decoded_body()};
+      if (!body) {
+        return unexpected(
+            KVStoreError::item_bad_request(body.error().error_msg()));
+      }
+      current = body->take_body_string();
+      metadata = found->metadata();
+      codec = found->codec();
+      generation = found->current_generation();
+    } else if (found.error().error_code() != KVStoreErrorCode::ItemNotFound) {
+      return unexpected(std::move(found.error()));
+    }
+
+    auto next{fn(current)};
+    if (!next) {
+      return current;
+    }
+    // A missing item is only inserted if nobody else has inserted it since.
+    auto builder{generation ? this->build_insert().if_generation_match(
+                                  *generation)
+                            : this->build_insert().mode(InsertMode::Add)};
+    if (metadata) {
+      builder = std::move(builder).metadata(
+          std::string(metadata->begin(), metadata->end()));
+    }
+    if (codec) {
+      builder = std::move(builder).codec(*codec);
+    }
+    if (time_to_live) {
+      builder = std::move(builder).time_to_live(*time_to_live);
+    }
+    auto inserted{std::move(builder).execute(std::string(key), Body(*next))};
+    if (inserted) {
+      return next;
+    }
+
+    auto code{inserted.error().error_code()};
+    auto delay{update_backoff.delay(retry)};
+    if ((code != KVStoreErrorCode::ItemPreconditionFailed &&
+         code != KVStoreErrorCode::TooManyRequests) ||
+        std::chrono::steady_clock::now() + delay >= give_up) {
+      return unexpected(std::move(inserted.error()));
+    }
+    fastly::detail::sleep_for(delay);
+  }
+}
+
+expected<std::int64_t>
+KVStore::increment(
+    std::string_view key, std::int64_t delta,
+    std::chrono::milliseconds deadline,
+    std::optional<std::chrono::milliseconds> time_to_live) const {
+  std::int64_t count{0};
+  bool invalid{false};
+  auto updated{this->update(
+      key,
+      [&](const std::optional<std::string> &current)
+          -> std::optional<std::string> {
+        count = 0;
+        if (current) {
+          auto end{current->data() + current->size()};
+          auto [ptr, ec]{std::from_chars(current->data(), end, count)};
+          invalid = ec != std::errc() || ptr != end;
+          if (invalid) {
+            return std::nullopt;
+          }
+        }
+        invalid = __builtin_add_overflow(count, delta, &count);
+        if (invalid) {
+          return std::nullopt;
+        }
+        return std::to_string(count);
+      },
+      deadline, time_to_live)};
+  if (!updated) {
+    return unexpected(std::move(updated.error()));
+  }
+  if (invalid) {
+    return unexpected(KVStoreError::item_bad_request());
+  }
+  return count;
+}
+
+expected<std::vector<std::string>>
+KVStore::merge_set(
+    std::string_view key, const std::vector<std::string> &members,
+    std::chrono::milliseconds deadline,
+    std::optional<std::chrono::milliseconds> time_to_live) const {
+  if (std::any_of(members.begin(), members.end(), [](const auto &member) {
+        return member.find('\n') != std::string::npos;
+      })) {
+    return unexpected(KVStoreError::item_bad_request());
+  }
+  std::set<std::string> merged;
+  auto updated{this->update(
+      key,
+      [&](const std::optional<std::string> &current)
+          -> std::optional<std::string> {
+        merged.clear();
+        std::string_view rest{current ? *current : std::string_view()};
+        while (!rest.empty()) {
+          auto line{rest.substr(0, rest.find('\n'))};
+          merged.emplace(line);
+          rest.remove_prefix(std::min(rest.size(), line.size() + 1));
+        }
+        auto size{merged.size()};
+        merged.insert(members.begin(), members.end());
+        if (current && merged.size() == size) {
+          // Nothing new, so there's nothing to write.
+          return std::nullopt;
+        }
+        std::string value;
+        for (const auto &member : merged) {
+          value += member;
+          value += '\n';
+        }
+        return value;
+      },
+      deadline, time_to_live)};
+  if (!updated) {
+    return unexpected(std::move(updated.error()));
+  }
+  return std::vector<std::string>(merged.begin(), merged.end());
+}
+
+} // namespace fastly::kv_store
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <fastly/background.h>
+#include <fastly/kv_write_batch.h>
+#include <fastly/log.h>
+#include <memory>
+#include <variant>
+
+namespace fastly::kv_store {
+
+namespace {
+
+using Writes = std::map<std::string, std::vector<detail::BatchedWrite>>;
+
+struct Started {
+  std::string key;
+  std::variant<PendingInsertHandle, PendingEraseHandle> handle;
+};
+
+// Start the `round`th write of every key that has that many.
+std::vector<Started> start(const KVStore &store, Writes &writes,
+                           std::size_t round,
+                           std::vector<KVWriteFailure> &failures) {
+  std::vector<Started> started;
+  for (auto &[key, queued] : writes) {
+    if (round >= queued.size()) {
+      continue;
+    }
+    auto &write{queued[round]};
+    if (write.erase) {
+      auto handle{store.build_erase().execute_async(key)};
+      if (!handle) {
+        failures.push_back({key, std::move(handle.error())});
+        continue;
+      }
+      started.push_back({key, *handle});
+      continue;
+    }
+    auto builder{store.build_insert().mode(write.mode)};
+    if (write.ttl) {
+      builder = std::move(builder).time_to_live(*write.ttl);
+    }
+    auto handle{std::move(builder).execute_async(key, std::move(*write.value))};
+    if (!handle) {
+      failures.push_back({key, std::move(handle.error())});
+      continue;
+    }
+    started.push_back({key, *handle});
+  }
+  return started;
+}
+
+// Wait for the writes in `started`, then run the rounds after `round`.
+std::vector<KVWriteFailure> finish(const KVStore &store, Writes &writes,
+                                   std::vector<Started> started,
+                                   std::size_t round,
+                                   std::vector<KVWriteFailure> failures) {
+  std::size_t rounds{0};
+  for (const auto &[key, queued] : writes) {
+    rounds = std::max(rounds, queued.size());
+  }
+  while (true) {
+    for (auto &write : started) {
+      auto done{
+          std::holds_alternative<PendingInsertHandle>(write.handle)
+              ? store.pending_insert_wait(
+                    std::get<PendingInsertHandle>(write.handle))
+              : store.pending_erase_wait(
+                    std::get<PendingEraseHandle>(write.handle))};
+      if (!done) {
+        failures.push_back({std::move(write.key), std::move(done.error())});
+      }
+    }
+    if (++round >= rounds) {
+      return failures;
+    }
+    started = start(store, writes, round, failures);
+  }
+}
+
+} // namespace
+
+expected<std::optional<KVWriteBatch>>
+KVWriteBatch::open(std::string_view name) {
+  auto store{KVStore::open(name)};
+  if (!store) {
+    return unexpected(std::move(store.error()));
+  }
+  if (!*store) {
+    return std::nullopt;
+  }
+  return KVWriteBatch(std::move(**store));
+}
+
+void KVWriteBatch::insert(std::string key, Body value, InsertMode mode,
+                          std::optional<std::chrono::milliseconds> ttl) {
+  auto &queued{this->writes_[std::move(key)]};
+  detail::BatchedWrite write{false, mode, std::move(value), ttl};
+  if (mode == InsertMode::Overwrite) {
+    // Nothing queued before an overwrite affects the result.
+    queued.clear();
+  }
+  if (queued.empty()) {
+    queued.push_back(std::move(write));
+    return;
+  }
+
+  auto &last{queued.back()};
+  if (last.erase && mode != InsertMode::Overwrite) {
+    // The key is gone by then, so any mode amounts to an overwrite.
+    last.erase = false;
+    last.mode = InsertMode::Overwrite;
+    last.value.emplace(std::move(*write.value));
+    last.ttl = ttl;
+    return;
+  }
+  if (mode == InsertMode::Add) {
+    // The key exists by then, unless the write before fails, so the add would
+    // fail.
+    return;
+  }
+  auto joins{[&](InsertMode onto) {
+    return last.mode == InsertMode::Overwrite || last.mode == onto;
+  }};
+  if (mode == InsertMode::Append && joins(InsertMode::Append)) {
+    last.value->append(std::move(*write.value));
+  } else if (mode == InsertMode::Prepend && joins(InsertMode::Prepend)) {
+    write.value->append(std::move(*last.value));
+    last.value.emplace(std::move(*write.value));
+  } else {
+    queued.push_back(std::move(write));
+    return;
+  }
+  if (ttl) {
+    last.ttl = ttl;
+  }
+}
+
+void KVWriteBatch::erase(std::string key) {
+  auto &queued{this->writes_[std::move(key)]};
+  queued.clear();
+  queued.push_back({true, InsertMode::Overwrite, std::nullopt, std::nullopt});
+}
+
+std::size_t KVWriteBatch::size() const {
+  std::size_t size{0};
+  for (const auto &[key, queued] : this->writes_) {
+    size += queued.size();
+  }
+  return size;
+}
+
+std::vector<KVWriteFailure> KVWriteBatch::commit() && {
+  std::vector<KVWriteFailure> failures;
+  auto started{start(this->store_, this->writes_, 0, failures)};
+  return finish(this->store_, this->writes_, std::move(started), 0,
+                std::move(failures));
+}
+
+void KVWriteBatch::commit_in_background() && {
+  struct Pending {
+    KVStore store;
+    Writes writes;
+    std::vector<Started> started;
+    std::vector<KVWriteFailure> failures;
+  };
+  std::vector<KVWriteFailure> failures;
+  auto started{start(this->store_, this->writes_, 0, failures)};
+  auto pending{std::make_shared<Pending>(
+      std::move(this->store_), std::move(this->writes_), std::move(started),
+      std::move(failures))};
+  fastly::background::defer([pending]() {
+    auto failed{finish(pending->store, pending->writes,
+                       std::move(pending->started), 0,
+                       std::move(pending->failures))};
+    for (auto &failure : failed) {
+      fastly::log::warn("KV write batch: write of {} failed: {}", failure.key,
+                        failure.error.error_msg());
+    }
+  });
+}
+
+} // namespace fastly::kv_store
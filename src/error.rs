@@ -61,6 +61,8 @@ pub enum FastlyError {
     LogError(#[from] fastly::log::LogError),
     #[error(transparent)]
     ESIError(#[from] esi::ExecutionError),
+    #[error("circuit open for backend {0}")]
+    CircuitOpen(String),
     // Make sure to add any new variants to the `FastlyErrorCode` enum in `lib.rs` _and_ to the match below!
 }
 
@@ -90,6 +92,14 @@ fn fastly_status_message(status: &fastly_shared::FastlyStatus) -> &'static str {
 
 pub(crate) type ErrPtr<'a> = Pin<&'a mut *mut FastlyError>;
 
+pub fn m_static_error_fastly_error_io(message: &CxxString) -> Box<FastlyError> {
+    Box::new(std::io::Error::other(message.to_string_lossy().into_owned()).into())
+}
+
+pub fn m_static_error_fastly_error_circuit_open(backend: &CxxString) -> Box<FastlyError> {
+    Box::new(FastlyError::CircuitOpen(backend.to_string_lossy().into_owned()))
+}
+
 impl FastlyError {
     pub fn error_msg(&self, mut out: Pin<&mut CxxString>) {
         write!(out, "{self}").expect("This should never fail.");
@@ -114,6 +124,7 @@ impl FastlyError {
             FastlyError::SecretStoreLookupError(_) => FastlyErrorCode::SecretStoreLookupError,
             FastlyError::LogError(_) => FastlyErrorCode::LogError,
             FastlyError::ESIError(_) => FastlyErrorCode::ESIError,
+            FastlyError::CircuitOpen(_) => FastlyErrorCode::CircuitOpen,
         }
     }
 }
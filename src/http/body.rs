@@ -1,4 +1,7 @@
-use std::io::{Read as _, Write as _};
+use std::{
+    io::{Read as _, Write as _},
+    pin::Pin,
+};
 
 use cxx::CxxString;
 use fastly::{
@@ -33,6 +36,10 @@ impl Body {
     pub fn write(&mut self, bytes: &[u8], mut err: ErrPtr) -> usize {
         try_fe!(err, self.0.write(bytes))
     }
+
+    pub fn known_length(&self, out: Pin<&mut u64>) -> bool {
+        self.0.known_length().map(|len| out.set(len)).is_some()
+    }
 }
 
 pub struct StreamingBody(pub(crate) fastly::http::body::StreamingBody);
@@ -5,6 +5,7 @@ pub mod request;
 pub mod response;
 pub mod status_code;
 
+use crate::ffi::FramingHeadersMode;
 use crate::ffi::Method;
 use crate::ffi::Version;
 
@@ -67,3 +68,15 @@ impl From<fastly::http::Version> for Version {
         }
     }
 }
+
+impl From<FramingHeadersMode> for fastly::http::FramingHeadersMode {
+    fn from(val: FramingHeadersMode) -> Self {
+        match val {
+            FramingHeadersMode::Automatic => fastly::http::FramingHeadersMode::Automatic,
+            FramingHeadersMode::ManuallyFromHeaders => {
+                fastly::http::FramingHeadersMode::ManuallyFromHeaders
+            }
+            _ => panic!("Unsupported framing headers mode."),
+        }
+    }
+}
@@ -1,11 +1,12 @@
 use std::pin::Pin;
+use std::time::Duration;
 
 use cxx::{CxxString, CxxVector};
 use http::{HeaderName, HeaderValue};
 
 use crate::backend::Backend;
 use crate::error::ErrPtr;
-use crate::ffi::{Method, Version};
+use crate::ffi::{AfterSendFnTag, BeforeSendFnTag, FramingHeadersMode, Method, Version};
 use crate::http::body::{Body, StreamingBody};
 use crate::http::header::{
     HeaderNamesIter, HeaderValuesIter, HeadersIter, OriginalHeaderNamesIter,
@@ -14,8 +15,114 @@ use crate::http::request::request::{AsyncStreamRes, PendingRequest};
 use crate::http::response::Response;
 use crate::try_fe;
 
+// Transparent, so that a before-send hook can borrow the request being sent.
+#[repr(transparent)]
 pub struct Request(pub(crate) fastly::Request);
 
+/// Owns a `BeforeSendFn` passed in from C++, deleting it when dropped.
+struct BeforeSendFnGuard(*mut BeforeSendFnTag);
+
+// The hook can only run on the thread that sends the request, and Wasm
+// guests are single-threaded anyway.
+unsafe impl Send for BeforeSendFnGuard {}
+unsafe impl Sync for BeforeSendFnGuard {}
+
+impl Drop for BeforeSendFnGuard {
+    fn drop(&mut self) {
+        unsafe { crate::manual_ffi::fastly_http_manualbridge_BeforeSendFn_drop(self.0) }
+    }
+}
+
+/// Owns an `AfterSendFn` passed in from C++, deleting it when dropped.
+struct AfterSendFnGuard(*mut AfterSendFnTag);
+
+unsafe impl Send for AfterSendFnGuard {}
+unsafe impl Sync for AfterSendFnGuard {}
+
+impl Drop for AfterSendFnGuard {
+    fn drop(&mut self) {
+        unsafe { crate::manual_ffi::fastly_http_manualbridge_AfterSendFn_drop(self.0) }
+    }
+}
+
+/// A backend response that is about to be cached, as seen by an after-send
+/// hook. C++ only ever borrows it.
+#[repr(transparent)]
+pub struct CandidateResponse(fastly::http::CandidateResponse);
+
+impl CandidateResponse {
+    pub fn set_cacheable(&mut self) {
+        self.0.set_cacheable();
+    }
+
+    pub fn set_uncacheable(&mut self, record_uncacheable: bool) {
+        self.0.set_uncacheable(record_uncacheable);
+    }
+
+    pub fn set_ttl(&mut self, ttl_ms: u64) {
+        self.0.set_ttl(Duration::from_millis(ttl_ms));
+    }
+
+    pub fn set_stale_while_revalidate(&mut self, swr_ms: u64) {
+        self.0
+            .set_stale_while_revalidate(Duration::from_millis(swr_ms));
+    }
+
+    pub fn set_pci(&mut self, pci: bool) {
+        self.0.set_pci(pci);
+    }
+
+    pub fn get_header(
+        &self,
+        name: &CxxString,
+        mut value_out: Pin<&mut CxxVector<u8>>,
+        mut err: ErrPtr,
+    ) -> bool {
+        self.0
+            .get_header(try_fe!(err, HeaderName::try_from(name.as_bytes())))
+            .map(|value| {
+                for byte in value.as_bytes() {
+                    value_out.as_mut().push(*byte);
+                }
+            })
+            .is_some()
+    }
+
+    pub fn set_header(&mut self, name: &CxxString, value: &CxxString, mut err: ErrPtr) {
+        self.0.set_header(
+            try_fe!(err, HeaderName::try_from(name.as_bytes())),
+            try_fe!(err, HeaderValue::try_from(value.as_bytes())),
+        );
+    }
+
+    pub fn append_header(&mut self, name: &CxxString, value: &CxxString, mut err: ErrPtr) {
+        self.0.append_header(
+            try_fe!(err, HeaderName::try_from(name.as_bytes())),
+            try_fe!(err, HeaderValue::try_from(value.as_bytes())),
+        );
+    }
+
+    pub fn remove_header(
+        &mut self,
+        name: &CxxString,
+        out: Pin<&mut CxxString>,
+        mut err: ErrPtr,
+    ) -> bool {
+        self.0
+            .remove_header(try_fe!(err, HeaderName::try_from(name.as_bytes())))
+            .map(|header| out.push_bytes(header.as_bytes()))
+            .is_some()
+    }
+
+    pub fn get_status(&self) -> u16 {
+        self.0.get_status().as_u16()
+    }
+
+    pub fn set_status(&mut self, status: u16) {
+        self.0.set_status(status);
+    }
+}
+
 #[allow(clippy::module_inception)]
 pub mod request {
 
@@ -105,20 +212,53 @@ pub mod request {
         pub fn cloned_sent_req(&self) -> Box<Request> {
             Box::new(Request(self.0.sent_req().clone_without_body()))
         }
+
+        /// The host handle of the request, to wait on alongside other kinds of operation.
+        pub fn handle(&self) -> u32 {
+            self.0.handle().as_u32()
+        }
     }
 
     pub fn f_http_request_select(
         reqs: Vec<BoxPendingRequest>,
         mut out: Pin<&mut *mut Response>,
+        done: &mut usize,
         others: &mut Vec<BoxPendingRequest>,
         mut err: ErrPtr,
     ) {
-        let (res, xs) =
-            fastly::http::request::select(reqs.into_iter().map(|mut r| (*(r.extract_req())).0));
-        for x in xs {
+        let mut reqs: Vec<_> = reqs
+            .into_iter()
+            .map(|mut r| (*(r.extract_req())).0)
+            .collect();
+        // The crate's `select` doesn't say which request finished, so this waits on the host
+        // handles directly, whose done index is the finished request's position.
+        let handles: Vec<_> = reqs.iter().map(|x| x.handle().as_u32()).collect();
+        let index = match crate::async_io::select(&handles, 0) {
+            Ok(Some(index)) if index < reqs.len() => index,
+            result => {
+                // Nothing finished, so every request goes back to the caller.
+                *done = reqs.len();
+                others.extend(
+                    reqs.into_iter()
+                        .map(|x| BoxPendingRequest(Some(Box::new(PendingRequest(x))))),
+                );
+                let e: FastlyError = match result {
+                    Err(status) => status.into(),
+                    Ok(_) => std::io::Error::other("select finished no request").into(),
+                };
+                err.set(Box::into_raw(Box::new(e)));
+                return;
+            }
+        };
+        let finished = reqs.remove(index);
+        *done = index;
+        for x in reqs {
             others.push(BoxPendingRequest(Some(Box::new(PendingRequest(x)))));
         }
-        out.set(Box::into_raw(Box::new(Response(try_fe!(err, res)))));
+        out.set(Box::into_raw(Box::new(Response(try_fe!(
+            err,
+            finished.wait()
+        )))));
     }
 
     pub struct AsyncStreamRes(
@@ -137,6 +277,91 @@ pub mod request {
     }
 }
 
+/// A set of caching overrides, kept in the crate's own type so that combining settings (such as
+/// un-passing on setting a TTL) behaves exactly as the individual `Request` setters do.
+pub struct CacheOverride {
+    inner: fastly::http::request::CacheOverride,
+    // An invalid surrogate key, reported when the override is applied rather than when it is
+    // built.
+    bad_surrogate_key: Option<Vec<u8>>,
+}
+
+pub fn m_static_http_cache_override_none() -> Box<CacheOverride> {
+    Box::new(CacheOverride {
+        inner: fastly::http::request::CacheOverride::none(),
+        bad_surrogate_key: None,
+    })
+}
+
+pub fn m_static_http_cache_override_pass() -> Box<CacheOverride> {
+    Box::new(CacheOverride {
+        inner: fastly::http::request::CacheOverride::pass(),
+        bad_surrogate_key: None,
+    })
+}
+
+impl CacheOverride {
+    pub fn clone(&self) -> Box<CacheOverride> {
+        Box::new(CacheOverride {
+            inner: self.inner.clone(),
+            bad_surrogate_key: self.bad_surrogate_key.clone(),
+        })
+    }
+
+    pub fn set_ttl(&mut self, ttl: u32) {
+        self.inner.set_ttl(ttl);
+    }
+
+    pub fn set_stale_while_revalidate(&mut self, swr: u32) {
+        self.inner.set_stale_while_revalidate(swr);
+    }
+
+    pub fn set_pci(&mut self, pci: bool) {
+        self.inner.set_pci(pci);
+    }
+
+    pub fn set_surrogate_key(&mut self, sk: &CxxString) {
+        match HeaderValue::try_from(sk.as_bytes()) {
+            Ok(sk) => {
+                self.inner.set_surrogate_key(sk);
+                self.bad_surrogate_key = None;
+            }
+            Err(_) => self.bad_surrogate_key = Some(sk.as_bytes().to_vec()),
+        }
+    }
+
+    pub fn is_pass(&self) -> bool {
+        self.inner.is_pass()
+    }
+
+    pub fn get_ttl(&self, out: Pin<&mut u32>) -> bool {
+        self.inner
+            .get_ttl()
+            .map(|ttl| *out.get_mut() = ttl)
+            .is_some()
+    }
+
+    pub fn get_stale_while_revalidate(&self, out: Pin<&mut u32>) -> bool {
+        self.inner
+            .get_stale_while_revalidate()
+            .map(|swr| *out.get_mut() = swr)
+            .is_some()
+    }
+
+    pub fn get_pci(&self) -> bool {
+        self.inner.get_pci().unwrap_or(false)
+    }
+
+    pub fn get_surrogate_key(&self, out: Pin<&mut CxxString>) -> bool {
+        match &self.bad_surrogate_key {
+            Some(sk) => Some(sk.as_slice()),
+            None => self.inner.get_surrogate_key().map(HeaderValue::as_bytes),
+        }
+        .map(|sk| out.push_bytes(sk))
+        .is_some()
+    }
+}
+
 pub fn m_static_http_request_new(method: Method, url: &CxxString) -> Box<Request> {
     let method: fastly::http::Method = method.into();
     Box::new(Request(fastly::Request::new(
@@ -238,6 +463,22 @@ pub fn m_http_request_send_async_streaming(
     ))));
 }
 
+pub fn m_http_request_handoff_websocket(
+    request: Box<Request>,
+    backend: &Backend,
+    mut err: ErrPtr,
+) {
+    try_fe!(err, request.0.handoff_websocket(backend.0.name()))
+}
+
+pub fn m_http_request_handoff_fanout(
+    request: Box<Request>,
+    backend: &Backend,
+    mut err: ErrPtr,
+) {
+    try_fe!(err, request.0.handoff_fanout(backend.0.name()))
+}
+
 pub fn m_http_request_into_body(request: Box<Request>) -> Box<Body> {
     Box::new(Body(request.0.into_body()))
 }
@@ -254,19 +495,50 @@ impl Request {
         Box::new(Request(self.0.clone_with_body()))
     }
 
-    // TODO(@zkat): cxx doesn't support function pointers
-    // pub fn set_after_send(&mut self, _f: unsafe extern "C" fn(*mut Request)) {
-    //     unimplemented!()
-    // }
+    /// # Safety
+    ///
+    /// `f` must point to a live `AfterSendFn` allocated with `new`. This takes
+    /// ownership of it, and deletes it once the hook is dropped.
+    pub unsafe fn set_after_send(&mut self, f: *mut AfterSendFnTag) {
+        let f = AfterSendFnGuard(f);
+        self.0.set_after_send(move |candidate| {
+            let candidate = candidate as *mut fastly::http::CandidateResponse;
+            unsafe {
+                crate::manual_ffi::fastly_http_manualbridge_AfterSendFn_call(
+                    f.0,
+                    candidate as *mut CandidateResponse,
+                );
+            }
+            Ok(())
+        });
+    }
 
     pub fn set_auto_decompress_gzip(&mut self, gzip: bool) {
         self.0.set_auto_decompress_gzip(gzip);
     }
 
-    // TODO(@zkat): cxx doesn't support function pointers
-    // pub fn set_before_send(&mut self, _f: unsafe extern "C" fn(*mut Request)) -> Box<Request> {
-    //     unimplemented!()
-    // }
+    pub fn set_framing_headers_mode(&mut self, mode: FramingHeadersMode) {
+        self.0.set_framing_headers_mode(mode.into());
+    }
+
+    /// # Safety
+    ///
+    /// `f` must point to a live `BeforeSendFn` allocated with `new`. This takes
+    /// ownership of it, and deletes it once the hook is dropped.
+    pub unsafe fn set_before_send(&mut self, f: *mut BeforeSendFnTag) {
+        let f = BeforeSendFnGuard(f);
+        self.0.set_before_send(move |req| {
+            // C++ only borrows the request, and modifies it in place.
+            let req = req as *mut fastly::Request;
+            unsafe {
+                crate::manual_ffi::fastly_http_manualbridge_BeforeSendFn_call(
+                    f.0,
+                    req as *mut Request,
+                );
+            }
+            Ok(())
+        });
+    }
 
     pub fn set_body(&mut self, body: Box<Body>) {
         self.0.set_body(body.0);
@@ -506,6 +778,13 @@ impl Request {
             .set_surrogate_key(try_fe!(err, HeaderValue::try_from(sk.as_bytes())));
     }
 
+    pub fn set_cache_override(&mut self, co: &CacheOverride, mut err: ErrPtr) {
+        if let Some(sk) = &co.bad_surrogate_key {
+            try_fe!(err, HeaderValue::try_from(sk.as_slice()));
+        }
+        self.0.set_cache_override(co.inner.clone());
+    }
+
     pub fn get_client_ip_addr(&self, buf: Pin<&mut CxxString>) -> bool {
         self.0
             .get_client_ip_addr()
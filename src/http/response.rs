@@ -6,7 +6,7 @@ use http::{HeaderName, HeaderValue};
 use crate::{
     backend::Backend,
     error::ErrPtr,
-    ffi::Version,
+    ffi::{FramingHeadersMode, Version},
     http::{
         body::{Body, StreamingBody},
         header::{HeaderNamesIter, HeaderValuesIter, HeadersIter},
@@ -204,6 +204,10 @@ impl Response {
             .is_some()
     }
 
+    pub fn get_status(&self) -> u16 {
+        self.0.get_status().as_u16()
+    }
+
     pub fn set_status(&mut self, status: u16) {
         self.0.set_status(status);
     }
@@ -269,6 +273,10 @@ impl Response {
     pub fn set_version(&mut self, version: Version) {
         self.0.set_version(version.into());
     }
+
+    pub fn set_framing_headers_mode(&mut self, mode: FramingHeadersMode) {
+        self.0.set_framing_headers_mode(mode.into());
+    }
 }
 
 fn ensure_u32(num: u128) -> u32 {
@@ -0,0 +1,180 @@
+use std::{
+    cell::RefCell,
+    collections::BTreeMap,
+    io::{self, Write},
+    rc::Rc,
+};
+
+use zstd::dict::{DecoderDictionary, EncoderDictionary};
+
+// Values stored through a codec have their metadata prefixed with
+// `fastly-codec:<codec>\n`, where `<codec>` is `zstd`, `zstd:<dictionary>` or `lz4`.
+const TAG_PREFIX: &str = "fastly-codec:";
+
+#[derive(Clone)]
+enum Codec {
+    Zstd {
+        level: i32,
+        dictionary: Option<(String, Rc<EncoderDictionary<'static>>)>,
+    },
+    Lz4,
+}
+
+#[derive(Clone)]
+pub struct KVCodec(Codec);
+
+thread_local! {
+    // Dictionaries are looked up by name when decoding, so values compressed with one can be
+    // read by any lookup once the codec has been created in this instance. The codec is kept
+    // with its dictionary, so that a value can be compressed with it again.
+    static DICTIONARIES: RefCell<BTreeMap<String, (Rc<DecoderDictionary<'static>>, KVCodec)>> =
+        const { RefCell::new(BTreeMap::new()) };
+}
+
+pub fn m_static_kv_store_kv_codec_zstd(level: i32) -> Box<KVCodec> {
+    Box::new(KVCodec(Codec::Zstd {
+        level,
+        dictionary: None,
+    }))
+}
+
+pub fn m_static_kv_store_kv_codec_lz4() -> Box<KVCodec> {
+    Box::new(KVCodec(Codec::Lz4))
+}
+
+pub fn m_static_kv_store_kv_codec_zstd_with_dictionary(
+    name: &str,
+    dictionary: &[u8],
+    level: i32,
+) -> Box<KVCodec> {
+    let codec = KVCodec(Codec::Zstd {
+        level,
+        dictionary: Some((
+            name.to_owned(),
+            Rc::new(EncoderDictionary::copy(dictionary, level)),
+        )),
+    });
+    DICTIONARIES.with_borrow_mut(|dictionaries| {
+        dictionaries.insert(
+            name.to_owned(),
+            (Rc::new(DecoderDictionary::copy(dictionary)), codec.clone()),
+        );
+    });
+    Box::new(codec)
+}
+
+impl KVCodec {
+    /// The codec a value was stored with, as named in its metadata, so that a new value can be
+    /// stored the same way. zstd's level isn't recorded, so values that were compressed without
+    /// a dictionary are compressed at the default level.
+    pub(crate) fn from_name(codec: &str) -> Option<KVCodec> {
+        match codec.split_once(':') {
+            Some(("zstd", name)) => DICTIONARIES
+                .with_borrow(|dictionaries| dictionaries.get(name).map(|(_, codec)| codec.clone())),
+            None if codec == "zstd" => Some(KVCodec(Codec::Zstd {
+                level: zstd::DEFAULT_COMPRESSION_LEVEL,
+                dictionary: None,
+            })),
+            None if codec == "lz4" => Some(KVCodec(Codec::Lz4)),
+            _ => None,
+        }
+    }
+
+    pub(crate) fn tag(&self) -> String {
+        match &self.0 {
+            Codec::Zstd {
+                dictionary: None, ..
+            } => format!("{TAG_PREFIX}zstd\n"),
+            Codec::Zstd {
+                dictionary: Some((name, _)),
+                ..
+            } => format!("{TAG_PREFIX}zstd:{name}\n"),
+            Codec::Lz4 => format!("{TAG_PREFIX}lz4\n"),
+        }
+    }
+
+    pub(crate) fn encode(&self, mut body: fastly::Body) -> io::Result<fastly::Body> {
+        let out = fastly::Body::new();
+        let mut out = match &self.0 {
+            Codec::Zstd {
+                dictionary: Some((_, dictionary)),
+                ..
+            } => {
+                let mut encoder =
+                    zstd::stream::write::Encoder::with_prepared_dictionary(out, dictionary)?;
+                io::copy(&mut body, &mut encoder)?;
+                encoder.finish()?
+            }
+            Codec::Zstd { level, .. } => {
+                let mut encoder = zstd::stream::write::Encoder::new(out, *level)?;
+                io::copy(&mut body, &mut encoder)?;
+                encoder.finish()?
+            }
+            Codec::Lz4 => {
+                let mut encoder = lz4_flex::frame::FrameEncoder::new(out);
+                io::copy(&mut body, &mut encoder)?;
+                encoder.finish().map_err(io::Error::other)?
+            }
+        };
+        out.flush()?;
+        Ok(out)
+    }
+}
+
+/// Whether metadata given for a value starts like a codec's tag, which would make the value
+/// look encoded when it's read.
+pub(crate) fn is_reserved(metadata: &str) -> bool {
+    metadata.starts_with(TAG_PREFIX)
+}
+
+/// Split KV metadata into the codec its value was stored with, if any, and the metadata the
+/// value was stored with by the caller, if any.
+pub(crate) fn split_tag(metadata: &[u8]) -> (Option<&str>, Option<&[u8]>) {
+    let tagged = metadata
+        .strip_prefix(TAG_PREFIX.as_bytes())
+        .and_then(|rest| {
+            let end = rest.iter().position(|&byte| byte == b'\n')?;
+            let codec = std::str::from_utf8(&rest[..end]).ok()?;
+            Some((codec, &rest[end + 1..]))
+        });
+    match tagged {
+        Some((codec, rest)) => (Some(codec), (!rest.is_empty()).then_some(rest)),
+        None => (None, Some(metadata)),
+    }
+}
+
+/// Decode a value stored with `codec`, as named in its metadata. The value is decoded a buffer
+/// at a time into a new body.
+pub(crate) fn decode(codec: &str, body: fastly::Body) -> io::Result<fastly::Body> {
+    let mut out = fastly::Body::new();
+    match codec.split_once(':') {
+        Some(("zstd", name)) => {
+            let dictionary = DICTIONARIES
+                .with_borrow(|dictionaries| {
+                    dictionaries
+                        .get(name)
+                        .map(|(dictionary, _)| dictionary.clone())
+                })
+                .ok_or_else(|| io::Error::other(format!("zstd dictionary {name} is not loaded")))?;
+            let mut decoder = zstd::stream::read::Decoder::with_prepared_dictionary(
+                io::BufReader::new(body),
+                &dictionary,
+            )?;
+            io::copy(&mut decoder, &mut out)?;
+        }
+        None if codec == "zstd" => {
+            io::copy(&mut zstd::stream::read::Decoder::new(body)?, &mut out)?;
+        }
+        None if codec == "lz4" => {
+            io::copy(&mut lz4_flex::frame::FrameDecoder::new(body), &mut out)?;
+        }
+        _ => {
+            return Err(io::Error::new(
+                io::ErrorKind::InvalidData,
+                format!("unknown KV codec {codec}"),
+            ));
+        }
+    }
+    out.flush()?;
+    Ok(out)
+}
@@ -1,17 +1,29 @@
-use std::{fmt::Write, pin::Pin, time::Duration};
+use std::{fmt::Write, io::Read, pin::Pin, time::Duration};
 
 use cxx::{CxxString, CxxVector};
 
 use crate::{
+    error::ErrPtr,
     ffi::{InsertMode, KVStoreErrorCode, ListModeType},
-    http::body::Body,
+    http::body::{Body, StreamingBody},
+    kv_codec::{self, KVCodec},
+    try_fe,
 };
 
-pub struct KVStoreError(pub(crate) fastly::kv_store::KVStoreError);
+// The reason is for errors raised by the SDK itself, such as values that can't be decoded.
+pub struct KVStoreError(pub(crate) fastly::kv_store::KVStoreError, Option<String>);
 
 impl KVStoreError {
+    pub(crate) fn new(error: fastly::kv_store::KVStoreError) -> Self {
+        KVStoreError(error, None)
+    }
+
     pub fn error_msg(&self, mut out: Pin<&mut CxxString>) {
-        write!(out, "{}", self.0).expect("This should never fail.");
+        match &self.1 {
+            Some(reason) => write!(out, "{}: {}", self.0, reason),
+            None => write!(out, "{}", self.0),
+        }
+        .expect("This should never fail.");
     }
 
     pub fn error_code(&self) -> KVStoreErrorCode {
@@ -39,6 +51,13 @@ impl KVStoreError {
     }
 }
 
+pub fn m_static_kv_store_kv_store_error_item_bad_request(reason: &str) -> Box<KVStoreError> {
+    Box::new(KVStoreError(
+        fastly::kv_store::KVStoreError::ItemBadRequest,
+        (!reason.is_empty()).then(|| reason.to_owned()),
+    ))
+}
+
 #[macro_export]
 macro_rules! try_kve {
     ( $err:ident, $x:expr ) => {
@@ -48,14 +67,48 @@ macro_rules! try_kve {
                 val
             }
             std::result::Result::Err(e) => {
-                $err.set(Box::into_raw(Box::new(KVStoreError(e))));
+                $err.set(Box::into_raw(Box::new(KVStoreError::new(e))));
                 return Default::default();
             }
         }
     };
 }
 
-pub struct InsertBuilder<'a>(pub(crate) fastly::kv_store::InsertBuilder<'a>);
+// The metadata and codec are applied when the insert is executed, since the
+// metadata is stored with the codec's tag in front of it.
+pub struct InsertBuilder<'a>(
+    pub(crate) fastly::kv_store::InsertBuilder<'a>,
+    Option<String>,
+    Option<KVCodec>,
+);
+
+impl<'a> InsertBuilder<'a> {
+    pub(crate) fn new(builder: fastly::kv_store::InsertBuilder<'a>) -> Self {
+        InsertBuilder(builder, None, None)
+    }
+
+    fn finish(
+        self,
+        body: fastly::Body,
+    ) -> Result<(fastly::kv_store::InsertBuilder<'a>, fastly::Body), fastly::kv_store::KVStoreError>
+    {
+        let InsertBuilder(mut builder, metadata, codec) = self;
+        let Some(codec) = codec else {
+            if let Some(metadata) = metadata {
+                if kv_codec::is_reserved(&metadata) {
+                    return Err(fastly::kv_store::KVStoreError::ItemBadRequest);
+                }
+                builder = builder.metadata(&metadata);
+            }
+            return Ok((builder, body));
+        };
+        let body = codec
+            .encode(body)
+            .map_err(|_| fastly::kv_store::KVStoreError::ItemBadRequest)?;
+        builder = builder.metadata(&format!("{}{}", codec.tag(), metadata.unwrap_or_default()));
+        Ok((builder, body))
+    }
+}
 
 pub fn m_kv_store_insert_builder_mode(
     mut builder: Box<InsertBuilder>,
@@ -91,7 +144,15 @@ pub fn m_kv_store_insert_builder_metadata<'a>(
     mut builder: Box<InsertBuilder<'a>>,
     data: &CxxString,
 ) -> Box<InsertBuilder<'a>> {
-    builder.0 = builder.0.metadata(data.to_str().expect("Invalid UTF-8"));
+    builder.1 = Some(data.to_str().expect("Invalid UTF-8").to_owned());
+    builder
+}
+
+pub fn m_kv_store_insert_builder_codec<'a>(
+    mut builder: Box<InsertBuilder<'a>>,
+    codec: &KVCodec,
+) -> Box<InsertBuilder<'a>> {
+    builder.2 = Some(codec.clone());
     builder
 }
 
@@ -109,11 +170,10 @@ pub fn m_kv_store_insert_builder_execute(
     body: Box<Body>,
     mut err: Pin<&mut *mut KVStoreError>,
 ) {
+    let (builder, body) = try_kve!(err, (*builder).finish(body.0));
     try_kve!(
         err,
-        builder
-            .0
-            .execute(key.to_str().expect("Invalid UTF-8"), body.0)
+        builder.execute(key.to_str().expect("Invalid UTF-8"), body)
     );
 }
 
@@ -124,11 +184,10 @@ pub fn m_kv_store_insert_builder_execute_async(
     mut out: Pin<&mut u32>,
     mut err: Pin<&mut *mut KVStoreError>,
 ) {
+    let (builder, body) = try_kve!(err, (*builder).finish(body.0));
     let handle = try_kve!(
         err,
-        builder
-            .0
-            .execute_async(key.to_str().expect("Invalid UTF-8"), body.0)
+        builder.execute_async(key.to_str().expect("Invalid UTF-8"), body)
     );
     out.set(handle.as_u32());
 }
@@ -176,21 +235,124 @@ impl LookupResponse {
         }
     }
 
+    pub fn take_decoded_body(&mut self, mut out: Pin<&mut *mut Body>, mut err: ErrPtr) {
+        let body = self.0.take_body();
+        out.set(Box::into_raw(Box::new(Body(try_fe!(
+            err,
+            self.try_decode(body)
+        )))));
+    }
+
     pub fn metadata(&self, mut out: Pin<&mut CxxVector<u8>>) -> bool {
-        self.0
-            .metadata()
-            .map(|metadata| {
-                for byte in metadata {
-                    out.as_mut().push(byte);
-                }
+        let Some(metadata) = self.0.metadata() else {
+            return false;
+        };
+        let Some(metadata) = kv_codec::split_tag(&metadata).1 else {
+            return false;
+        };
+        for byte in metadata {
+            out.as_mut().push(*byte);
+        }
+        true
+    }
+
+    pub fn current_generation(&self) -> u64 {
+        self.0.current_generation()
+    }
+
+    pub fn codec(&self, mut out: Pin<&mut *mut KVCodec>) -> bool {
+        self.codec_name()
+            .and_then(|name| KVCodec::from_name(&name))
+            .map(|codec| {
+                out.set(Box::into_raw(Box::new(codec)));
             })
             .is_some()
     }
 
+    pub fn read_range(&mut self, from: u64, buf: &mut [u8], mut err: ErrPtr) -> usize {
+        let mut body = try_fe!(err, self.take_body_from(from));
+        let mut filled = 0;
+        while filled < buf.len() {
+            match try_fe!(err, body.read(&mut buf[filled..])) {
+                0 => break,
+                n => filled += n,
+            }
+        }
+        filled
+    }
+
+    pub fn copy_range_to(
+        &mut self,
+        from: u64,
+        len: u64,
+        out: &mut StreamingBody,
+        mut err: ErrPtr,
+    ) -> u64 {
+        let body = try_fe!(err, self.take_body_from(from));
+        try_fe!(err, std::io::copy(&mut body.take(len), &mut out.0))
+    }
+
+    pub fn append_to(&mut self, out: &mut StreamingBody) {
+        if let Some(body) = self.0.try_take_body() {
+            out.0.append(body);
+        }
+    }
+
+    // The host has no ranged reads, so the bytes before `from` are read and
+    // dropped, a buffer at a time.
+    fn take_body_from(&mut self, from: u64) -> std::io::Result<fastly::Body> {
+        let body = self
+            .0
+            .try_take_body()
+            .ok_or_else(|| std::io::Error::other("the value has already been taken"))?;
+        let mut body = self.try_decode(body)?;
+        std::io::copy(&mut (&mut body).take(from), &mut std::io::sink())?;
+        Ok(body)
+    }
+
+    fn codec_name(&self) -> Option<String> {
+        let metadata = self.0.metadata()?;
+        kv_codec::split_tag(&metadata).0.map(str::to_owned)
+    }
+
+    fn try_decode(&self, body: fastly::Body) -> std::io::Result<fastly::Body> {
+        match self.codec_name() {
+            Some(codec) => kv_codec::decode(&codec, body),
+            None => Ok(body),
+        }
+    }
+}
+pub struct LookupInfo {
+    metadata: Option<Vec<u8>>,
+    generation: u64,
+}
+
+impl LookupInfo {
+    // The host hands back a body handle with every lookup. Dropping it
+    // unread closes it without any of the value crossing into the guest.
+    fn from_response(mut response: fastly::kv_store::LookupResponse) -> Self {
+        drop(response.try_take_body());
+        LookupInfo {
+            metadata: response
+                .metadata()
+                .and_then(|metadata| kv_codec::split_tag(&metadata).1.map(<[u8]>::to_vec)),
+            generation: response.current_generation(),
+        }
+    }
+
+    pub fn has_metadata(&self) -> bool {
+        self.metadata.is_some()
+    }
+
+    pub fn metadata(&self) -> &[u8] {
+        self.metadata.as_deref().unwrap_or_default()
+    }
+
     pub fn current_generation(&self) -> u64 {
-        self.0.current_generation()
+        self.generation
     }
 }
+
 pub struct LookupBuilder<'a>(pub(crate) fastly::kv_store::LookupBuilder<'a>);
 
 impl LookupBuilder<'_> {
@@ -298,7 +460,7 @@ impl ListResponse<'_> {
                     out.set(Box::into_raw(Box::new(ListPage(page))));
                 }
                 Err(e) => {
-                    err.set(Box::into_raw(Box::new(KVStoreError(e))));
+                    err.set(Box::into_raw(Box::new(KVStoreError::new(e))));
                 }
             })
             .is_some()
@@ -373,12 +535,35 @@ impl KVStore {
         out.set(Box::into_raw(Box::new(LookupResponse(response))));
     }
 
+    pub fn lookup_info(
+        &self,
+        key: &str,
+        mut out: Pin<&mut *mut LookupInfo>,
+        mut err: Pin<&mut *mut KVStoreError>,
+    ) {
+        let response = try_kve!(err, self.0.lookup(key));
+        out.set(Box::into_raw(Box::new(LookupInfo::from_response(response))));
+    }
+
+    pub fn pending_lookup_info_wait(
+        &self,
+        pending_request_handle: u32,
+        mut out: Pin<&mut *mut LookupInfo>,
+        mut err: Pin<&mut *mut KVStoreError>,
+    ) {
+        // Safe because C++ should only pass back handles that were created by us.
+        let handle =
+            unsafe { fastly::kv_store::PendingLookupHandle::from_u32(pending_request_handle) };
+        let response = try_kve!(err, self.0.pending_lookup_wait(handle));
+        out.set(Box::into_raw(Box::new(LookupInfo::from_response(response))));
+    }
+
     pub fn insert(&self, key: &str, value: Box<Body>, mut err: Pin<&mut *mut KVStoreError>) {
         try_kve!(err, self.0.insert(key, value.0,));
     }
 
     pub fn build_insert(&self) -> Box<InsertBuilder<'_>> {
-        Box::new(InsertBuilder(self.0.build_insert()))
+        Box::new(InsertBuilder::new(self.0.build_insert()))
     }
     pub fn pending_insert_wait(
         &self,
@@ -445,7 +630,7 @@ pub fn m_static_kv_store_kv_store_open(
             })
             .is_some(),
         Err(e) => {
-            err.set(Box::into_raw(Box::new(KVStoreError(e))));
+            err.set(Box::into_raw(Box::new(KVStoreError::new(e))));
             false
         }
     }
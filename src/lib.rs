@@ -2,7 +2,9 @@
 // due to the way cxx works.
 #![allow(clippy::boxed_local, clippy::needless_lifetimes)]
 
+use async_io::*;
 use backend::*;
+use cache::core::*;
 use config_store::*;
 use device_detection::*;
 use error::*;
@@ -11,18 +13,22 @@ use geo::*;
 use http::{
     body::*, header::*, purge::*, request::request::*, request::*, response::*, status_code::*,
 };
+use kv_codec::*;
 use kv_store::*;
 use log::*;
 use secret_store::*;
 use security::*;
 
+mod async_io;
 mod backend;
+mod cache;
 mod config_store;
 mod device_detection;
 mod error;
 mod esi;
 mod geo;
 mod http;
+mod kv_codec;
 mod kv_store;
 mod log;
 mod secret_store;
@@ -54,6 +60,7 @@ mod ffi {
         SecretStoreLookupError,
         LogError,
         ESIError,
+        CircuitOpen,
     }
 
     #[namespace = "fastly::sys::http"]
@@ -80,6 +87,24 @@ mod ffi {
         HTTP_3,
     }
 
+    /// Determines how the framing headers (`Content-Length`/`Transfer-Encoding`)
+    /// are set for a request or response.
+    #[namespace = "fastly::sys::http"]
+    #[derive(Copy, Clone, Debug)]
+    pub enum FramingHeadersMode {
+        Automatic,
+        ManuallyFromHeaders,
+    }
+
+    /// The health of a backend, as reported by its health check.
+    #[namespace = "fastly::sys::backend"]
+    #[derive(Copy, Clone, Debug)]
+    pub enum BackendHealth {
+        Unknown,
+        Healthy,
+        Unhealthy,
+    }
+
     /// Connection speed.
     ///
     /// These connection speeds imply different latencies, as well as throughput.
@@ -239,6 +264,8 @@ mod ffi {
         type FastlyError;
         fn error_code(&self) -> FastlyErrorCode;
         fn error_msg(&self, out: Pin<&mut CxxString>);
+        fn m_static_error_fastly_error_io(message: &CxxString) -> Box<FastlyError>;
+        fn m_static_error_fastly_error_circuit_open(backend: &CxxString) -> Box<FastlyError>;
     }
 
     #[namespace = "fastly::sys::backend"]
@@ -273,6 +300,7 @@ mod ffi {
         fn get_tcp_keepalive_probes(&self) -> u32;
         fn get_tcp_keepalive_time(&self) -> u32;
         fn is_ssl(&self) -> bool;
+        fn is_healthy(&self, mut err: Pin<&mut *mut FastlyError>) -> BackendHealth;
     }
 
     #[namespace = "fastly::sys::backend"]
@@ -432,6 +460,16 @@ mod ffi {
             out: Pin<&mut *mut AsyncStreamRes>,
             err: Pin<&mut *mut FastlyError>,
         );
+        fn m_http_request_handoff_websocket(
+            request: Box<Request>,
+            backend: &Backend,
+            err: Pin<&mut *mut FastlyError>,
+        );
+        fn m_http_request_handoff_fanout(
+            request: Box<Request>,
+            backend: &Backend,
+            err: Pin<&mut *mut FastlyError>,
+        );
         fn set_body(&mut self, body: Box<Body>);
         fn has_body(&self) -> bool;
         fn take_body(&mut self) -> Box<Body>;
@@ -496,12 +534,69 @@ mod ffi {
         fn set_stale_while_revalidate(&mut self, swr: u32);
         fn set_pci(&mut self, pci: bool);
         fn set_surrogate_key(&mut self, sk: &CxxString, mut err: Pin<&mut *mut FastlyError>);
+        fn set_cache_override(&mut self, co: &CacheOverride, mut err: Pin<&mut *mut FastlyError>);
         fn set_auto_decompress_gzip(&mut self, gzip: bool);
+        fn set_framing_headers_mode(&mut self, mode: FramingHeadersMode);
         fn fastly_key_is_valid(&self) -> bool;
         fn set_cache_key(&mut self, key: &CxxVector<u8>);
         fn is_cacheable(&mut self) -> bool;
         fn get_version(&self) -> Version;
         fn set_version(&mut self, version: Version);
+        unsafe fn set_before_send(&mut self, f: *mut BeforeSendFnTag);
+        unsafe fn set_after_send(&mut self, f: *mut AfterSendFnTag);
+    }
+
+    #[namespace = "fastly::sys::http"]
+    extern "Rust" {
+        type CacheOverride;
+        fn m_static_http_cache_override_none() -> Box<CacheOverride>;
+        fn m_static_http_cache_override_pass() -> Box<CacheOverride>;
+        fn clone(&self) -> Box<CacheOverride>;
+        fn set_ttl(&mut self, ttl: u32);
+        fn set_stale_while_revalidate(&mut self, swr: u32);
+        fn set_pci(&mut self, pci: bool);
+        fn set_surrogate_key(&mut self, sk: &CxxString);
+        fn is_pass(&self) -> bool;
+        fn get_ttl(&self, mut out: Pin<&mut u32>) -> bool;
+        fn get_stale_while_revalidate(&self, mut out: Pin<&mut u32>) -> bool;
+        fn get_pci(&self) -> bool;
+        fn get_surrogate_key(&self, mut out: Pin<&mut CxxString>) -> bool;
+    }
+
+    #[namespace = "fastly::sys::http"]
+    extern "Rust" {
+        type CandidateResponse;
+        fn set_cacheable(&mut self);
+        fn set_uncacheable(&mut self, record_uncacheable: bool);
+        fn set_ttl(&mut self, ttl_ms: u64);
+        fn set_stale_while_revalidate(&mut self, swr_ms: u64);
+        fn set_pci(&mut self, pci: bool);
+        fn get_header(
+            &self,
+            name: &CxxString,
+            mut value_out: Pin<&mut CxxVector<u8>>,
+            mut err: Pin<&mut *mut FastlyError>,
+        ) -> bool;
+        fn set_header(
+            &mut self,
+            name: &CxxString,
+            value: &CxxString,
+            mut err: Pin<&mut *mut FastlyError>,
+        );
+        fn append_header(
+            &mut self,
+            name: &CxxString,
+            value: &CxxString,
+            mut err: Pin<&mut *mut FastlyError>,
+        );
+        fn remove_header(
+            &mut self,
+            name: &CxxString,
+            out: Pin<&mut CxxString>,
+            mut err: Pin<&mut *mut FastlyError>,
+        ) -> bool;
+        fn get_status(&self) -> u16;
+        fn set_status(&mut self, status: u16);
     }
 
     #[namespace = "fastly::sys::http::request"]
@@ -524,6 +619,7 @@ mod ffi {
             err: Pin<&mut *mut FastlyError>,
         );
         fn cloned_sent_req(&self) -> Box<Request>;
+        fn handle(&self) -> u32;
     }
 
     #[namespace = "fastly::sys::http::request"]
@@ -548,6 +644,7 @@ mod ffi {
         fn f_http_request_select(
             reqs: Vec<BoxPendingRequest>,
             out: Pin<&mut *mut Response>,
+            done: &mut usize,
             others: &mut Vec<BoxPendingRequest>,
             err: Pin<&mut *mut FastlyError>,
         );
@@ -619,6 +716,7 @@ mod ffi {
             out: Pin<&mut CxxString>,
             mut err: Pin<&mut *mut FastlyError>,
         ) -> bool;
+        fn get_status(&self) -> u16;
         fn set_status(&mut self, status: u16);
         fn get_backend_name(&self, out: Pin<&mut CxxString>) -> bool;
         fn get_backend(&self) -> *mut Backend;
@@ -631,6 +729,7 @@ mod ffi {
         fn get_stale_while_revalidate(&self, mut out: Pin<&mut u32>) -> bool;
         fn get_version(&self) -> Version;
         fn set_version(&mut self, version: Version);
+        fn set_framing_headers_mode(&mut self, mode: FramingHeadersMode);
     }
 
     #[namespace = "fastly::sys::http"]
@@ -646,6 +745,7 @@ mod ffi {
         );
         fn read(&mut self, buf: &mut [u8], err: Pin<&mut *mut FastlyError>) -> usize;
         fn write(&mut self, bytes: &[u8], err: Pin<&mut *mut FastlyError>) -> usize;
+        fn known_length(&self, out: Pin<&mut u64>) -> bool;
     }
 
     #[namespace = "fastly::sys::http"]
@@ -908,6 +1008,7 @@ mod ffi {
         type KVStoreError;
         fn error_msg(&self, mut out: Pin<&mut CxxString>);
         fn error_code(&self) -> KVStoreErrorCode;
+        fn m_static_kv_store_kv_store_error_item_bad_request(reason: &str) -> Box<KVStoreError>;
         fn f_kv_store_kv_store_error_force_symbols(x: Box<KVStoreError>) -> Box<KVStoreError>;
     }
 
@@ -928,6 +1029,18 @@ mod ffi {
         Other,
     }
 
+    #[namespace = "fastly::sys::kv_store"]
+    extern "Rust" {
+        type KVCodec;
+        fn m_static_kv_store_kv_codec_zstd(level: i32) -> Box<KVCodec>;
+        fn m_static_kv_store_kv_codec_lz4() -> Box<KVCodec>;
+        fn m_static_kv_store_kv_codec_zstd_with_dictionary(
+            name: &str,
+            dictionary: &[u8],
+            level: i32,
+        ) -> Box<KVCodec>;
+    }
+
     #[namespace = "fastly::sys::kv_store"]
     extern "Rust" {
         type InsertBuilder<'a>;
@@ -946,6 +1059,10 @@ mod ffi {
             mut builder: Box<InsertBuilder<'a>>,
             data: &CxxString,
         ) -> Box<InsertBuilder<'a>>;
+        unsafe fn m_kv_store_insert_builder_codec<'a>(
+            mut builder: Box<InsertBuilder<'a>>,
+            codec: &KVCodec,
+        ) -> Box<InsertBuilder<'a>>;
         fn m_kv_store_insert_builder_time_to_live(
             mut builder: Box<InsertBuilder>,
             ttl: u32,
@@ -971,11 +1088,39 @@ mod ffi {
         fn take_body(&mut self) -> Box<Body>;
         fn try_take_body(&mut self, mut out: Pin<&mut *mut Body>) -> bool;
         fn take_body_bytes(&mut self, mut out: Pin<&mut CxxVector<u8>>);
+        fn take_decoded_body(
+            &mut self,
+            mut out: Pin<&mut *mut Body>,
+            mut err: Pin<&mut *mut FastlyError>,
+        );
         fn metadata(&self, mut out: Pin<&mut CxxVector<u8>>) -> bool;
         fn current_generation(&self) -> u64;
+        fn codec(&self, mut out: Pin<&mut *mut KVCodec>) -> bool;
+        fn read_range(
+            &mut self,
+            from: u64,
+            buf: &mut [u8],
+            mut err: Pin<&mut *mut FastlyError>,
+        ) -> usize;
+        fn copy_range_to(
+            &mut self,
+            from: u64,
+            len: u64,
+            out: &mut StreamingBody,
+            mut err: Pin<&mut *mut FastlyError>,
+        ) -> u64;
+        fn append_to(&mut self, out: &mut StreamingBody);
         fn f_kv_store_lookup_response_force_symbols(x: Box<LookupResponse>) -> Box<LookupResponse>;
     }
 
+    #[namespace = "fastly::sys::kv_store"]
+    extern "Rust" {
+        type LookupInfo;
+        fn has_metadata(&self) -> bool;
+        fn metadata(&self) -> &[u8];
+        fn current_generation(&self) -> u64;
+    }
+
     #[namespace = "fastly::sys::kv_store"]
     extern "Rust" {
         type LookupBuilder<'a>;
@@ -1059,6 +1204,18 @@ mod ffi {
             mut out: Pin<&mut *mut LookupResponse>,
             mut err: Pin<&mut *mut KVStoreError>,
         );
+        fn lookup_info(
+            &self,
+            key: &str,
+            mut out: Pin<&mut *mut LookupInfo>,
+            mut err: Pin<&mut *mut KVStoreError>,
+        );
+        fn pending_lookup_info_wait(
+            &self,
+            pending_request_handle: u32,
+            mut out: Pin<&mut *mut LookupInfo>,
+            mut err: Pin<&mut *mut KVStoreError>,
+        );
         fn insert(&self, key: &str, value: Box<Body>, mut err: Pin<&mut *mut KVStoreError>);
         unsafe fn build_insert(&self) -> Box<InsertBuilder<'_>>;
         fn pending_insert_wait(
@@ -1106,6 +1263,234 @@ mod ffi {
         ) -> bool;
     }
 
+    #[namespace = "fastly::sys::async_io"]
+    extern "Rust" {
+        fn f_async_io_select(
+            handles: &[u32],
+            timeout_ms: u32,
+            err: Pin<&mut *mut FastlyError>,
+        ) -> u32;
+    }
+
+    #[namespace = "fastly::sys::cache"]
+    #[derive(Copy, Clone, Debug)]
+    #[repr(usize)]
+    pub enum CacheErrorCode {
+        LimitExceeded,
+        InvalidOperation,
+        Unsupported,
+        Other,
+    }
+
+    #[namespace = "fastly::sys::cache"]
+    extern "Rust" {
+        type CacheError;
+        fn error_msg(&self, mut out: Pin<&mut CxxString>);
+        fn error_code(&self) -> CacheErrorCode;
+        fn f_cache_core_cache_error_force_symbols(x: Box<CacheError>) -> Box<CacheError>;
+    }
+
+    #[namespace = "fastly::sys::cache"]
+    extern "Rust" {
+        type Found;
+        fn ttl(&self) -> u64;
+        fn age(&self) -> u64;
+        fn stale_while_revalidate(&self) -> u64;
+        fn is_usable(&self) -> bool;
+        fn is_stale(&self) -> bool;
+        fn known_length(&self, out: Pin<&mut u64>) -> bool;
+        fn user_metadata(&self, mut out: Pin<&mut CxxVector<u8>>);
+        fn hits(&self) -> u64;
+        fn to_stream(&self, mut out: Pin<&mut *mut Body>, mut err: Pin<&mut *mut CacheError>);
+        unsafe fn to_stream_from_range(
+            &self,
+            from: *const u64,
+            to: *const u64,
+            mut out: Pin<&mut *mut Body>,
+            mut err: Pin<&mut *mut CacheError>,
+        );
+        fn f_cache_core_found_force_symbols(x: Box<Found>) -> Box<Found>;
+    }
+
+    #[namespace = "fastly::sys::cache"]
+    extern "Rust" {
+        type CacheLookupBuilder;
+        fn f_cache_core_lookup(key: &[u8]) -> Box<CacheLookupBuilder>;
+        fn m_cache_core_lookup_builder_header(
+            mut builder: Box<CacheLookupBuilder>,
+            name: &CxxString,
+            value: &CxxString,
+        ) -> Box<CacheLookupBuilder>;
+        fn m_cache_core_lookup_builder_execute(
+            builder: Box<CacheLookupBuilder>,
+            mut out: Pin<&mut *mut Found>,
+            mut err: Pin<&mut *mut CacheError>,
+        ) -> bool;
+    }
+
+    #[namespace = "fastly::sys::cache"]
+    extern "Rust" {
+        type CacheInsertBuilder;
+        fn f_cache_core_insert(key: &[u8], ttl: u64) -> Box<CacheInsertBuilder>;
+        fn m_cache_core_insert_builder_header(
+            mut builder: Box<CacheInsertBuilder>,
+            name: &CxxString,
+            value: &CxxString,
+        ) -> Box<CacheInsertBuilder>;
+        fn m_cache_core_insert_builder_vary_by(
+            mut builder: Box<CacheInsertBuilder>,
+            headers: &CxxVector<CxxString>,
+        ) -> Box<CacheInsertBuilder>;
+        fn m_cache_core_insert_builder_initial_age(
+            mut builder: Box<CacheInsertBuilder>,
+            age: u64,
+        ) -> Box<CacheInsertBuilder>;
+        fn m_cache_core_insert_builder_stale_while_revalidate(
+            mut builder: Box<CacheInsertBuilder>,
+            duration: u64,
+        ) -> Box<CacheInsertBuilder>;
+        fn m_cache_core_insert_builder_surrogate_keys(
+            mut builder: Box<CacheInsertBuilder>,
+            keys: &CxxVector<CxxString>,
+        ) -> Box<CacheInsertBuilder>;
+        fn m_cache_core_insert_builder_known_length(
+            mut builder: Box<CacheInsertBuilder>,
+            length: u64,
+        ) -> Box<CacheInsertBuilder>;
+        fn m_cache_core_insert_builder_user_metadata(
+            mut builder: Box<CacheInsertBuilder>,
+            metadata: &[u8],
+        ) -> Box<CacheInsertBuilder>;
+        fn m_cache_core_insert_builder_sensitive_data(
+            mut builder: Box<CacheInsertBuilder>,
+            sensitive: bool,
+        ) -> Box<CacheInsertBuilder>;
+        fn m_cache_core_insert_builder_deliver_node_max_age(
+            mut builder: Box<CacheInsertBuilder>,
+            max_age: u64,
+        ) -> Box<CacheInsertBuilder>;
+        fn m_cache_core_insert_builder_execute(
+            builder: Box<CacheInsertBuilder>,
+            mut out: Pin<&mut *mut StreamingBody>,
+            mut err: Pin<&mut *mut CacheError>,
+        );
+    }
+
+    #[namespace = "fastly::sys::cache"]
+    extern "Rust" {
+        type Transaction;
+        fn found(&self, mut out: Pin<&mut *mut Found>) -> bool;
+        fn must_insert(&self) -> bool;
+        fn must_insert_or_update(&self) -> bool;
+        fn cancel_insert_or_update(&self, mut err: Pin<&mut *mut CacheError>);
+        fn m_cache_core_transaction_insert(
+            transaction: Box<Transaction>,
+            ttl: u64,
+        ) -> Box<TransactionInsertBuilder>;
+        fn m_cache_core_transaction_update(
+            transaction: Box<Transaction>,
+            ttl: u64,
+        ) -> Box<TransactionUpdateBuilder>;
+        fn f_cache_core_transaction_force_symbols(x: Box<Transaction>) -> Box<Transaction>;
+    }
+
+    #[namespace = "fastly::sys::cache"]
+    extern "Rust" {
+        type TransactionLookupBuilder;
+        fn m_static_cache_core_transaction_lookup(key: &[u8]) -> Box<TransactionLookupBuilder>;
+        fn m_cache_core_transaction_lookup_builder_header(
+            mut builder: Box<TransactionLookupBuilder>,
+            name: &CxxString,
+            value: &CxxString,
+        ) -> Box<TransactionLookupBuilder>;
+        fn m_cache_core_transaction_lookup_builder_execute(
+            builder: Box<TransactionLookupBuilder>,
+            mut out: Pin<&mut *mut Transaction>,
+            mut err: Pin<&mut *mut CacheError>,
+        );
+    }
+
+    #[namespace = "fastly::sys::cache"]
+    extern "Rust" {
+        type TransactionInsertBuilder;
+        fn m_cache_core_transaction_insert_builder_vary_by(
+            mut builder: Box<TransactionInsertBuilder>,
+            headers: &CxxVector<CxxString>,
+        ) -> Box<TransactionInsertBuilder>;
+        fn m_cache_core_transaction_insert_builder_initial_age(
+            mut builder: Box<TransactionInsertBuilder>,
+            age: u64,
+        ) -> Box<TransactionInsertBuilder>;
+        fn m_cache_core_transaction_insert_builder_stale_while_revalidate(
+            mut builder: Box<TransactionInsertBuilder>,
+            duration: u64,
+        ) -> Box<TransactionInsertBuilder>;
+        fn m_cache_core_transaction_insert_builder_surrogate_keys(
+            mut builder: Box<TransactionInsertBuilder>,
+            keys: &CxxVector<CxxString>,
+        ) -> Box<TransactionInsertBuilder>;
+        fn m_cache_core_transaction_insert_builder_known_length(
+            mut builder: Box<TransactionInsertBuilder>,
+            length: u64,
+        ) -> Box<TransactionInsertBuilder>;
+        fn m_cache_core_transaction_insert_builder_user_metadata(
+            mut builder: Box<TransactionInsertBuilder>,
+            metadata: &[u8],
+        ) -> Box<TransactionInsertBuilder>;
+        fn m_cache_core_transaction_insert_builder_sensitive_data(
+            mut builder: Box<TransactionInsertBuilder>,
+            sensitive: bool,
+        ) -> Box<TransactionInsertBuilder>;
+        fn m_cache_core_transaction_insert_builder_deliver_node_max_age(
+            mut builder: Box<TransactionInsertBuilder>,
+            max_age: u64,
+        ) -> Box<TransactionInsertBuilder>;
+        fn m_cache_core_transaction_insert_builder_execute(
+            builder: Box<TransactionInsertBuilder>,
+            mut out: Pin<&mut *mut StreamingBody>,
+            mut err: Pin<&mut *mut CacheError>,
+        );
+        fn m_cache_core_transaction_insert_builder_execute_and_stream_back(
+            builder: Box<TransactionInsertBuilder>,
+            mut out_body: Pin<&mut *mut StreamingBody>,
+            mut out_found: Pin<&mut *mut Found>,
+            mut err: Pin<&mut *mut CacheError>,
+        );
+    }
+
+    #[namespace = "fastly::sys::cache"]
+    extern "Rust" {
+        type TransactionUpdateBuilder;
+        fn m_cache_core_transaction_update_builder_vary_by(
+            mut builder: Box<TransactionUpdateBuilder>,
+            headers: &CxxVector<CxxString>,
+        ) -> Box<TransactionUpdateBuilder>;
+        fn m_cache_core_transaction_update_builder_age(
+            mut builder: Box<TransactionUpdateBuilder>,
+            age: u64,
+        ) -> Box<TransactionUpdateBuilder>;
+        fn m_cache_core_transaction_update_builder_stale_while_revalidate(
+            mut builder: Box<TransactionUpdateBuilder>,
+            duration: u64,
+        ) -> Box<TransactionUpdateBuilder>;
+        fn m_cache_core_transaction_update_builder_surrogate_keys(
+            mut builder: Box<TransactionUpdateBuilder>,
+            keys: &CxxVector<CxxString>,
+        ) -> Box<TransactionUpdateBuilder>;
+        fn m_cache_core_transaction_update_builder_user_metadata(
+            mut builder: Box<TransactionUpdateBuilder>,
+            metadata: &[u8],
+        ) -> Box<TransactionUpdateBuilder>;
+        fn m_cache_core_transaction_update_builder_deliver_node_max_age(
+            mut builder: Box<TransactionUpdateBuilder>,
+            max_age: u64,
+        ) -> Box<TransactionUpdateBuilder>;
+        fn m_cache_core_transaction_update_builder_execute(
+            builder: Box<TransactionUpdateBuilder>,
+            mut err: Pin<&mut *mut CacheError>,
+        );
+    }
+
     // These tag types are empty types used to communicate callbacks from C++ to Rust.
     // They will be cast back to the real callback types on the C++ side.
     #[namespace = "fastly::detail::rust_bridge_tags::esi"]
@@ -1115,6 +1500,13 @@ mod ffi {
         type ProcessFragmentResponseFnTag;
     }
 
+    #[namespace = "fastly::detail::rust_bridge_tags::http"]
+    unsafe extern "C++" {
+        include!("fastly/detail/rust_bridge_tags.h");
+        type BeforeSendFnTag;
+        type AfterSendFnTag;
+    }
+
     #[namespace = "fastly::sys::esi"]
     extern "Rust" {
         type Processor;
@@ -1152,7 +1544,8 @@ mod ffi {
 // define manual FFI bindings for them here.
 mod manual_ffi {
     use crate::ffi::{
-        DispatchFragmentRequestFnResult, DispatchFragmentRequestFnTag, ProcessFragmentResponseFnTag,
+        AfterSendFnTag, BeforeSendFnTag, DispatchFragmentRequestFnResult,
+        DispatchFragmentRequestFnTag, ProcessFragmentResponseFnTag,
     };
 
     // We never rely on the layout of Rust types passed to these functions,
@@ -1175,5 +1568,23 @@ mod manual_ffi {
             response: *mut crate::Response,
             out_response: &mut *mut crate::Response,
         ) -> bool;
+
+        #[link_name = "fastly$http$manualbridge$BeforeSendFn$call"]
+        pub(crate) fn fastly_http_manualbridge_BeforeSendFn_call(
+            func: *const BeforeSendFnTag,
+            req: *mut crate::Request,
+        );
+
+        #[link_name = "fastly$http$manualbridge$BeforeSendFn$drop"]
+        pub(crate) fn fastly_http_manualbridge_BeforeSendFn_drop(func: *mut BeforeSendFnTag);
+
+        #[link_name = "fastly$http$manualbridge$AfterSendFn$call"]
+        pub(crate) fn fastly_http_manualbridge_AfterSendFn_call(
+            func: *const AfterSendFnTag,
+            candidate: *mut crate::CandidateResponse,
+        );
+
+        #[link_name = "fastly$http$manualbridge$AfterSendFn$drop"]
+        pub(crate) fn fastly_http_manualbridge_AfterSendFn_drop(func: *mut AfterSendFnTag);
     }
 }
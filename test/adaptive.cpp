@@ -0,0 +1,69 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/http/adaptive.h>
+
+using namespace fastly::http::adaptive;
+using namespace std::chrono_literals;
+
+TEST_CASE("LatencyHistogram percentiles are within a bucket", "[adaptive]") {
+  LatencyHistogram histogram;
+  REQUIRE(!histogram.percentile(0.5).has_value());
+  for (int i{1}; i <= 100; i++) {
+    histogram.record(std::chrono::milliseconds(i));
+  }
+  REQUIRE(histogram.count() == 100);
+  auto p50{*histogram.percentile(0.5)};
+  REQUIRE(p50 >= 50ms);
+  REQUIRE(p50 <= 50ms * 9 / 8);
+  auto p99{*histogram.percentile(0.99)};
+  REQUIRE(p99 >= 99ms);
+  REQUIRE(p99 <= 99ms * 9 / 8);
+
+  SECTION("and survive serialization") {
+    auto parsed{LatencyHistogram::parse(histogram.serialize())};
+    REQUIRE(parsed.has_value());
+    REQUIRE(*parsed == histogram);
+    REQUIRE(!LatencyHistogram::parse("1:2,oops").has_value());
+  }
+
+  SECTION("and decay") {
+    histogram.decay();
+    REQUIRE(histogram.count() <= 50);
+  }
+}
+
+TEST_CASE("Timeouts follow latency within bounds", "[adaptive]") {
+  AdaptiveTimeouts timeouts{
+      "no-such-store", AdaptivePolicy()
+                           .min_samples(10)
+                           .factor(2.0)
+                           .first_byte_timeout(100ms, 10s)};
+  REQUIRE(!timeouts.first_byte_timeout("origin").has_value());
+
+  for (int i{0}; i < 10; i++) {
+    timeouts.observe("origin", 400ms);
+  }
+  auto timeout{timeouts.first_byte_timeout("origin")};
+  REQUIRE(timeout.has_value());
+  REQUIRE(*timeout >= 800ms);
+  REQUIRE(*timeout <= 900ms);
+
+  for (int i{0}; i < 10; i++) {
+    timeouts.observe("fast", 1ms);
+    timeouts.observe("slow", 1min);
+  }
+  REQUIRE(timeouts.first_byte_timeout("fast") == 100ms);
+  REQUIRE(timeouts.first_byte_timeout("slow") == 10s);
+
+  SECTION("and are applied to dynamic backends") {
+    auto spec{fastly::backend::BackendSpec("www.fastly.com").enable_ssl()};
+    auto backend{timeouts.backend("adaptive-test", spec)};
+    REQUIRE(backend.has_value());
+    REQUIRE(backend->name() ==
+            fastly::backend::BackendRegistry::backend_name(
+                "adaptive-test", timeouts.apply("adaptive-test", spec)));
+  }
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
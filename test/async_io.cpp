@@ -0,0 +1,72 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/async_io.h>
+#include <map>
+#include <string>
+
+using namespace fastly::async_io;
+using fastly::http::Request;
+using fastly::kv_store::KVStore;
+
+TEST_CASE("A WaitSet returns each operation once", "[async_io]") {
+  auto store{std::move(KVStore::open("test-store")->value())};
+  REQUIRE(store.insert("wait-set/a", fastly::Body("a")));
+
+  WaitSet set;
+  REQUIRE(set.empty());
+  auto origin{set.add(
+      Request::get("https://www.fastly.com/").send_async("fastly").value())};
+  auto lookup{
+      set.add(store, store.build_lookup().execute_async("wait-set/a").value())};
+  auto insert{set.add(store, store.build_insert()
+                                 .execute_async("wait-set/b", fastly::Body("b"))
+                                 .value())};
+  REQUIRE(set.size() == 3);
+
+  std::vector<std::size_t> seen;
+  while (auto ready{set.wait()}) {
+    seen.push_back(ready->id);
+    if (ready->id == origin) {
+      REQUIRE(std::get<ResponseReady>(ready->result).response.has_value());
+    } else if (ready->id == lookup) {
+      auto &found{std::get<LookupReady>(ready->result).response};
+      REQUIRE(found->take_body().take_body_string() == "a");
+    } else {
+      REQUIRE(ready->id == insert);
+      REQUIRE(std::get<InsertReady>(ready->result).result.has_value());
+    }
+  }
+  REQUIRE(seen.size() == 3);
+  REQUIRE(set.empty());
+}
+
+TEST_CASE("A WaitSet of backend requests keeps their IDs", "[async_io]") {
+  WaitSet set;
+  std::map<std::size_t, std::string> backends;
+  backends[set.add(Request::get("https://www.fastly.com/")
+                       .send_async("fastly")
+                       .value())] = "fastly";
+  backends[set.add(Request::get("https://en.wikipedia.org/")
+                       .send_async("wikipedia")
+                       .value())] = "wikipedia";
+  backends[set.add(Request::get("https://esi-cpp-demo.edgecompute.app/")
+                       .send_async("esi-cpp-demo")
+                       .value())] = "esi-cpp-demo";
+
+  while (auto ready{set.wait()}) {
+    auto &response{std::get<ResponseReady>(ready->result).response};
+    REQUIRE(response.has_value());
+    REQUIRE(response->get_backend_name() == backends.at(ready->id));
+    backends.erase(ready->id);
+  }
+  REQUIRE(backends.empty());
+}
+
+TEST_CASE("An empty WaitSet returns nothing", "[async_io]") {
+  WaitSet set;
+  REQUIRE(!set.wait());
+  REQUIRE(!set.wait_for(std::chrono::milliseconds(1)));
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,49 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/backend.h>
+
+using namespace fastly::backend;
+
+TEST_CASE("BackendSpec::hash depends on every setting", "[backend]") {
+  auto base{BackendSpec("www.fastly.com").enable_ssl()};
+  REQUIRE(base.hash() == BackendSpec("www.fastly.com").enable_ssl().hash());
+  REQUIRE(base.hash() != BackendSpec("www.fastly.com").hash());
+  REQUIRE(base.hash() != BackendSpec("www.fastly.com").disable_ssl().hash());
+  REQUIRE(base.hash() != BackendSpec("www.fastly.com")
+                             .enable_ssl()
+                             .first_byte_timeout(std::chrono::seconds(5))
+                             .hash());
+  REQUIRE(BackendSpec("a").override_host("bc").hash() !=
+          BackendSpec("ab").override_host("c").hash());
+}
+
+TEST_CASE("BackendRegistry::get_or_create reuses backends", "[backend]") {
+  auto spec{BackendSpec("www.fastly.com").enable_ssl()};
+  auto first{BackendRegistry::get_or_create("registry-test", spec)};
+  REQUIRE(first.has_value());
+  REQUIRE(first->name() ==
+          BackendRegistry::backend_name("registry-test", spec));
+  REQUIRE(first->is_dynamic());
+
+  auto second{BackendRegistry::get_or_create("registry-test", spec)};
+  REQUIRE(second.has_value());
+  REQUIRE(second->name() == first->name());
+
+  SECTION("after the cache is cleared") {
+    BackendRegistry::clear();
+    auto again{BackendRegistry::get_or_create("registry-test", spec)};
+    REQUIRE(again.has_value());
+    REQUIRE(again->name() == first->name());
+  }
+
+  SECTION("with different settings") {
+    auto other{BackendRegistry::get_or_create(
+        "registry-test",
+        BackendSpec("www.fastly.com").enable_ssl().enable_pooling(false))};
+    REQUIRE(other.has_value());
+    REQUIRE(other->name() != first->name());
+  }
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
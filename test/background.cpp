@@ -0,0 +1,41 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <fastly/background.h>
+#include <fastly/http/response.h>
+
+using namespace fastly::http;
+namespace background = fastly::background;
+
+// Only one response can be sent per instance; the drain after
+// `StreamingBody::finish()` is covered in background_streaming.cpp.
+TEST_CASE("background work is drained after send_to_client",
+          "[background]") {
+  int runs{0};
+  background::defer([&runs]() {
+    runs++;
+    // Work queued while draining is drained in turn.
+    background::defer([&runs]() { runs++; });
+  });
+  REQUIRE(background::pending() == 1);
+  REQUIRE(runs == 0);
+
+  Response::from_body("hello").send_to_client();
+  REQUIRE(runs == 2);
+  REQUIRE(background::pending() == 0);
+}
+
+// The budget is measured from the start of the program and can't be lifted,
+// so this has to come last.
+TEST_CASE("background work isn't started past the time budget",
+          "[background]") {
+  bool ran{false};
+  background::defer([&ran]() { ran = true; });
+  background::set_time_budget(std::chrono::milliseconds(0));
+  background::drain();
+  REQUIRE(!ran);
+  REQUIRE(background::pending() == 1);
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
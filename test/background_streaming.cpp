@@ -0,0 +1,24 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/background.h>
+#include <fastly/http/response.h>
+
+using namespace fastly::http;
+namespace background = fastly::background;
+
+TEST_CASE("background work is drained after a streamed response finishes",
+          "[background]") {
+  bool ran{false};
+  background::defer([&ran]() { ran = true; });
+
+  auto stream{Response::from_body("hel").stream_to_client()};
+  stream << "lo";
+  stream.flush();
+  REQUIRE(!ran);
+  REQUIRE(stream.finish().has_value());
+  REQUIRE(ran);
+  REQUIRE(background::pending() == 0);
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,74 @@
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/error.h>
+#include <fastly/http/body.h>
+#include <string>
+
+using fastly::http::Body;
+
+namespace {
+
+std::string read_some(fastly::http::TeeReader &reader, size_t n) {
+  std::string out;
+  std::array<uint8_t, 64> buf;
+  while (out.size() < n) {
+    auto read{reader.read(buf.data(), std::min(buf.size(), n - out.size()))};
+    REQUIRE(read.has_value());
+    if (*read == 0) {
+      break;
+    }
+    out.append(reinterpret_cast<char *>(buf.data()), *read);
+  }
+  return out;
+}
+
+} // namespace
+
+TEST_CASE("Body::tee gives both readers the whole body", "[body]") {
+  std::string content(1000, 'x');
+  for (size_t i{0}; i < content.size(); i++) {
+    content[i] = static_cast<char>('a' + i % 26);
+  }
+  auto [a, b] = Body(content).tee(128);
+
+  std::string seen_a;
+  std::string seen_b;
+  while (seen_a.size() < content.size() || seen_b.size() < content.size()) {
+    seen_a += read_some(a, 100);
+    seen_b += read_some(b, 100);
+  }
+  REQUIRE(seen_a == content);
+  REQUIRE(seen_b == content);
+  REQUIRE(read_some(a, 1).empty());
+}
+
+TEST_CASE("Body::tee limits how far one reader can run ahead", "[body]") {
+  auto [a, b] = Body(std::string(256, 'z')).tee(64);
+  REQUIRE(read_some(a, 64).size() == 64);
+
+  std::array<uint8_t, 1> buf;
+  auto read{a.read(buf.data(), buf.size())};
+  REQUIRE_FALSE(read.has_value());
+  REQUIRE(read.error().error_code() == fastly::FastlyErrorCode::IoError);
+
+  SECTION("detaching the slow reader lifts the limit") {
+    REQUIRE(b.detach().has_value());
+    REQUIRE(read_some(a, 1000).size() == 192);
+  }
+}
+
+TEST_CASE("Body::tee readers work as input streams", "[body]") {
+  auto [a, b] = Body("first line\nsecond line\n").tee();
+  std::string line_a;
+  std::string line_b;
+  std::getline(a, line_a);
+  std::getline(b, line_b);
+  REQUIRE(line_a == "first line");
+  REQUIRE(line_b == "first line");
+  std::getline(b, line_b);
+  REQUIRE(line_b == "second line");
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,53 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/cache/core.h>
+
+namespace core = fastly::cache::core;
+using namespace std::chrono_literals;
+
+TEST_CASE("Inserted items can be looked up", "[cache]") {
+  auto missing{core::lookup("cache-core-test-missing").execute()};
+  REQUIRE(missing.has_value());
+  REQUIRE(!missing->has_value());
+
+  auto writer{core::insert("cache-core-test-1", 1min)
+                  .user_metadata({1, 2, 3})
+                  .surrogate_keys({"cache-core-test"})
+                  .execute()};
+  REQUIRE(writer.has_value());
+  *writer << "hello";
+  REQUIRE(writer->finish().has_value());
+
+  auto found{core::lookup("cache-core-test-1").execute()};
+  REQUIRE(found.has_value());
+  REQUIRE(found->has_value());
+  auto &item{**found};
+  REQUIRE(item.is_usable());
+  REQUIRE(item.ttl() == 1min);
+  REQUIRE(item.user_metadata() == std::vector<uint8_t>{1, 2, 3});
+  auto body{item.to_stream()};
+  REQUIRE(body.has_value());
+  REQUIRE(body->take_body_string() == "hello");
+}
+
+TEST_CASE("Transactions insert missing items once", "[cache]") {
+  auto tx{core::Transaction::lookup("cache-core-test-2").execute()};
+  REQUIRE(tx.has_value());
+  REQUIRE(tx->must_insert());
+  REQUIRE(!tx->found().has_value());
+
+  auto inserted{std::move(*tx).insert(1min).execute_and_stream_back()};
+  REQUIRE(inserted.has_value());
+  auto &[writer, found]{*inserted};
+  writer << "computed";
+  REQUIRE(writer.finish().has_value());
+  REQUIRE(found.to_stream()->take_body_string() == "computed");
+
+  auto again{core::Transaction::lookup("cache-core-test-2").execute()};
+  REQUIRE(again.has_value());
+  REQUIRE(!again->must_insert_or_update());
+  REQUIRE(again->found().has_value());
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,80 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/http/request.h>
+
+using namespace fastly::http;
+
+TEST_CASE("A CacheOverride records its settings", "[cache_override]") {
+  auto co{CacheOverride::ttl(300)
+              .with_stale_while_revalidate(60)
+              .with_surrogate_key("a b")};
+  REQUIRE(!co.is_pass());
+  REQUIRE(co.get_ttl() == 300);
+  REQUIRE(co.get_stale_while_revalidate() == 60);
+  REQUIRE(!co.get_pci());
+  REQUIRE(co.get_surrogate_key() == "a b");
+
+  REQUIRE(CacheOverride::pass().is_pass());
+  REQUIRE(!CacheOverride::none().get_ttl());
+}
+
+TEST_CASE("A CacheOverride orders settings like the request setters",
+          "[cache_override]") {
+  // Setting anything after a pass un-passes, as `Request::set_ttl()` does.
+  auto co{CacheOverride::pass().with_pci(true)};
+  REQUIRE(!co.is_pass());
+  REQUIRE(co.get_pci());
+  REQUIRE(!co.get_ttl());
+
+  auto copy{co.clone().with_stale_while_revalidate(30)};
+  REQUIRE(copy.get_stale_while_revalidate() == 30);
+  REQUIRE(!co.get_stale_while_revalidate());
+}
+
+TEST_CASE("A CacheOverride applies to a request", "[cache_override]") {
+  auto req{Request::get("https://www.fastly.com/")};
+  REQUIRE(req.set_cache_override(CacheOverride::pass()).has_value());
+  REQUIRE(
+      req.set_cache_override(CacheOverride::ttl(60).with_surrogate_key("\n"))
+          .error()
+          .error_code() == fastly::FastlyErrorCode::InvalidHeaderValue);
+}
+
+TEST_CASE("with_ttl caches rather than passes", "[cache_override]") {
+  // A pass goes straight to the backend without the HTTP cache, so the
+  // after-send hook only runs if the TTL left the request cacheable.
+  bool after{false};
+  auto resp{Request::get("https://www.fastly.com/?with-ttl")
+                .with_ttl(60)
+                .with_after_send([&](CandidateResponse &) { after = true; })
+                .send("fastly")};
+  REQUIRE(resp.has_value());
+  REQUIRE(after);
+}
+
+TEST_CASE("Send hooks run around a backend request", "[cache_override]") {
+  bool before{false};
+  bool after{false};
+  auto resp{Request::get("https://www.fastly.com/")
+                .with_pass(false)
+                .with_before_send([&](Request &req) {
+                  before = true;
+                  REQUIRE(req.set_header("x-from-hook", "1").has_value());
+                })
+                .with_after_send([&](CandidateResponse &candidate) {
+                  after = true;
+                  auto set{candidate.set_header("x-cached-by-hook", "1")};
+                  REQUIRE(set.has_value());
+                  candidate.set_ttl(std::chrono::seconds(1));
+                })
+                .send("fastly")};
+  REQUIRE(resp.has_value());
+  // A cached response skips both hooks, so only check them if they ran.
+  if (after) {
+    REQUIRE(before);
+    REQUIRE(resp->get_header("x-cached-by-hook").value().has_value());
+  }
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,45 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/cache/simple.h>
+
+namespace simple = fastly::cache::simple;
+using namespace std::chrono_literals;
+
+TEST_CASE("get_or_set_with computes a value once", "[cache]") {
+  auto missing{simple::get("simple-cache-test-1")};
+  REQUIRE(missing.has_value());
+  REQUIRE(!missing->has_value());
+
+  int calls{0};
+  auto make{[&]() -> std::optional<simple::CacheEntry> {
+    calls++;
+    return simple::CacheEntry{fastly::Body("computed"), 1min};
+  }};
+  for (int i{0}; i < 3; i++) {
+    auto value{simple::get_or_set_with("simple-cache-test-1", make)};
+    REQUIRE(value.has_value());
+    REQUIRE(value->has_value());
+    REQUIRE((*value)->take_body_string() == "computed");
+  }
+  REQUIRE(calls == 1);
+
+  auto cached{simple::get("simple-cache-test-1")};
+  REQUIRE(cached.has_value());
+  REQUIRE(cached->has_value());
+  REQUIRE((*cached)->take_body_string() == "computed");
+}
+
+TEST_CASE("get_or_set_with caches nothing without an entry", "[cache]") {
+  auto value{simple::get_or_set_with(
+      "simple-cache-test-2",
+      []() -> std::optional<simple::CacheEntry> { return std::nullopt; })};
+  REQUIRE(value.has_value());
+  REQUIRE(!value->has_value());
+
+  auto set{simple::get_or_set("simple-cache-test-2", fastly::Body("x"), 1min)};
+  REQUIRE(set.has_value());
+  REQUIRE(set->take_body_string() == "x");
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
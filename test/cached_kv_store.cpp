@@ -0,0 +1,34 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/cached_kv_store.h>
+
+using namespace fastly::kv_store;
+
+TEST_CASE("CachedKVStore reads through the cache", "[cached_kv_store]") {
+  auto store{std::move(
+      CachedKVStore::open("test-store",
+                          KVCachePolicy().key_prefix("cached-kv-test/"))
+          ->value())};
+  REQUIRE(store.insert("cached-key", fastly::Body("value")));
+  auto generation{store.store().lookup("cached-key")->current_generation()};
+
+  auto first{store.lookup("cached-key")};
+  REQUIRE(first.has_value());
+  REQUIRE(first->body.take_body_string() == "value");
+  REQUIRE(first->generation == generation);
+
+  auto second{store.lookup("cached-key")};
+  REQUIRE(second.has_value());
+  REQUIRE(second->body.take_body_string() == "value");
+  REQUIRE(second->generation == generation);
+}
+
+TEST_CASE("CachedKVStore reports missing keys", "[cached_kv_store]") {
+  auto store{std::move(CachedKVStore::open("test-store")->value())};
+  auto missing{store.lookup("cached-missing-key")};
+  REQUIRE(!missing.has_value());
+  REQUIRE(missing.error().error_code() == KVStoreErrorCode::ItemNotFound);
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
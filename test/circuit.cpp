@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/http/circuit.h>
+
+using namespace fastly::http;
+using circuit::CircuitBreaker;
+using circuit::CircuitPolicy;
+using circuit::State;
+
+TEST_CASE("A circuit opens after enough failures", "[circuit]") {
+  CircuitBreaker breaker{"test-store", CircuitPolicy()
+                                           .failure_threshold(2)
+                                           .open_duration(std::chrono::hours(1))
+                                           .key_prefix("circuit-test-1/")};
+  REQUIRE(breaker.state("fastly") == State::Closed);
+  REQUIRE(breaker.allow("fastly"));
+
+  breaker.record_failure("fastly");
+  REQUIRE(breaker.state("fastly") == State::Closed);
+  breaker.record_failure("fastly");
+  REQUIRE(breaker.state("fastly") == State::Open);
+  REQUIRE(!breaker.allow("fastly"));
+
+  auto resp{breaker.send(Request::get("https://www.fastly.com/"), "fastly")};
+  REQUIRE(!resp.has_value());
+  REQUIRE(resp.error().error_code() == fastly::FastlyErrorCode::CircuitOpen);
+
+  SECTION("and the state is shared") {
+    CircuitBreaker other{"test-store",
+                         CircuitPolicy()
+                             .open_duration(std::chrono::hours(1))
+                             .key_prefix("circuit-test-1/")};
+    REQUIRE(other.state("fastly") == State::Open);
+  }
+}
+
+TEST_CASE("An open circuit fails over and probes", "[circuit]") {
+  CircuitBreaker breaker{"test-store",
+                         CircuitPolicy()
+                             .failure_threshold(1)
+                             .open_duration(std::chrono::milliseconds(0))
+                             .fallback("fastly")
+                             .key_prefix("circuit-test-2/")};
+  breaker.record_failure("wikipedia");
+  REQUIRE(breaker.state("wikipedia") == State::HalfOpen);
+
+  // The first caller after the open period gets the probe.
+  REQUIRE(breaker.allow("wikipedia"));
+  breaker.record_success("wikipedia");
+  REQUIRE(breaker.state("wikipedia") == State::Closed);
+}
+
+TEST_CASE("An open circuit sends to the fallback", "[circuit]") {
+  CircuitBreaker breaker{"test-store",
+                         CircuitPolicy()
+                             .failure_threshold(1)
+                             .open_duration(std::chrono::hours(1))
+                             .fallback("fastly")
+                             .key_prefix("circuit-test-3/")};
+  breaker.record_failure("wikipedia");
+  REQUIRE(breaker.state("wikipedia") == State::Open);
+
+  auto resp{breaker.send(Request::get("https://www.fastly.com/"), "wikipedia")};
+  REQUIRE(resp.has_value());
+  REQUIRE(resp->get_backend_name() == "fastly");
+  REQUIRE(breaker.state("wikipedia") == State::Open);
+  REQUIRE(breaker.state("fastly") == State::Closed);
+}
+
+TEST_CASE("Failures recorded by separate breakers add up", "[circuit]") {
+  auto policy{[] {
+    return CircuitPolicy()
+        .failure_threshold(2)
+        .open_duration(std::chrono::hours(1))
+        .key_prefix("circuit-test-4/");
+  }};
+  CircuitBreaker first{"test-store", policy()};
+  CircuitBreaker second{"test-store", policy()};
+  // Both load the closed circuit before either records a failure.
+  REQUIRE(first.state("fastly") == State::Closed);
+  REQUIRE(second.state("fastly") == State::Closed);
+
+  first.record_failure("fastly");
+  second.record_failure("fastly");
+  REQUIRE(second.state("fastly") == State::Open);
+  CircuitBreaker third{"test-store", policy()};
+  REQUIRE(third.state("fastly") == State::Open);
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,75 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/director.h>
+#include <map>
+#include <string>
+
+using namespace fastly::director;
+using fastly::http::Request;
+
+namespace {
+
+std::map<std::string, int> tally(Director &director, int picks) {
+  std::map<std::string, int> counts;
+  for (int i{0}; i < picks; i++) {
+    auto req{Request::get("https://example.com/")};
+    auto backend{director.choose(req)};
+    REQUIRE(backend.has_value());
+    counts[backend->name()]++;
+  }
+  return counts;
+}
+
+} // namespace
+
+TEST_CASE("RoundRobin follows the weights", "[director]") {
+  RoundRobin director{{{"fastly", 1}, {"wikipedia", 3}}};
+  auto counts{tally(director, 40)};
+  REQUIRE(counts["fastly"] == 10);
+  REQUIRE(counts["wikipedia"] == 30);
+}
+
+TEST_CASE("Directors skip backends that don't exist", "[director]") {
+  Random director{{{"fastly"}, {"no-such-backend"}}};
+  auto counts{tally(director, 20)};
+  REQUIRE(counts["fastly"] == 20);
+
+  director.mark_unhealthy("fastly");
+  auto req{Request::get("https://example.com/")};
+  auto none{director.choose(req)};
+  REQUIRE(!none.has_value());
+  REQUIRE(none.error().error_code() == fastly::FastlyErrorCode::IoError);
+}
+
+TEST_CASE("ConsistentHash maps a key to the same backend", "[director]") {
+  ConsistentHash director{{{"fastly"}, {"wikipedia"}, {"esi-cpp-demo"}}};
+  for (auto key : {"/a", "/b", "/c", "/d"}) {
+    auto first{director.choose(std::string_view(key))};
+    REQUIRE(first.has_value());
+    for (int i{0}; i < 5; i++) {
+      auto again{director.choose(std::string_view(key))};
+      REQUIRE(again.has_value());
+      REQUIRE(again->name() == first->name());
+    }
+  }
+
+  SECTION("and keeps keys of healthy backends in place") {
+    std::map<std::string, std::string> before;
+    for (int i{0}; i < 50; i++) {
+      auto key{std::to_string(i)};
+      before[key] = director.choose(std::string_view(key))->name();
+    }
+    director.mark_unhealthy("esi-cpp-demo");
+    for (auto &[key, name] : before) {
+      auto after{director.choose(std::string_view(key))};
+      REQUIRE(after.has_value());
+      REQUIRE(after->name() != "esi-cpp-demo");
+      if (name != "esi-cpp-demo") {
+        REQUIRE(after->name() == name);
+      }
+    }
+  }
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <array>
 #include <catch2/catch_test_macros.hpp>
 #include <fastly/http/body.h>
+#include <fastly/http/request.h>
 #include <fastly/kv_store.h>
 
 using namespace fastly::http;
@@ -146,11 +149,59 @@ TEST_CASE("ListBuilder advanced options", "[kv_store]") {
            keys[1] == "prefix_key3"));
   REQUIRE(keys[0] != keys[1]);
 
+  auto views = page_result->key_views();
+  REQUIRE(views.size() == keys.size());
+  REQUIRE(std::ranges::equal(views, keys));
+  REQUIRE(views[1] == keys[1]);
+
   REQUIRE(page_result->limit() == 2);
   REQUIRE(page_result->prefix().has_value());
   REQUIRE(page_result->prefix().value() == "pre");
 }
 
+TEST_CASE("Pipelined and sharded lists", "[kv_store]") {
+  auto store_result = KVStore::open("test-store");
+  REQUIRE(store_result.has_value());
+  KVStore store = std::move(store_result->value());
+
+  std::vector<std::string> inserted{"shard/a1", "shard/a2", "shard/b1",
+                                    "shard/c1", "shard/c2"};
+  for (auto &key : inserted) {
+    REQUIRE(store.insert(key, Body("x")));
+  }
+
+  SECTION("pipelined") {
+    std::vector<std::string> keys;
+    auto pages = store.build_list().prefix("shard/").limit(2).iter_pipelined();
+    while (auto page = pages.next()) {
+      REQUIRE(page->has_value());
+      for (auto &key : (*page)->keys()) {
+        keys.push_back(key);
+      }
+    }
+    std::ranges::sort(keys);
+    REQUIRE(keys == inserted);
+  }
+
+  SECTION("sharded") {
+    std::vector<std::string> keys;
+    auto scan = store.build_list().prefix("shard/").limit(1).iter_sharded(
+        {"a", "b", "c"});
+    REQUIRE(scan.remaining_shards() == 3);
+    while (auto item = scan.next()) {
+      REQUIRE(item->shard < 3);
+      REQUIRE(item->page.has_value());
+      for (auto &key : item->page->keys()) {
+        REQUIRE(key[6] == "abc"[item->shard]);
+        keys.push_back(key);
+      }
+    }
+    REQUIRE(scan.remaining_shards() == 0);
+    std::ranges::sort(keys);
+    REQUIRE(keys == inserted);
+  }
+}
+
 TEST_CASE("LookupResponse metadata and generation", "[kv_store]") {
   auto store_result = KVStore::open("test-store");
   REQUIRE(store_result.has_value());
@@ -180,6 +231,233 @@ TEST_CASE("LookupResponse metadata and generation", "[kv_store]") {
   REQUIRE(new_generation != original_generation);
 }
 
+TEST_CASE("KVStore::lookup_many", "[kv_store]") {
+  auto store_result = KVStore::open("test-store");
+  REQUIRE(store_result.has_value());
+  KVStore store = std::move(store_result->value());
+
+  REQUIRE(store.insert("many_a", Body("a")));
+  REQUIRE(store.insert("many_b", Body("b")));
+  REQUIRE(store.insert("many_c", Body("c")));
+  std::vector<std::string_view> keys{"many_a", "many_b", "many_missing",
+                                     "many_c"};
+
+  SECTION("returns every key once") {
+    auto results = store.lookup_many(keys, 2);
+    REQUIRE(results.remaining() == 4);
+    std::vector<bool> seen(keys.size());
+    while (auto item = results.next()) {
+      REQUIRE(!seen[item->index]);
+      seen[item->index] = true;
+      auto found = keys[item->index] != "many_missing";
+      REQUIRE(item->response.has_value() == found);
+    }
+    REQUIRE(results.remaining() == 0);
+    REQUIRE(std::ranges::all_of(seen, [](bool s) { return s; }));
+  }
+
+  SECTION("ordered") {
+    auto results = store.lookup_many_ordered(keys, 2);
+    REQUIRE(results.size() == 4);
+    REQUIRE(results[0]->take_body().take_body_string() == "a");
+    REQUIRE(results[1]->take_body().take_body_string() == "b");
+    REQUIRE(!results[2].has_value());
+    REQUIRE(results[3]->take_body().take_body_string() == "c");
+  }
+}
+
+TEST_CASE("LookupResponse::read_range", "[kv_store]") {
+  auto store_result = KVStore::open("test-store");
+  REQUIRE(store_result.has_value());
+  KVStore store = std::move(store_result->value());
+  REQUIRE(store.insert("range_key", Body("0123456789")));
+
+  std::array<uint8_t, 4> buf;
+  auto middle{store.lookup("range_key")->read_range(3, buf)};
+  REQUIRE(middle.value() == 4);
+  REQUIRE(std::string(buf.begin(), buf.end()) == "3456");
+
+  auto tail{store.lookup("range_key")->read_range(8, buf)};
+  REQUIRE(tail.value() == 2);
+  REQUIRE(std::string(buf.begin(), buf.begin() + 2) == "89");
+
+  REQUIRE(store.lookup("range_key")->read_range(20, buf).value() == 0);
+
+  auto found{store.lookup("range_key")};
+  REQUIRE(found->read_range(0, buf).value() == 4);
+  REQUIRE(!found->read_range(0, buf));
+}
+
+TEST_CASE("LookupResponse streaming into a StreamingBody", "[kv_store]") {
+  auto store_result = KVStore::open("test-store");
+  REQUIRE(store_result.has_value());
+  KVStore store = std::move(store_result->value());
+  REQUIRE(store.insert("stream_key", Body("0123456789")));
+
+  auto sent{
+      Request::post("https://www.fastly.com/").send_async_streaming("fastly")};
+  REQUIRE(sent.has_value());
+  auto &[body, pending] = *sent;
+
+  REQUIRE(store.lookup("stream_key")->stream_range_to(body, 3, 4).value() ==
+          4);
+  REQUIRE(store.lookup("stream_key")->stream_range_to(body, 8).value() == 2);
+  REQUIRE(store.lookup("stream_key")->stream_range_to(body, 20).value() == 0);
+  auto found{store.lookup("stream_key")};
+  found->append_to(body);
+  REQUIRE(!found->stream_range_to(body, 0));
+  REQUIRE(body.finish().has_value());
+  REQUIRE(pending.wait().has_value());
+}
+
+TEST_CASE("KVStore::lookup_info", "[kv_store]") {
+  auto store_result = KVStore::open("test-store");
+  REQUIRE(store_result.has_value());
+  KVStore store = std::move(store_result->value());
+
+  REQUIRE(store.build_insert()
+              .mode(InsertMode::Overwrite)
+              .metadata("v2")
+              .execute("info_key", Body("a large value")));
+  auto info{store.lookup_info("info_key")};
+  REQUIRE(info.has_value());
+  REQUIRE(info->metadata_str() == "v2");
+  REQUIRE(info->metadata()->size() == 2);
+  REQUIRE(info->current_generation() ==
+          store.lookup("info_key")->current_generation());
+
+  REQUIRE(store.insert("info_bare", Body("x")));
+  REQUIRE(!store.lookup_info("info_bare")->metadata());
+
+  auto missing{store.lookup_info("info_missing")};
+  REQUIRE(missing.error().error_code() == KVStoreErrorCode::ItemNotFound);
+}
+
+TEST_CASE("KVStore::update", "[kv_store]") {
+  auto store_result = KVStore::open("test-store");
+  REQUIRE(store_result.has_value());
+  KVStore store = std::move(store_result->value());
+  (void)store.erase("update_counter");
+  (void)store.erase("update_set");
+
+  SECTION("transform") {
+    REQUIRE(store.insert("update_key", Body("a")));
+    auto updated{store.update("update_key", [](const auto &current) {
+      return std::optional(current.value_or("") + "b");
+    })};
+    REQUIRE(updated.value() == "ab");
+    REQUIRE(store.lookup("update_key")->take_body().take_body_string() ==
+            "ab");
+
+    auto unchanged{store.update("update_key", [](const auto &) {
+      return std::optional<std::string>();
+    })};
+    REQUIRE(unchanged.value() == "ab");
+  }
+
+  SECTION("counter") {
+    REQUIRE(store.increment("update_counter").value() == 1);
+    REQUIRE(store.increment("update_counter", 41).value() == 42);
+    REQUIRE(store.insert("update_counter", Body("nope")));
+    REQUIRE(store.increment("update_counter").error().error_code() ==
+            KVStoreErrorCode::ItemBadRequest);
+    REQUIRE(store.insert("update_counter", Body("9223372036854775807")));
+    REQUIRE(store.increment("update_counter").error().error_code() ==
+            KVStoreErrorCode::ItemBadRequest);
+  }
+
+  SECTION("encoded") {
+    REQUIRE(store.build_insert()
+                .mode(InsertMode::Overwrite)
+                .metadata("meta")
+                .codec(KVCodec::lz4())
+                .execute("update_encoded", Body("1")));
+    REQUIRE(store
+                .increment("update_encoded", 1, std::chrono::seconds(1),
+                           std::chrono::hours(1))
+                .value() == 2);
+    auto found{store.lookup("update_encoded")};
+    REQUIRE(found->codec());
+    REQUIRE(found->metadata() == std::vector<uint8_t>{'m', 'e', 't', 'a'});
+    REQUIRE(found->take_decoded_body()->take_body_string() == "2");
+
+    // Plain bytes followed by an LZ4 frame can't be decoded.
+    REQUIRE(store.insert("update_encoded", Body("x")));
+    REQUIRE(store.build_insert()
+                .mode(InsertMode::Append)
+                .codec(KVCodec::lz4())
+                .execute("update_encoded", Body("1")));
+    auto undecodable{store.increment("update_encoded")};
+    REQUIRE(undecodable.error().error_code() ==
+            KVStoreErrorCode::ItemBadRequest);
+    REQUIRE(undecodable.error().error_msg() !=
+            KVStoreError::item_bad_request().error_msg());
+  }
+
+  SECTION("set") {
+    REQUIRE(store.merge_set("update_set", {"b", "a"}).value() ==
+            std::vector<std::string>{"a", "b"});
+    REQUIRE(store.merge_set("update_set", {"c", "a"}).value() ==
+            std::vector<std::string>{"a", "b", "c"});
+    REQUIRE(store.merge_set("update_set", {"d\ne"}).error().error_code() ==
+            KVStoreErrorCode::ItemBadRequest);
+    REQUIRE(store.merge_set("update_set", {}).value() ==
+            std::vector<std::string>{"a", "b", "c"});
+  }
+}
+
+TEST_CASE("KVCodec", "[kv_store]") {
+  auto store_result = KVStore::open("test-store");
+  REQUIRE(store_result.has_value());
+  KVStore store = std::move(store_result->value());
+  std::string value(4096, 'x');
+
+  SECTION("zstd") {
+    auto codec{KVCodec::zstd()};
+    REQUIRE(store.build_insert()
+                .mode(InsertMode::Overwrite)
+                .metadata("meta")
+                .codec(codec)
+                .execute("codec_zstd", Body(value)));
+    auto found{store.lookup("codec_zstd")};
+    REQUIRE(found->metadata() == std::vector<uint8_t>{'m', 'e', 't', 'a'});
+    REQUIRE(found->take_decoded_body()->take_body_string() == value);
+    REQUIRE(store.lookup_info("codec_zstd")->metadata_str() == "meta");
+    REQUIRE(store.lookup("codec_zstd")->take_body_bytes().size() <
+            value.size());
+  }
+
+  SECTION("lz4") {
+    REQUIRE(store.build_insert()
+                .codec(KVCodec::lz4())
+                .execute("codec_lz4", Body(value)));
+    auto found{store.lookup("codec_lz4")};
+    REQUIRE(!found->metadata());
+    REQUIRE(found->take_decoded_body()->take_body_string() == value);
+  }
+
+  SECTION("undecodable") {
+    REQUIRE(store.build_insert()
+                .mode(InsertMode::Overwrite)
+                .execute("codec_bad", Body("not lz4")));
+    // The appended frame tags the value, which doesn't start with one.
+    REQUIRE(store.build_insert()
+                .mode(InsertMode::Append)
+                .codec(KVCodec::lz4())
+                .execute("codec_bad", Body(value)));
+    REQUIRE(!store.lookup("codec_bad")->take_decoded_body());
+    auto stored{store.lookup("codec_bad")->take_body().take_body_string()};
+    REQUIRE(stored.starts_with("not lz4"));
+  }
+
+  SECTION("reserved metadata") {
+    auto inserted{store.build_insert()
+                      .metadata("fastly-codec:zstd\n")
+                      .execute("codec_reserved", Body("x"))};
+    REQUIRE(inserted.error().error_code() == KVStoreErrorCode::ItemBadRequest);
+  }
+}
+
 // Required due to https://github.com/WebAssembly/wasi-libc/issues/485
 #include <catch2/catch_session.hpp>
-int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
\ No newline at end of file
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
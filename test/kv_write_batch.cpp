@@ -0,0 +1,43 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/kv_write_batch.h>
+
+using namespace fastly::kv_store;
+
+TEST_CASE("KVWriteBatch coalesces writes", "[kv_write_batch]") {
+  auto batch{std::move(KVWriteBatch::open("test-store")->value())};
+  batch.insert("batch-a", fastly::Body("1"));
+  batch.insert("batch-a", fastly::Body("2"));
+  batch.insert("batch-b", fastly::Body("x"));
+  batch.insert("batch-b", fastly::Body("y"), InsertMode::Append);
+  batch.insert("batch-b", fastly::Body("w"), InsertMode::Prepend);
+  batch.insert("batch-c", fastly::Body("gone"));
+  batch.erase("batch-c");
+  REQUIRE(batch.size() == 3);
+
+  auto failures{std::move(batch).commit()};
+  REQUIRE(failures.empty());
+
+  auto store{std::move(KVStore::open("test-store")->value())};
+  REQUIRE(store.lookup("batch-a")->take_body().take_body_string() == "2");
+  REQUIRE(store.lookup("batch-b")->take_body().take_body_string() == "wxy");
+  REQUIRE(store.lookup("batch-c").error().error_code() ==
+          KVStoreErrorCode::ItemNotFound);
+}
+
+TEST_CASE("KVWriteBatch orders writes it can't coalesce", "[kv_write_batch]") {
+  auto store{std::move(KVStore::open("test-store")->value())};
+  REQUIRE(store.insert("batch-d", fastly::Body("m")));
+
+  auto batch{std::move(KVWriteBatch::open("test-store")->value())};
+  batch.insert("batch-d", fastly::Body("n"), InsertMode::Append);
+  batch.insert("batch-d", fastly::Body("l"), InsertMode::Prepend);
+  batch.insert("batch-d", fastly::Body("o"), InsertMode::Append);
+  REQUIRE(batch.size() == 3);
+
+  REQUIRE(std::move(batch).commit().empty());
+  REQUIRE(store.lookup("batch-d")->take_body().take_body_string() == "lmno");
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
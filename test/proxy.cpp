@@ -0,0 +1,63 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/http/body.h>
+#include <fastly/http/proxy.h>
+#include <fastly/http/request.h>
+#include <string>
+#include <vector>
+
+using namespace fastly::http;
+
+namespace {
+
+Request upload(std::string body) {
+  auto req{Request::post("https://www.fastly.com/")};
+  req.set_body(Body(std::move(body)));
+  return req;
+}
+
+} // namespace
+
+TEST_CASE("proxy_streaming without a hook sends the request as is",
+          "[proxy]") {
+  auto pending{proxy_streaming(upload("hello"), "fastly")};
+  REQUIRE(pending.has_value());
+  REQUIRE(pending->wait().has_value());
+}
+
+TEST_CASE("proxy_streaming shows every block to the inspection hook",
+          "[proxy]") {
+  std::string content(1000, 'x');
+  for (size_t i{0}; i < content.size(); i++) {
+    content[i] = static_cast<char>('a' + i % 26);
+  }
+  std::vector<size_t> blocks;
+  std::string seen;
+  auto hook{[&](std::span<const uint8_t> block) {
+    blocks.push_back(block.size());
+    seen.append(reinterpret_cast<const char *>(block.data()), block.size());
+    return true;
+  }};
+
+  auto pending{proxy_streaming(upload(content), "fastly",
+                               ProxyOptions().block_size(256).inspect(hook))};
+  REQUIRE(pending.has_value());
+  REQUIRE(pending->wait().has_value());
+  REQUIRE(seen == content);
+  for (auto size : blocks) {
+    REQUIRE(size <= 256);
+  }
+}
+
+TEST_CASE("proxy_streaming abandons an upload the hook rejects", "[proxy]") {
+  size_t calls{0};
+  auto pending{proxy_streaming(
+      upload(std::string(1000, 'x')), "fastly",
+      ProxyOptions().block_size(256).inspect(
+          [&calls](std::span<const uint8_t>) { return ++calls < 2; }))};
+  REQUIRE(!pending.has_value());
+  REQUIRE(calls == 2);
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
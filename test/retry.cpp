@@ -0,0 +1,72 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/http/body.h>
+#include <fastly/http/request.h>
+#include <fastly/http/retry.h>
+#include <string>
+
+using namespace fastly::http;
+using retry::RetryPolicy;
+
+namespace {
+
+// A policy that retries whatever the backend answers `req` with, so that
+// every attempt allowed is used.
+RetryPolicy retry_every_response(Request req) {
+  auto first{req.send("fastly")};
+  REQUIRE(first.has_value());
+  return RetryPolicy()
+      .max_attempts(3)
+      .initial_backoff(std::chrono::milliseconds(0))
+      .jitter(false)
+      .retry_on_status({first->get_status()});
+}
+
+Request post_with_body(std::string body) {
+  auto req{Request::post("https://www.fastly.com/")};
+  req.set_body(Body(std::move(body)));
+  return req;
+}
+
+} // namespace
+
+TEST_CASE("retry::send_async retries a request without a body", "[retry]") {
+  auto policy{retry_every_response(Request::get("https://www.fastly.com/"))};
+  auto pending{retry::send_async(Request::get("https://www.fastly.com/"),
+                                 "fastly", policy)};
+  REQUIRE(pending.has_value());
+  REQUIRE(pending->wait().has_value());
+  REQUIRE(pending->attempts() == 3);
+}
+
+TEST_CASE("retry::send_async replays a request body", "[retry]") {
+  auto policy{retry_every_response(post_with_body("hello"))
+                  .retry_non_idempotent(true)};
+
+  SECTION("that fits into max_replay_bytes") {
+    auto pending{retry::send_async(post_with_body("hello"), "fastly", policy)};
+    REQUIRE(pending.has_value());
+    REQUIRE(pending->wait().has_value());
+    REQUIRE(pending->attempts() == 3);
+  }
+
+  SECTION("but not one larger than max_replay_bytes") {
+    auto small{RetryPolicy(policy).max_replay_bytes(4)};
+    auto pending{retry::send_async(post_with_body("hello"), "fastly", small)};
+    REQUIRE(pending.has_value());
+    REQUIRE(pending->wait().has_value());
+    REQUIRE(pending->attempts() == 1);
+  }
+}
+
+TEST_CASE("retry::send_async doesn't retry non-idempotent requests",
+          "[retry]") {
+  auto policy{retry_every_response(post_with_body("hello"))};
+  auto pending{retry::send_async(post_with_body("hello"), "fastly", policy)};
+  REQUIRE(pending.has_value());
+  REQUIRE(pending->wait().has_value());
+  REQUIRE(pending->attempts() == 1);
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }
@@ -0,0 +1,45 @@
+#include <catch2/catch_test_macros.hpp>
+#include <fastly/http/request.h>
+#include <fastly/http/timing.h>
+
+using namespace fastly::http;
+
+TEST_CASE("Backend sends are only timed once enabled", "[timing]") {
+  timing::clear();
+  auto resp{Request::get("https://www.fastly.com/").send("fastly")};
+  REQUIRE(resp.has_value());
+  REQUIRE(timing::records().empty());
+}
+
+TEST_CASE("Timing records a send and its body", "[timing]") {
+  timing::clear();
+  timing::enable();
+
+  auto pending{Request::get("https://www.fastly.com/").send_async("fastly")};
+  REQUIRE(pending.has_value());
+  REQUIRE(timing::records().size() == 1);
+  REQUIRE(!timing::records()[0].response);
+
+  auto resp{pending->wait()};
+  REQUIRE(resp.has_value());
+  auto &record{timing::records()[0]};
+  REQUIRE(record.backend == "fastly");
+  REQUIRE(record.status == resp->get_status().as_code());
+  REQUIRE(record.time_to_first_byte().has_value());
+  REQUIRE(!record.total_time().has_value());
+
+  auto body{resp->take_body_string()};
+  REQUIRE(record.bytes_received == body.size());
+  REQUIRE(record.total_time().has_value());
+  REQUIRE(*record.total_time() >= *record.time_to_first_byte());
+
+  auto header{timing::server_timing()};
+  REQUIRE(header.find("fastly-ttfb;dur=") != std::string::npos);
+  REQUIRE(header.find("fastly-total;dur=") != std::string::npos);
+
+  timing::enable(false);
+}
+
+// Required due to https://github.com/WebAssembly/wasi-libc/issues/485
+#include <catch2/catch_session.hpp>
+int main(int argc, char *argv[]) { return Catch::Session().run(argc, argv); }